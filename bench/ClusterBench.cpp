@@ -0,0 +1,935 @@
+// bench/ClusterBench.cpp
+// A whole table in one process: N NetworkManager/GameEngine nodes over
+// loopback, a stand-in for the room server, and optional per-link fault
+// injection. Reports handshake throughput, commit latency and shuffle/deal
+// time as N grows.
+//
+//   ClusterBench [--nodes 2,4,8] [--hands 2] [--actions 0] [--latency-ms 0]
+//                [--jitter-ms 0] [--loss 0] [--reorder 0] [--io-threads 1]
+//                [--crypto-threads 0] [--no-crypto] [--late-join] [--crash]
+//                [--tables 1] [--metrics]
+//
+// --actions 0 means 4 per player per hand (one per betting round); the last
+// action of every hand is the winner taking the pot. --late-join seats one
+// more node after the hands and times its state transfer and its seating
+// as a validator. --crash then kills the last node (of four or more) and
+// times how long the others take to decide to drop it and commit without
+// it. --tables hosts that many tables on every node over the
+// same connections and workers: the first plays the scripted hands, with
+// crypto, while the others bet as fast as they commit; each reports its own
+// commit latency.
+#include "NetworkManager.h"
+#include "GameEngine.h"
+#include "MembershipList.h"
+#include "FrameDecoder.h"
+#include "SendQueue.h"
+#include "IoPool.h"
+#include "WireCodec.h"
+#include "Metrics.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <json/json.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using tcp = boost::asio::ip::tcp;
+
+struct Options {
+    std::vector<int> nodes{2, 4, 8};
+    int hands = 2;
+    int actions = 0;
+    int latencyMs = 0;
+    int jitterMs = 0;
+    double loss = 0.0;
+    double reorder = 0.0;
+    size_t ioThreads = 1;
+    size_t cryptoThreads = 0;
+    bool crypto = true;
+    bool lateJoin = false;
+    bool crash = false;
+    bool metrics = false;
+    int tables = 1;
+
+    bool faulty() const { return latencyMs > 0 || jitterMs > 0 || loss > 0 || reorder > 0; }
+};
+
+double ms(Clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// ---------------------------------------------------------------------------
+// Fault injection: one proxy per peer link. Frames are split with the same
+// FrameDecoder the nodes use, then dropped, delayed or held back before being
+// forwarded. Handshake frames always pass so every link comes up.
+
+class LinkProxy : public std::enable_shared_from_this<LinkProxy> {
+public:
+    LinkProxy(IoPool& pool, int targetPort, const Options& options)
+        : io(pool),
+          acceptor(pool.context(), tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+          target(targetPort),
+          opts(options) {}
+
+    int port() const { return acceptor.local_endpoint().port(); }
+
+    void start() {
+        auto self = shared_from_this();
+        auto client = std::make_shared<tcp::socket>(io.makeStrand());
+        acceptor.async_accept(*client, [self, client](const boost::system::error_code& error) {
+            if (!error) {
+                self->connect(client);
+            }
+        });
+    }
+
+    void stop() {
+        boost::system::error_code ignored;
+        acceptor.close(ignored);
+        for (auto& sock : sockets) {
+            sock->shutdown(tcp::socket::shutdown_both, ignored);
+        }
+    }
+
+private:
+    struct Pump {
+        std::shared_ptr<tcp::socket> from;
+        std::shared_ptr<SendQueue> to;
+        FrameDecoder decoder;
+        std::mt19937_64 rng;
+    };
+
+    void connect(std::shared_ptr<tcp::socket> client) {
+        auto server = std::make_shared<tcp::socket>(io.makeStrand());
+        boost::system::error_code error;
+        server->connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(),
+                                      static_cast<unsigned short>(target)), error);
+        if (error) {
+            return;
+        }
+        client->set_option(tcp::no_delay(true));
+        server->set_option(tcp::no_delay(true));
+        sockets = {client, server};
+
+        auto toServer = std::make_shared<SendQueue>(server, 64 * 1024 * 1024);
+        auto toClient = std::make_shared<SendQueue>(client, 64 * 1024 * 1024);
+        std::random_device seed;
+        auto up = std::make_shared<Pump>(Pump{client, toServer, FrameDecoder(), std::mt19937_64(seed())});
+        auto down = std::make_shared<Pump>(Pump{server, toClient, FrameDecoder(), std::mt19937_64(seed())});
+        read(up);
+        read(down);
+    }
+
+    void read(std::shared_ptr<Pump> pump) {
+        auto self = shared_from_this();
+        auto regions = pump->decoder.writable();
+        std::array<boost::asio::mutable_buffer, 2> buffers = {{
+            boost::asio::buffer(regions[0].data, regions[0].size),
+            boost::asio::buffer(regions[1].data, regions[1].size)
+        }};
+        pump->from->async_read_some(buffers,
+            [self, pump](const boost::system::error_code& error, size_t bytes) {
+                if (error) {
+                    pump->to->close();
+                    return;
+                }
+                pump->decoder.commit(bytes);
+                pump->decoder.drain([&](const char* data, size_t len) {
+                    self->forward(*pump, data, len);
+                });
+                self->read(pump);
+            });
+    }
+
+    void forward(Pump& pump, const char* data, size_t len) {
+        auto body = std::make_shared<const std::string>(data, len);
+        wire::FrameView frame;
+        bool handshake = !wire::isBinary(data, len) || !wire::decode(data, len, frame) ||
+                         frame.type == wire::MessageType::HELLO ||
+                         frame.type == wire::MessageType::WELCOME ||
+                         frame.type == wire::MessageType::AUTH;
+        if (handshake) {
+            pump.to->enqueue(body);
+            return;
+        }
+
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        if (opts.loss > 0 && coin(pump.rng) < opts.loss) {
+            return;
+        }
+        int delay = opts.latencyMs;
+        if (opts.jitterMs > 0) {
+            delay += std::uniform_int_distribution<int>(0, opts.jitterMs)(pump.rng);
+        }
+        if (opts.reorder > 0 && coin(pump.rng) < opts.reorder) {
+            delay += opts.latencyMs + opts.jitterMs + 1;   // overtaken by the next frames
+        }
+        if (delay == 0) {
+            pump.to->enqueue(body);
+            return;
+        }
+        auto timer = std::make_shared<boost::asio::steady_timer>(io.context(),
+                                                                 std::chrono::milliseconds(delay));
+        std::shared_ptr<SendQueue> to = pump.to;
+        timer->async_wait([timer, to, body](const boost::system::error_code& error) {
+            if (!error) {
+                to->enqueue(body);
+            }
+        });
+    }
+
+    IoPool& io;
+    tcp::acceptor acceptor;
+    int target;
+    const Options& opts;
+    std::vector<std::shared_ptr<tcp::socket>> sockets;
+};
+
+// ---------------------------------------------------------------------------
+// Stand-in for src/server/server.py: answers JOIN with the members of that
+// room so far and adds the joiner. Same length-prefixed JSON as the real server, one thread
+// per client. Member addresses come from a callback so links can be routed
+// through a LinkProxy.
+
+class RoomServer {
+public:
+    using AddressFn = std::function<std::string(const std::string& joiner, const std::string& member)>;
+
+    explicit RoomServer(AddressFn addressFn) : addressFor(std::move(addressFn)), listenFd(-1) {}
+    ~RoomServer() { stop(); }
+
+    int start() {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        listen(listenFd, 128);
+        socklen_t len = sizeof(addr);
+        getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &len);
+        acceptThread = std::thread(&RoomServer::acceptLoop, this);
+        return ntohs(addr.sin_port);
+    }
+
+    void stop() {
+        if (listenFd < 0) {
+            return;
+        }
+        shutdown(listenFd, SHUT_RDWR);
+        acceptThread.join();
+        close(listenFd);
+        listenFd = -1;
+        std::vector<std::thread> threads;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            for (int fd : clients) {
+                shutdown(fd, SHUT_RDWR);
+            }
+            threads.swap(clientThreads);
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        for (int fd : clients) {
+            close(fd);
+        }
+        clients.clear();
+    }
+
+private:
+    void acceptLoop() {
+        while (true) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mtx);
+            clients.push_back(fd);
+            clientThreads.emplace_back(&RoomServer::serve, this, fd);
+        }
+    }
+
+    static bool readAll(int fd, char* data, size_t len) {
+        while (len > 0) {
+            ssize_t n = recv(fd, data, len, 0);
+            if (n <= 0) {
+                return false;
+            }
+            data += n;
+            len -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    void serve(int fd) {
+        while (true) {
+            uint32_t length;
+            if (!readAll(fd, reinterpret_cast<char*>(&length), 4)) {
+                return;
+            }
+            std::string body(ntohl(length), '\0');
+            if (!readAll(fd, &body[0], body.size())) {
+                return;
+            }
+            Json::Value request;
+            Json::Reader reader;
+            if (!reader.parse(body, request) || request["command"].asString() != "JOIN") {
+                continue;
+            }
+
+            std::string joiner = request["client_id"].asString();
+            Json::Value reply;
+            reply["status"] = "success";
+            reply["members"] = Json::Value(Json::arrayValue);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                std::vector<std::string>& room = rooms[request["room_id"].asString()];
+                for (const auto& member : room) {
+                    reply["members"].append(addressFor(joiner, member));
+                }
+                room.push_back(joiner);
+            }
+            std::string out = Json::FastWriter().write(reply);
+            uint32_t prefix = htonl(static_cast<uint32_t>(out.size()));
+            send(fd, &prefix, 4, MSG_NOSIGNAL);
+            send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+        }
+    }
+
+    AddressFn addressFor;
+    int listenFd;
+    std::thread acceptThread;
+    std::mutex mtx;
+    std::map<std::string, std::vector<std::string>> rooms;
+    std::vector<int> clients;
+    std::vector<std::thread> clientThreads;
+};
+
+// ---------------------------------------------------------------------------
+
+// Submit and commit times per entry, for every node
+class CommitTracker {
+public:
+    explicit CommitTracker(size_t nodes) : nodeCount(nodes) {}
+
+    void submitted(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mtx);
+        entries[key].submitted = Clock::now();
+    }
+
+    void committed(size_t node, const std::vector<CommitEntry>& batch) {
+        Clock::time_point now = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            for (const auto& entry : batch) {
+                Entry& e = entries[entry.key()];
+                if (e.committedAt.empty()) {
+                    e.committedAt.assign(nodeCount, Clock::time_point());
+                }
+                if (e.committedAt[node] == Clock::time_point()) {
+                    e.committedAt[node] = now;
+                    e.commits++;
+                }
+            }
+        }
+        cv.notify_all();
+    }
+
+    // The last node is gone; stop waiting for it
+    void retireLast() {
+        std::lock_guard<std::mutex> lock(mtx);
+        nodeCount--;
+    }
+
+    // Waits until every node committed key; fills first/all latencies
+    bool wait(const std::string& key, std::chrono::milliseconds timeout,
+              double& firstMs, double& allMs) {
+        std::unique_lock<std::mutex> lock(mtx);
+        bool done = cv.wait_for(lock, timeout, [&]() { return entries[key].commits == nodeCount; });
+        if (!done) {
+            return false;
+        }
+        const Entry& e = entries[key];
+        auto bounds = std::minmax_element(e.committedAt.begin(), e.committedAt.end());
+        firstMs = ms(*bounds.first - e.submitted);
+        allMs = ms(*bounds.second - e.submitted);
+        return true;
+    }
+
+private:
+    struct Entry {
+        Clock::time_point submitted;
+        std::vector<Clock::time_point> committedAt;
+        size_t commits = 0;
+    };
+
+    size_t nodeCount;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::map<std::string, Entry> entries;
+};
+
+struct Node {
+    MembershipList members;
+    std::vector<std::unique_ptr<MembershipList>> otherTables;   // --tables, from table 1
+    std::unique_ptr<WorkerPool> workers;                        // shared by the tables
+    std::unique_ptr<NetworkManager> net;
+    std::unique_ptr<GameEngine> engine;
+
+    MembershipList& table(int t) { return t == 0 ? members : *otherTables[t - 1]; }
+};
+
+struct Percentiles {
+    double p50 = 0, p90 = 0, p99 = 0, max = 0;
+};
+
+Percentiles percentiles(std::vector<double> samples) {
+    Percentiles p;
+    if (samples.empty()) {
+        return p;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double q) {
+        return samples[std::min(samples.size() - 1, static_cast<size_t>(q * samples.size()))];
+    };
+    p.p50 = at(0.50);
+    p.p90 = at(0.90);
+    p.p99 = at(0.99);
+    p.max = samples.back();
+    return p;
+}
+
+// One encrypted shuffle by every player, then the remask pass, then every
+// player's two hole cards opened with everyone's keys. Decks are handed
+// from engine to engine directly; only the crypto is timed. The locked deck
+// is published as table state for late joiners.
+bool playDeck(std::vector<Node>& nodes, uint64_t handId, double& shuffleMs, double& dealMs) {
+    Clock::time_point start = Clock::now();
+    std::vector<DeckCrypto::Card> deck = nodes[0].engine->crypto().initialDeck();
+    for (auto& node : nodes) {
+        node.engine->startHand();
+        deck = node.engine->shuffleDeck(std::move(deck));
+    }
+    for (auto& node : nodes) {
+        deck = node.engine->lockDeck(std::move(deck));
+    }
+    Clock::time_point shuffled = Clock::now();
+
+    std::string bytes(deck.size() * DeckCrypto::CARD_BYTES, '\0');
+    for (size_t i = 0; i < deck.size(); i++) {
+        deck[i].toBytes(reinterpret_cast<uint8_t*>(&bytes[i * DeckCrypto::CARD_BYTES]));
+    }
+    for (auto& node : nodes) {
+        node.net->publishDeck(handId, DeckCrypto::CARD_BYTES, bytes);
+    }
+
+    std::vector<size_t> positions;
+    for (size_t i = 0; i < 2 * nodes.size() && i < deck.size(); i++) {
+        positions.push_back(i);
+    }
+    std::vector<DeckCrypto::Card> cards;
+    for (size_t pos : positions) {
+        cards.push_back(deck[pos]);
+    }
+    for (auto& node : nodes) {
+        std::vector<DeckCrypto::Card> keys;
+        for (size_t pos : positions) {
+            keys.push_back(node.engine->cardKey(pos));
+        }
+        node.engine->crypto().applyKeys(cards, keys);
+    }
+    Clock::time_point dealt = Clock::now();
+
+    shuffleMs = ms(shuffled - start);
+    dealMs = ms(dealt - shuffled);
+
+    std::set<int> seen;
+    for (const auto& card : cards) {
+        int index = nodes[0].engine->crypto().decode(card);
+        if (index < 0 || !seen.insert(index).second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether `id` is in node's validator set, waiting up to `timeout` for it
+// to become `wanted`
+bool waitValidator(Node& node, int id, bool wanted, std::chrono::seconds timeout) {
+    Clock::time_point start = Clock::now();
+    while (true) {
+        std::vector<int> set = node.net->validators();
+        bool in = std::find(set.begin(), set.end(), id) != set.end();
+        if (in == wanted || Clock::now() - start > timeout) {
+            return in;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// One more node sits down at the finished table; reports how long until its
+// table state matches, until the table decided to seat it as a validator,
+// and how many bytes the table sent meanwhile. It then leaves, and the
+// table decides that too before going on.
+void lateJoin(std::vector<Node>& nodes, int roomPort, const Options& opts, const SendStats& before) {
+    TableSnapshot target = nodes[0].net->tableSnapshot();
+    int id = static_cast<int>(nodes.size()) + 1;
+    Node late;
+    late.net.reset(new NetworkManager(late.members, "node" + std::to_string(id), "127.0.0.1",
+                                      roomPort, id));
+    late.net->setPeerPort(0);
+    late.net->setIoThreads(opts.ioThreads);
+
+    Clock::time_point start = Clock::now();
+    late.net->start();
+    TableSnapshot got = late.net->tableSnapshot();
+    while (got.nextHeight < target.nextHeight && Clock::now() - start < std::chrono::seconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        got = late.net->tableSnapshot();
+    }
+    double joinMs = ms(Clock::now() - start);
+    bool seated = waitValidator(nodes[0], id, true, std::chrono::seconds(10));
+    double seatMs = ms(Clock::now() - start);
+
+    // Seating it took heights of its own; compare once both are at the same one
+    target = nodes[0].net->tableSnapshot();
+    got = late.net->tableSnapshot();
+    Clock::time_point settle = Clock::now();
+    while (got.nextHeight != target.nextHeight && Clock::now() - settle < std::chrono::seconds(2)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        target = nodes[0].net->tableSnapshot();
+        got = late.net->tableSnapshot();
+    }
+
+    SendStats after;
+    for (auto& node : nodes) {
+        after += node.net->sendStats();
+    }
+    bool same = got.nextHeight == target.nextHeight && got.lastValueId == target.lastValueId &&
+                got.deck == target.deck && got.seats.size() == target.seats.size();
+    for (size_t i = 0; same && i < got.seats.size(); i++) {
+        same = got.seats[i].playerId == target.seats[i].playerId &&
+               got.seats[i].stack == target.seats[i].stack;
+    }
+    std::printf("  late join           height %llu in %.1f ms, %llu bytes from the table%s\n",
+                static_cast<unsigned long long>(target.nextHeight), joinMs,
+                static_cast<unsigned long long>(after.bytes - before.bytes),
+                same ? "" : "  (STATE MISMATCH)");
+    if (seated) {
+        std::printf("  late join           validator after %.1f ms\n", seatMs);
+    } else {
+        std::printf("  late join           NOT SEATED as a validator within 10 s\n");
+    }
+    late.net.reset();
+    if (nodes.size() + 1 < 4) {
+        std::printf("  late join           left; %zu validators cannot decide without it\n",
+                    nodes.size());
+    } else if (waitValidator(nodes[0], id, false, std::chrono::seconds(30))) {
+        std::printf("  late join           still a validator 30 s after leaving\n");
+    }
+}
+
+// The last node dies without a word; reports how long until every other
+// node has decided to take it out of the validator set, and how long the
+// next action then takes to commit on the survivors.
+void crashLast(std::vector<Node>& nodes, CommitTracker& tracker, uint64_t& seq) {
+    int id = static_cast<int>(nodes.size());
+    Clock::time_point start = Clock::now();
+    nodes.back().engine.reset();
+    nodes.back().net.reset();
+    tracker.retireLast();
+
+    bool dropped = true;
+    for (size_t i = 0; i + 1 < nodes.size(); i++) {
+        dropped = dropped && !waitValidator(nodes[i], id, false, std::chrono::seconds(30));
+    }
+    double detectMs = ms(Clock::now() - start);
+
+    CommitEntry entry;
+    entry.playerId = 1;
+    entry.seq = seq++;
+    entry.phase = "PREFLOP";
+    entry.action = "BET";
+    entry.amount = 10;
+    tracker.submitted(entry.key());
+    nodes[0].net->submitAction(entry);
+    double first = 0;
+    double all = 0;
+    bool committed = tracker.wait(entry.key(), std::chrono::seconds(10), first, all);
+
+    if (!dropped) {
+        std::printf("  crash               node %d still a validator after 30 s\n", id);
+    } else if (!committed) {
+        std::printf("  crash               node %d dropped in %.0f ms, then STALLED\n", id, detectMs);
+    } else {
+        std::printf("  crash               node %d dropped in %.0f ms, next commit %.2f ms\n",
+                    id, detectMs, all);
+    }
+    nodes.pop_back();
+}
+
+// Commit latencies of one table's scripted actions
+struct TableRun {
+    std::vector<double> first;
+    std::vector<double> all;
+    size_t committed = 0;
+    bool stalled = false;
+};
+
+// One hand of betting: players act in turn, each waiting for the table to
+// commit the previous action, as in a betting round
+void bet(std::vector<Node>& nodes, CommitTracker& tracker, uint32_t table, int actionsPerHand,
+         uint64_t& seq, TableRun& run) {
+    static const char* const kPhases[] = {"PREFLOP", "FLOP", "TURN", "RIVER"};
+    int n = static_cast<int>(nodes.size());
+    for (int a = 0; a < actionsPerHand && !run.stalled; a++) {
+        int player = a % n;
+        CommitEntry entry;
+        entry.playerId = player + 1;
+        entry.seq = seq++;
+        entry.phase = kPhases[(a * 4 / actionsPerHand) % 4];
+        if (a + 1 < actionsPerHand) {
+            entry.action = "BET";
+            entry.amount = 10;
+        } else {
+            entry.action = "WIN";
+            entry.amount = 0;
+        }
+        tracker.submitted(entry.key());
+        nodes[player].net->submitAction(entry, table);
+
+        double first = 0;
+        double all = 0;
+        if (tracker.wait(entry.key(), std::chrono::seconds(10), first, all)) {
+            run.first.push_back(first);
+            run.all.push_back(all);
+            run.committed++;
+        } else {
+            // Lost votes are re-sent every round timeout, so this is a
+            // node that fell out of the table; later actions would only
+            // time out one by one
+            run.stalled = true;
+        }
+    }
+}
+
+void runTable(int n, const Options& opts) {
+    IoPool proxyPool(2);
+    proxyPool.start();
+    std::vector<Node> nodes(n);
+    std::mutex proxyMtx;
+    std::vector<std::shared_ptr<LinkProxy>> proxies;
+    std::map<std::pair<std::string, std::string>, int> proxyPorts;
+
+    // One proxy per pair of nodes, whichever rooms they share
+    RoomServer room([&](const std::string& joiner, const std::string& member) {
+        int index = std::stoi(member.substr(4)) - 1;
+        int port = nodes[index].net->listenPort();
+        if (opts.faulty()) {
+            std::lock_guard<std::mutex> lock(proxyMtx);
+            int& proxyPort = proxyPorts[std::make_pair(joiner, member)];
+            if (proxyPort == 0) {
+                auto proxy = std::make_shared<LinkProxy>(proxyPool, port, opts);
+                proxy->start();
+                proxies.push_back(proxy);
+                proxyPort = proxy->port();
+            }
+            port = proxyPort;
+        }
+        return "127.0.0.1:" + std::to_string(port);
+    });
+    int roomPort = room.start();
+
+    int tables = std::max(1, opts.tables);
+    std::vector<std::unique_ptr<CommitTracker>> trackers;
+    for (int t = 0; t < tables; t++) {
+        trackers.emplace_back(new CommitTracker(n));
+    }
+    CommitTracker& tracker = *trackers[0];
+    for (int i = 0; i < n; i++) {
+        Node& node = nodes[i];
+        node.net.reset(new NetworkManager(node.members, "node" + std::to_string(i + 1),
+                                          "127.0.0.1", roomPort, i + 1));
+        node.net->setPeerPort(0);
+        node.net->setIoThreads(opts.ioThreads);
+        if (tables > 1) {
+            // Votes and crypto of every table on one pool, as main.cpp does
+            node.workers.reset(new WorkerPool(opts.cryptoThreads));
+            node.net->setWorkerPool(*node.workers);
+        }
+        for (int t = 1; t < tables; t++) {
+            node.otherTables.emplace_back(new MembershipList());
+            node.net->addTable(t, "room" + std::to_string(t + 1), node.table(t));
+        }
+        for (int t = 0; t < tables; t++) {
+            CommitTracker* tableTracker = trackers[t].get();
+            node.net->setCommitHandler([tableTracker, i](uint64_t, const std::vector<CommitEntry>& batch) {
+                tableTracker->committed(i, batch);
+            }, t);
+        }
+        if (opts.crypto) {
+            node.engine.reset(node.workers ? new GameEngine(node.members, *node.workers)
+                                           : new GameEngine(node.members, opts.cryptoThreads));
+        }
+    }
+
+    // Handshakes: every pair connects once, the later joiner dialing out
+    Clock::time_point start = Clock::now();
+    for (auto& node : nodes) {
+        node.net->start();
+    }
+    bool meshed = true;
+    for (auto& node : nodes) {
+        for (int t = 0; t < tables; t++) {
+            MembershipList& members = node.table(t);
+            MembershipList::Snapshot snap = members.snapshot();
+            while (snap->size() < static_cast<size_t>(n - 1)) {
+                if (Clock::now() - start > std::chrono::seconds(30)) {
+                    meshed = false;
+                    break;
+                }
+                snap = members.waitForChange(snap->version, std::chrono::milliseconds(100));
+            }
+        }
+    }
+    double meshMs = ms(Clock::now() - start);
+    size_t links = static_cast<size_t>(n) * (n - 1) / 2;
+    // The table then decides to seat every node as a validator
+    bool seated = meshed;
+    for (auto& node : nodes) {
+        for (int t = 0; t < tables && seated; t++) {
+            while (node.net->validators(t).size() < static_cast<size_t>(n)) {
+                if (Clock::now() - start > std::chrono::seconds(30)) {
+                    seated = false;
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+    double seatMs = ms(Clock::now() - start);
+
+    std::printf("\n== %d nodes\n", n);
+    if (!meshed) {
+        std::printf("  mesh did not form within 30 s\n");
+    }
+    std::printf("  handshakes          %zu links in %.1f ms (%.0f links/s)\n",
+                links, meshMs, links / (meshMs / 1000.0));
+    if (seated) {
+        std::printf("  validators          %d seated in %.1f ms\n", n, seatMs);
+    } else if (meshed) {
+        std::printf("  validators          not all seated within 30 s\n");
+    }
+    if (tables > 1) {
+        size_t sockets = 0;
+        for (auto& node : nodes) {
+            sockets += node.net->connectionCount();
+        }
+        std::printf("  tables              %d per node over %.1f connections per node\n", tables,
+                    static_cast<double>(sockets) / n);
+    }
+
+    // Scripted hands on the first table; the others bet until it is done
+    int actionsPerHand = opts.actions > 0 ? opts.actions : 4 * n;
+    TableRun run;
+    std::vector<double> shuffleTimes;
+    std::vector<double> dealTimes;
+    bool decksOk = true;
+    uint64_t seq = 0;
+
+    std::atomic<bool> done(false);
+    std::vector<TableRun> otherRuns(tables - 1);
+    std::vector<std::thread> otherThreads;
+    for (int t = 1; t < tables; t++) {
+        otherThreads.emplace_back([&, t]() {
+            uint64_t tableSeq = 0;
+            TableRun& other = otherRuns[t - 1];
+            while (!done && !other.stalled) {
+                bet(nodes, *trackers[t], t, actionsPerHand, tableSeq, other);
+            }
+        });
+    }
+
+    for (int hand = 0; hand < opts.hands && !run.stalled; hand++) {
+        if (opts.crypto) {
+            double shuffleMs = 0;
+            double dealMs = 0;
+            decksOk = playDeck(nodes, static_cast<uint64_t>(hand), shuffleMs, dealMs) && decksOk;
+            shuffleTimes.push_back(shuffleMs);
+            dealTimes.push_back(dealMs);
+        }
+        bet(nodes, tracker, NetworkManager::DEFAULT_TABLE, actionsPerHand, seq, run);
+    }
+    done = true;
+    for (auto& thread : otherThreads) {
+        thread.join();
+    }
+
+    Percentiles first = percentiles(run.first);
+    Percentiles all = percentiles(run.all);
+    std::printf("  commit, first node  p50 %7.2f  p90 %7.2f  p99 %7.2f  max %7.2f ms\n",
+                first.p50, first.p90, first.p99, first.max);
+    std::printf("  commit, all nodes   p50 %7.2f  p90 %7.2f  p99 %7.2f  max %7.2f ms\n",
+                all.p50, all.p90, all.p99, all.max);
+    bool stalled = run.stalled;
+    if (run.stalled) {
+        std::printf("  STALLED: action %zu not committed by every node within 10 s\n",
+                    run.committed + 1);
+    }
+    for (int t = 1; t < tables; t++) {
+        const TableRun& other = otherRuns[t - 1];
+        Percentiles p = percentiles(other.all);
+        std::printf("  room%-2d, all nodes   p50 %7.2f  p90 %7.2f  p99 %7.2f  max %7.2f ms (%zu)%s\n",
+                    t + 1, p.p50, p.p90, p.p99, p.max, other.committed,
+                    other.stalled ? "  STALLED" : "");
+        stalled = stalled || other.stalled;
+    }
+    if (opts.crypto) {
+        Percentiles shuffle = percentiles(shuffleTimes);
+        Percentiles deal = percentiles(dealTimes);
+        std::printf("  shuffle + remask    p50 %9.1f ms  max %9.1f ms\n", shuffle.p50, shuffle.max);
+        std::printf("  deal hole cards     p50 %9.1f ms  max %9.1f ms%s\n", deal.p50, deal.max,
+                    decksOk ? "" : "  (DECODE MISMATCH)");
+    }
+
+    SendStats sent;
+    for (auto& node : nodes) {
+        sent += node.net->sendStats();
+    }
+    if (opts.lateJoin && !stalled) {
+        lateJoin(nodes, roomPort, opts, sent);
+    }
+    // Fewer than four validators tolerate no failure: the table would wait
+    // for the dead node forever
+    if (opts.crash && !stalled && n < 4) {
+        std::printf("  crash               skipped, %d validators tolerate no failure\n", n);
+    } else if (opts.crash && !stalled) {
+        crashLast(nodes, tracker, seq);
+    }
+    std::printf("  sent                %llu frames, %llu bytes, %llu syscalls\n",
+                static_cast<unsigned long long>(sent.frames),
+                static_cast<unsigned long long>(sent.bytes),
+                static_cast<unsigned long long>(sent.syscalls));
+
+    // Nodes first so their server readers see a clean shutdown
+    for (auto& node : nodes) {
+        node.engine.reset();
+        node.net.reset();
+        node.workers.reset();
+    }
+    for (auto& proxy : proxies) {
+        proxy->stop();
+    }
+    proxyPool.stop();
+    room.stop();
+}
+
+std::vector<int> parseList(const char* text) {
+    std::vector<int> values;
+    std::string s(text);
+    size_t pos = 0;
+    while (pos < s.size()) {
+        size_t comma = s.find(',', pos);
+        values.push_back(std::atoi(s.substr(pos, comma - pos).c_str()));
+        pos = comma == std::string::npos ? s.size() : comma + 1;
+    }
+    return values;
+}
+
+// Drops NetworkManager's per-commit logging while the table runs
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+        if (arg == "--nodes") {
+            opts.nodes = parseList(value);
+            i++;
+        } else if (arg == "--hands") {
+            opts.hands = std::atoi(value);
+            i++;
+        } else if (arg == "--actions") {
+            opts.actions = std::atoi(value);
+            i++;
+        } else if (arg == "--latency-ms") {
+            opts.latencyMs = std::atoi(value);
+            i++;
+        } else if (arg == "--jitter-ms") {
+            opts.jitterMs = std::atoi(value);
+            i++;
+        } else if (arg == "--loss") {
+            opts.loss = std::atof(value);
+            i++;
+        } else if (arg == "--reorder") {
+            opts.reorder = std::atof(value);
+            i++;
+        } else if (arg == "--io-threads") {
+            opts.ioThreads = std::strtoul(value, nullptr, 10);
+            i++;
+        } else if (arg == "--crypto-threads") {
+            opts.cryptoThreads = std::strtoul(value, nullptr, 10);
+            i++;
+        } else if (arg == "--no-crypto") {
+            opts.crypto = false;
+        } else if (arg == "--late-join") {
+            opts.lateJoin = true;
+        } else if (arg == "--crash") {
+            opts.crash = true;
+        } else if (arg == "--tables") {
+            opts.tables = std::atoi(value);
+            i++;
+        } else if (arg == "--metrics") {
+            opts.metrics = true;
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    std::printf("latency %d ms, jitter %d ms, loss %.2f, reorder %.2f, %d hands\n",
+                opts.latencyMs, opts.jitterMs, opts.loss, opts.reorder, opts.hands);
+
+    NullBuffer nullBuffer;
+    std::streambuf* original = std::cout.rdbuf(&nullBuffer);
+    for (int n : opts.nodes) {
+        if (n >= 2) {
+            runTable(n, opts);
+        }
+    }
+    std::cout.rdbuf(original);
+
+    if (opts.metrics) {
+        std::printf("\n== metrics, all tables\n");
+        std::fflush(stdout);
+        metrics::dumpText(std::cout);
+    }
+    return 0;
+}
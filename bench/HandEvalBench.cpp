@@ -0,0 +1,214 @@
+// bench/HandEvalBench.cpp
+// Hand evaluator throughput in hands/sec: single 5/6/7-card lookups, the
+// batch API, and Monte Carlo equity on the worker pool. Every run first
+// checks the category counts of all 2,598,960 five-card hands; --exhaustive
+// also checks all 133,784,560 seven-card ones.
+//
+//   HandEvalBench [--hands 5000000] [--trials 2000000] [--threads 0] [--exhaustive]
+#include "HandEvaluator.h"
+#include "WorkerPool.h"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+volatile uint64_t sink;
+
+const size_t CATEGORIES = 9;
+
+// Known category frequencies, high card .. straight flush
+const uint64_t FIVE_CARD_COUNTS[CATEGORIES] = {
+    1302540, 1098240, 123552, 54912, 10200, 5108, 3744, 624, 40};
+const uint64_t SEVEN_CARD_COUNTS[CATEGORIES] = {
+    23294460, 58627800, 31433400, 6461620, 6180020, 4047644, 3473184, 224848, 41584};
+
+double seconds(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(const char* name, size_t hands, double elapsed) {
+    std::printf("%-34s %8.1f M hands/s %8.2f ns/hand\n", name, hands / elapsed / 1e6,
+                elapsed * 1e9 / hands);
+}
+
+bool checkCounts(const char* label, const uint64_t* counts, const uint64_t* expected,
+                 uint64_t hands, double elapsed) {
+    bool ok = true;
+    for (size_t c = 0; c < CATEGORIES; c++) {
+        ok = ok && counts[c] == expected[c];
+    }
+    report(label, hands, elapsed);
+    for (size_t c = 0; c < CATEGORIES; c++) {
+        if (counts[c] != expected[c]) {
+            std::printf("   %-16s %10llu, expected %llu\n",
+                        HandEvaluator::categoryName(static_cast<HandCategory>(c)),
+                        static_cast<unsigned long long>(counts[c]),
+                        static_cast<unsigned long long>(expected[c]));
+        }
+    }
+    std::printf("   category counts %s\n", ok ? "match" : "MISMATCH");
+    return ok;
+}
+
+bool exhaustive5(const HandEvaluator& eval) {
+    uint64_t counts[CATEGORIES] = {};
+    uint64_t hands = 0;
+    auto start = Clock::now();
+    for (uint8_t a = 0; a < 52; a++)
+        for (uint8_t b = a + 1; b < 52; b++)
+            for (uint8_t c = b + 1; c < 52; c++)
+                for (uint8_t d = c + 1; d < 52; d++)
+                    for (uint8_t e = d + 1; e < 52; e++) {
+                        counts[eval.evaluate5(a, b, c, d, e) >> 20]++;
+                        hands++;
+                    }
+    return checkCounts("all 5-card hands", counts, FIVE_CARD_COUNTS, hands, seconds(start));
+}
+
+bool exhaustive7(const HandEvaluator& eval) {
+    uint64_t counts[CATEGORIES] = {};
+    uint64_t hands = 0;
+    uint8_t h[7];
+    auto start = Clock::now();
+    for (h[0] = 0; h[0] < 52; h[0]++)
+        for (h[1] = h[0] + 1; h[1] < 52; h[1]++)
+            for (h[2] = h[1] + 1; h[2] < 52; h[2]++)
+                for (h[3] = h[2] + 1; h[3] < 52; h[3]++)
+                    for (h[4] = h[3] + 1; h[4] < 52; h[4]++)
+                        for (h[5] = h[4] + 1; h[5] < 52; h[5]++)
+                            for (h[6] = h[5] + 1; h[6] < 52; h[6]++) {
+                                counts[eval.evaluate(h, 7) >> 20]++;
+                                hands++;
+                            }
+    return checkCounts("all 7-card hands", counts, SEVEN_CARD_COUNTS, hands, seconds(start));
+}
+
+// `hands` random deals of `cards` distinct cards, hand after hand
+std::vector<uint8_t> deal(size_t hands, size_t cards, std::mt19937& rng) {
+    std::vector<uint8_t> out(hands * cards);
+    std::array<uint8_t, 52> deck;
+    for (uint8_t i = 0; i < 52; i++) {
+        deck[i] = i;
+    }
+    for (size_t h = 0; h < hands; h++) {
+        for (size_t j = 0; j < cards; j++) {
+            std::uniform_int_distribution<size_t> pick(j, 51);
+            std::swap(deck[j], deck[pick(rng)]);
+            out[h * cards + j] = deck[j];
+        }
+    }
+    return out;
+}
+
+void benchSingle(const HandEvaluator& eval, size_t cards, size_t hands, std::mt19937& rng) {
+    std::vector<uint8_t> deals = deal(hands, cards, rng);
+    uint64_t sum = 0;
+    auto start = Clock::now();
+    for (size_t h = 0; h < hands; h++) {
+        sum += eval.evaluate(&deals[h * cards], cards);
+    }
+    double elapsed = seconds(start);
+    sink = sum;
+    char name[64];
+    std::snprintf(name, sizeof(name), "evaluate, %zu cards", cards);
+    report(name, hands, elapsed);
+}
+
+void benchBatch(const HandEvaluator& eval, size_t cards, size_t hands, std::mt19937& rng) {
+    std::vector<uint8_t> deals = deal(hands, cards, rng);
+    // Transpose to one column per card position
+    std::vector<uint8_t> columns(hands * cards);
+    for (size_t h = 0; h < hands; h++) {
+        for (size_t k = 0; k < cards; k++) {
+            columns[k * hands + h] = deals[h * cards + k];
+        }
+    }
+    std::vector<uint32_t> values(hands);
+    auto start = Clock::now();
+    eval.evaluateBatch(columns.data(), cards, hands, values.data());
+    double elapsed = seconds(start);
+
+    bool same = true;
+    for (size_t h = 0; h < hands; h++) {
+        same = same && values[h] == eval.evaluate(&deals[h * cards], cards);
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "evaluateBatch, %zu cards", cards);
+    report(name, hands, elapsed);
+    if (!same) {
+        std::printf("   batch results differ from evaluate()\n");
+    }
+}
+
+uint8_t card(int rank, int suit) {
+    return static_cast<uint8_t>(rank * 4 + suit);
+}
+
+void benchEquity(const HandEvaluator& eval, const char* label, const std::vector<HoleCards>& holes,
+                 const std::vector<uint8_t>& board, size_t trials, WorkerPool& pool) {
+    auto start = Clock::now();
+    EquityResult result = eval.equity(holes, board, trials, pool);
+    double elapsed = seconds(start);
+    report(label, trials * holes.size(), elapsed);
+    std::printf("   %.0f trials/s, equity", trials / elapsed);
+    for (double e : result.equity) {
+        std::printf(" %.4f", e);
+    }
+    std::printf(", ties %.4f\n", result.ties);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t hands = 5000000;
+    size_t trials = 2000000;
+    size_t threads = 0;
+    bool exhaustive = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--hands") == 0 && i + 1 < argc) {
+            hands = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--trials") == 0 && i + 1 < argc) {
+            trials = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--exhaustive") == 0) {
+            exhaustive = true;
+        } else {
+            std::fprintf(stderr, "usage: %s [--hands N] [--trials N] [--threads N] [--exhaustive]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+
+    auto start = Clock::now();
+    const HandEvaluator& eval = HandEvaluator::instance();
+    std::printf("tables built in %.1f ms\n", seconds(start) * 1e3);
+
+    bool ok = exhaustive5(eval);
+    if (exhaustive) {
+        ok = exhaustive7(eval) && ok;
+    }
+
+    std::mt19937 rng(42);
+    for (size_t cards = 5; cards <= 7; cards++) {
+        benchSingle(eval, cards, hands, rng);
+    }
+    benchBatch(eval, 7, hands, rng);
+
+    WorkerPool pool(threads);
+    std::printf("-- equity, %zu worker threads\n", pool.size());
+    benchEquity(eval, "AA vs KK preflop", {{card(12, 0), card(12, 1)}, {card(11, 2), card(11, 3)}},
+                {}, trials, pool);
+    benchEquity(eval, "AKs vs 22 vs T9s preflop",
+                {{card(12, 0), card(11, 0)}, {card(0, 1), card(0, 2)}, {card(8, 3), card(7, 3)}},
+                {}, trials, pool);
+    return ok ? 0 : 1;
+}
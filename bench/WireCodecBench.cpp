@@ -0,0 +1,181 @@
+// bench/WireCodecBench.cpp
+// Encode/decode cost per message: binary wire codec vs the jsoncpp path.
+#include "WireCodec.h"
+#include "Consensus.h"
+#include <json/json.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+
+static std::atomic<uint64_t> allocations{0};
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+volatile uint64_t sink;
+
+void run(const char* name, size_t iterations, const std::function<void()>& fn) {
+    for (size_t i = 0; i < iterations / 10; i++) {
+        fn();
+    }
+    uint64_t allocBefore = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    uint64_t allocs = allocations.load() - allocBefore;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::printf("%-34s %10.1f ns/msg %8.2f allocs/msg\n", name, ns,
+                static_cast<double>(allocs) / iterations);
+}
+
+ConsensusMessage makeVote() {
+    ConsensusMessage msg;
+    msg.type = ConsensusMessageType::PREVOTE;
+    msg.sender = 3;
+    msg.height = 1234;
+    msg.round = 1;
+    msg.valueId = "9f86d081884c7d65";
+    return msg;
+}
+
+ConsensusMessage makeProposal(size_t entries) {
+    ConsensusMessage msg;
+    msg.type = ConsensusMessageType::PROPOSAL;
+    msg.sender = 1;
+    msg.height = 1234;
+    msg.round = 0;
+    msg.validRound = -1;
+    msg.parentId = "2c26b46b68ffc68f";
+    for (size_t i = 0; i < entries; i++) {
+        CommitEntry e;
+        e.playerId = static_cast<int>(i % 4);
+        e.seq = 100 + i;
+        e.action = "RAISE";
+        e.phase = "FLOP";
+        e.amount = 50;
+        msg.entries.push_back(e);
+    }
+    msg.valueId = Consensus::computeValueId(msg.parentId, msg.entries);
+    return msg;
+}
+
+void benchMessage(const char* label, const ConsensusMessage& msg, size_t iterations) {
+    std::printf("-- %s\n", label);
+
+    std::string binary;
+    binary.reserve(4096);
+    run("binary encode", iterations, [&]() {
+        binary.clear();
+        wire::encodeConsensus(binary, msg);
+        sink = binary.size();
+    });
+    run("binary decode (views)", iterations, [&]() {
+        wire::FrameView frame;
+        wire::decode(binary.data(), binary.size(), frame);
+        wire::EntryCursor cursor = frame.entries();
+        wire::EntryView e;
+        uint64_t sum = frame.height + frame.valueId.size();
+        while (cursor.next(e)) {
+            sum += e.amount;
+        }
+        sink = sum;
+    });
+    ConsensusMessage decoded;
+    run("binary decode -> ConsensusMessage", iterations, [&]() {
+        wire::FrameView frame;
+        wire::decode(binary.data(), binary.size(), frame);
+        frame.toConsensusMessage(decoded);
+        sink = decoded.height;
+    });
+    // As the peer read path does it: a fresh message per frame, since each
+    // one is handed on to the verifier workers
+    run("binary decode -> fresh message", iterations, [&]() {
+        wire::FrameView frame;
+        wire::decode(binary.data(), binary.size(), frame);
+        ConsensusMessage fresh;
+        frame.toConsensusMessage(fresh);
+        sink = fresh.height;
+    });
+
+    std::string json = Json::FastWriter().write(msg.toJson());
+    run("jsoncpp encode", iterations, [&]() {
+        Json::FastWriter writer;
+        std::string data = writer.write(msg.toJson());
+        sink = data.size();
+    });
+    run("jsoncpp decode -> ConsensusMessage", iterations, [&]() {
+        Json::Value root;
+        Json::Reader reader;
+        reader.parse(json, root);
+        ConsensusMessage out;
+        ConsensusMessage::fromJson(root, out);
+        sink = out.height;
+    });
+    std::printf("   frame size: binary %zu bytes, json %zu bytes\n", binary.size(), json.size());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+
+    std::printf("-- HELLO\n");
+    std::string hello;
+    hello.reserve(64);
+    run("binary encode", iterations, [&]() {
+        hello.clear();
+        wire::encodeHello(hello, 7);
+        sink = hello.size();
+    });
+    run("binary decode", iterations, [&]() {
+        wire::FrameView frame;
+        wire::decode(hello.data(), hello.size(), frame);
+        sink = frame.sender;
+    });
+    std::string helloJson = "{\"node_id\":7,\"type\":\"HELLO\"}\n";
+    run("jsoncpp decode", iterations, [&]() {
+        Json::Value root;
+        Json::Reader reader;
+        reader.parse(helloJson, root);
+        sink = root["type"].asString().size() + root["node_id"].asInt();
+    });
+
+    // Once per connection and table, so the handshake keeps owned copies
+    std::printf("-- WELCOME\n");
+    std::string welcome;
+    wire::encodeWelcome(welcome, 7, 1234, 0, std::string(32, 'k'), std::string(32, 'n'),
+                        std::string(64, 's'));
+    run("binary decode", iterations, [&]() {
+        wire::FrameView frame;
+        wire::decode(welcome.data(), welcome.size(), frame);
+        sink = frame.publicKey.size() + frame.nonce.size() + frame.signature.size();
+    });
+    run("binary decode -> owned fields", iterations, [&]() {
+        wire::FrameView frame;
+        wire::decode(welcome.data(), welcome.size(), frame);
+        std::string publicKey(frame.publicKey);
+        std::string nonce(frame.nonce);
+        std::string signature(frame.signature);
+        sink = publicKey.size() + nonce.size() + signature.size();
+    });
+
+    benchMessage("PREVOTE", makeVote(), iterations);
+    benchMessage("PROPOSAL (8 entries)", makeProposal(8), iterations / 4);
+    return 0;
+}
@@ -1,27 +1,99 @@
 #include <iostream>
-#include <thread>
 #include <chrono>
+#include <stdexcept>
 #include "GameEngine.h"
 #include "MembershipList.h"
 
 // Remove the class definition and just implement the methods
-GameEngine::GameEngine(MembershipList& list) : membershipList(list) {}
+GameEngine::GameEngine(MembershipList& list, size_t cryptoThreads)
+    : membershipList(list),
+      workers(cryptoThreads),
+      deckCrypto(workers),
+      handPool(deckCrypto) {
+    // Start filling while the network is still connecting
+    handPool.start();
+}
+
+GameEngine::GameEngine(MembershipList& list, WorkerPool& sharedWorkers)
+    : membershipList(list),
+      workers(sharedWorkers),
+      deckCrypto(workers),
+      handPool(deckCrypto) {
+    handPool.start();
+}
 
 void GameEngine::runGame() {
+    uint64_t seenVersion = 0;
     while (true) {
-        // Get the latest membership list
-        std::vector<std::string> members = membershipList.getMembers();
+        // Wake up as soon as the room changes; the timeout only paces
+        // whatever game logic runs between membership changes
+        MembershipList::Snapshot room =
+            membershipList.waitForChange(seenVersion, std::chrono::seconds(2));
 
-        // Display the current members
-        std::cout << "Current room members: ";
-        for (const auto& member : members) {
-            std::cout << member << " ";
+        if (room->version != seenVersion) {
+            seenVersion = room->version;
+            std::cout << "Current room members: ";
+            for (const auto& member : room->members) {
+                std::cout << member << " ";
+            }
+            std::cout << std::endl;
         }
-        std::cout << std::endl;
 
-        // Game logic (e.g., deal cards, manage turns) goes here...
+        // Hands are not played from here yet: the deck protocol below needs
+        // decks carried from player to player, which the network does not
+        // do. ClusterBench drives it with the decks handed over in process.
+    }
+}
+
+void GameEngine::startHand() {
+    hand = handPool.acquire();
+}
+
+const HandMaterial& GameEngine::currentHand() const {
+    if (!hand) {
+        throw std::logic_error("deck protocol turn before startHand()");
+    }
+    return *hand;
+}
+
+std::vector<DeckCrypto::Card> GameEngine::shuffleDeck(std::vector<DeckCrypto::Card> deck) {
+    const HandMaterial& h = currentHand();
+    deckCrypto.encryptAndShuffle(deck, h.handKey.encrypt, h.permutation);
+    return deck;
+}
 
-        // Sleep to simulate game processing
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+std::vector<DeckCrypto::Card> GameEngine::lockDeck(std::vector<DeckCrypto::Card> deck) {
+    const HandMaterial& h = currentHand();
+    deckCrypto.remask(deck, h.handKey.decrypt, h.cardKeys);
+    return deck;
+}
+
+const DeckCrypto::Card& GameEngine::cardKey(size_t position) const {
+    return currentHand().cardKeys.at(position).decrypt;
+}
+
+std::vector<size_t> GameEngine::showdown(const std::vector<HoleCards>& holes,
+                                         const std::vector<uint8_t>& board) const {
+    if (board.size() != 5) {
+        throw std::invalid_argument("showdown needs all five board cards");
+    }
+    const HandEvaluator& evaluator = HandEvaluator::instance();
+    std::vector<size_t> winners;
+    uint32_t best = 0;
+    for (size_t p = 0; p < holes.size(); p++) {
+        uint32_t value = evaluator.evaluate7(holes[p], board.data());
+        if (value > best) {
+            best = value;
+            winners.clear();
+        }
+        if (value == best) {
+            winners.push_back(p);
+        }
     }
-}
\ No newline at end of file
+    return winners;
+}
+
+EquityResult GameEngine::equity(const std::vector<HoleCards>& holes,
+                                const std::vector<uint8_t>& board, size_t trials) {
+    return HandEvaluator::instance().equity(holes, board, trials, workers);
+}
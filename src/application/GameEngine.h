@@ -1,12 +1,50 @@
 // src/application/GameEngine.h
 #pragma once
 #include "MembershipList.h"
+#include "WorkerPool.h"
+#include "DeckCrypto.h"
+#include "HandMaterialPool.h"
+#include "HandEvaluator.h"
+#include <memory>
+#include <vector>
 
 class GameEngine {
 private:
     MembershipList& membershipList;
+    WorkerPool workers;
+    DeckCrypto deckCrypto;
+    HandMaterialPool handPool;
+
+    // This player's secrets for the current hand
+    std::unique_ptr<HandMaterial> hand;
+
+    // Throws std::logic_error before the first startHand()
+    const HandMaterial& currentHand() const;
 
 public:
-    explicit GameEngine(MembershipList& list);
+    explicit GameEngine(MembershipList& list, size_t cryptoThreads = 0);
+    // Crypto runs on a lane of a pool shared with the other tables of this process
+    GameEngine(MembershipList& list, WorkerPool& sharedWorkers);
     void runGame();
-};
\ No newline at end of file
+
+    // This player's turns in the deck protocol, in order, after startHand().
+    // Each one takes the deck as passed on by the previous player and
+    // returns it for the next.
+    void startHand();
+    std::vector<DeckCrypto::Card> shuffleDeck(std::vector<DeckCrypto::Card> deck);
+    std::vector<DeckCrypto::Card> lockDeck(std::vector<DeckCrypto::Card> deck);
+    // Our decryption key for one dealt position, shared when it is revealed
+    const DeckCrypto::Card& cardKey(size_t position) const;
+
+    // Players (indices into holes) whose best hand with the five board cards
+    // wins the pot; more than one is a split. Throws std::invalid_argument
+    // unless the board is complete.
+    std::vector<size_t> showdown(const std::vector<HoleCards>& holes,
+                                 const std::vector<uint8_t>& board) const;
+    // All-in equity for the table display and the test bots, on the crypto workers
+    EquityResult equity(const std::vector<HoleCards>& holes,
+                        const std::vector<uint8_t>& board, size_t trials = 100000);
+
+    DeckCrypto& crypto() { return deckCrypto; }
+    HandPoolStats handPoolStats() const { return handPool.stats(); }
+};
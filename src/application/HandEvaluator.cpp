@@ -0,0 +1,383 @@
+// src/application/HandEvaluator.cpp
+#include "HandEvaluator.h"
+#include <algorithm>
+#include <cassert>
+#include <initializer_list>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+const int RANKS = 13;
+const uint32_t RANK_MASK = (1u << RANKS) - 1;
+const uint8_t NO_FLUSH = 4 * RANKS;   // shifts past every suit's ranks to an empty mask
+const size_t TRIALS_PER_CHUNK = 4096;
+const size_t TRIALS_PER_BLOCK = 64;
+
+// category << 20 | up to five deciding ranks, 4 bits each, most significant first
+uint32_t pack(HandCategory category, std::initializer_list<int> ranks) {
+    uint32_t value = static_cast<uint32_t>(category) << 20;
+    int shift = 16;
+    for (int r : ranks) {
+        value |= static_cast<uint32_t>(r) << shift;
+        shift -= 4;
+    }
+    return value;
+}
+
+// Highest rank of a five-card run in the 13-bit mask (the wheel counts as 5-high), or -1
+int straightHigh(uint32_t mask) {
+    for (int high = RANKS - 1; high >= 4; high--) {
+        uint32_t run = 0x1Fu << (high - 4);
+        if ((mask & run) == run) {
+            return high;
+        }
+    }
+    uint32_t wheel = (1u << 12) | 0xFu;
+    return (mask & wheel) == wheel ? 3 : -1;
+}
+
+// Highest n ranks of the mask, best first; missing ones are 0
+std::array<int, 5> topRanks(uint32_t mask, int n) {
+    std::array<int, 5> out{};
+    int found = 0;
+    for (int r = RANKS - 1; r >= 0 && found < n; r--) {
+        if (mask & (1u << r)) {
+            out[found++] = r;
+        }
+    }
+    return out;
+}
+
+// Best hand that ignores suits, from the number of cards of each rank
+uint32_t bestOfCounts(const uint8_t* counts) {
+    int quads = -1;
+    int trips[2] = {-1, -1};
+    int pairs[3] = {-1, -1, -1};
+    uint32_t present = 0;
+    for (int r = RANKS - 1; r >= 0; r--) {
+        if (counts[r] > 0) {
+            present |= 1u << r;
+        }
+        if (counts[r] == 4) {
+            quads = r;
+        } else if (counts[r] == 3) {
+            (trips[0] < 0 ? trips[0] : trips[1]) = r;
+        } else if (counts[r] == 2) {
+            for (int& p : pairs) {
+                if (p < 0) {
+                    p = r;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (quads >= 0) {
+        return pack(HandCategory::FOUR_OF_A_KIND, {quads, topRanks(present & ~(1u << quads), 1)[0]});
+    }
+    if (trips[0] >= 0 && (trips[1] >= 0 || pairs[0] >= 0)) {
+        return pack(HandCategory::FULL_HOUSE, {trips[0], std::max(trips[1], pairs[0])});
+    }
+    int high = straightHigh(present);
+    if (high >= 0) {
+        return pack(HandCategory::STRAIGHT, {high});
+    }
+    if (trips[0] >= 0) {
+        auto k = topRanks(present & ~(1u << trips[0]), 2);
+        return pack(HandCategory::THREE_OF_A_KIND, {trips[0], k[0], k[1]});
+    }
+    if (pairs[1] >= 0) {
+        auto k = topRanks(present & ~(1u << pairs[0]) & ~(1u << pairs[1]), 1);
+        return pack(HandCategory::TWO_PAIR, {pairs[0], pairs[1], k[0]});
+    }
+    if (pairs[0] >= 0) {
+        auto k = topRanks(present & ~(1u << pairs[0]), 3);
+        return pack(HandCategory::PAIR, {pairs[0], k[0], k[1], k[2]});
+    }
+    auto k = topRanks(present, 5);
+    return pack(HandCategory::HIGH_CARD, {k[0], k[1], k[2], k[3], k[4]});
+}
+
+// Best flush or straight flush among the ranks of one suit; 0 below five cards
+uint32_t bestOfSuit(uint32_t mask) {
+    if (__builtin_popcount(mask) < 5) {
+        return 0;
+    }
+    int high = straightHigh(mask);
+    if (high >= 0) {
+        return pack(HandCategory::STRAIGHT_FLUSH, {high});
+    }
+    auto k = topRanks(mask, 5);
+    return pack(HandCategory::FLUSH, {k[0], k[1], k[2], k[3], k[4]});
+}
+
+// Number of ways to put `cards` cards on `ranks` ranks, at most four per rank
+uint32_t combinations(int ranks, int cards) {
+    if (cards == 0) {
+        return 1;
+    }
+    if (ranks == 0 || cards < 0) {
+        return 0;
+    }
+    uint32_t total = 0;
+    for (int c = 0; c <= 4 && c <= cards; c++) {
+        total += combinations(ranks - 1, cards - c);
+    }
+    return total;
+}
+
+// Calls fn once for every way to spread `left` cards over ranks [rank, 13)
+template <typename Fn>
+void forEachMultiset(uint8_t* counts, int rank, int left, Fn& fn) {
+    if (rank == RANKS) {
+        if (left == 0) {
+            fn();
+        }
+        return;
+    }
+    for (int c = 0; c <= 4 && c <= left; c++) {
+        counts[rank] = static_cast<uint8_t>(c);
+        forEachMultiset(counts, rank + 1, left - c, fn);
+    }
+    counts[rank] = 0;
+}
+
+uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+struct Tally {
+    std::vector<double> equity;
+    std::vector<uint64_t> wins;
+    uint64_t ties = 0;
+};
+
+} // namespace
+
+const HandEvaluator& HandEvaluator::instance() {
+    static const HandEvaluator evaluator;
+    return evaluator;
+}
+
+HandEvaluator::HandEvaluator() : flushTable(1u << RANKS) {
+    // Rank multisets hash to their lexicographic position among all multisets
+    // with the same number of cards: a rank holding c cards skips the
+    // multisets that hold fewer there.
+    for (int c = 0; c <= 4; c++) {
+        for (int left = 0; left < RANKS; left++) {
+            for (size_t k = 0; k <= MAX_CARDS; k++) {
+                uint32_t offset = 0;
+                for (int j = 0; j < c && j <= static_cast<int>(k); j++) {
+                    offset += combinations(left, static_cast<int>(k) - j);
+                }
+                dp[c][left][k] = offset;
+            }
+        }
+    }
+
+    for (size_t cards = 5; cards <= MAX_CARDS; cards++) {
+        rankTables[cards].resize(combinations(RANKS, static_cast<int>(cards)));
+        uint8_t counts[RANKS] = {};
+        auto fill = [&] {
+            uint64_t packed = 0;
+            for (int r = 0; r < RANKS; r++) {
+                packed |= uint64_t(counts[r]) << (4 * r);
+            }
+            rankTables[cards][rankHash(packed, cards)] = bestOfCounts(counts);
+        };
+        forEachMultiset(counts, 0, static_cast<int>(cards), fill);
+    }
+
+    for (uint32_t mask = 0; mask < flushTable.size(); mask++) {
+        flushTable[mask] = bestOfSuit(mask);
+    }
+    for (uint32_t suits = 0; suits < flushShift.size(); suits++) {
+        flushShift[suits] = NO_FLUSH;
+        for (uint8_t s = 0; s < 4; s++) {
+            if (((suits >> (3 * s)) & 7) >= 5) {
+                flushShift[suits] = static_cast<uint8_t>(RANKS * s);
+            }
+        }
+    }
+}
+
+uint32_t HandEvaluator::rankHash(uint64_t rankCounts, size_t cards) const {
+    uint32_t hash = 0;
+    for (int r = 0; r < RANKS; r++) {
+        size_t count = (rankCounts >> (4 * r)) & 0xF;
+        hash += dp[count][RANKS - 1 - r][cards];
+        cards -= count;
+    }
+    return hash;
+}
+
+// Precondition: 5 <= count <= MAX_CARDS distinct cards
+uint32_t HandEvaluator::evaluate(const uint8_t* cards, size_t count) const {
+    assert(count >= 5 && count <= MAX_CARDS);
+    uint64_t rankCounts = 0;   // 4 bits per rank
+    uint64_t suitRanks = 0;    // 13 bits per suit
+    uint32_t suits = 0;        // 3 bits per suit
+    for (size_t i = 0; i < count; i++) {
+        uint32_t rank = cards[i] >> 2;
+        uint32_t suit = cards[i] & 3;
+        rankCounts += uint64_t(1) << (4 * rank);
+        suitRanks |= uint64_t(1) << (RANKS * suit + rank);
+        suits += 1u << (3 * suit);
+    }
+    uint32_t ranked = rankTables[count][rankHash(rankCounts, count)];
+    uint32_t flushed = flushTable[(suitRanks >> flushShift[suits]) & RANK_MASK];
+    return std::max(ranked, flushed);
+}
+
+uint32_t HandEvaluator::evaluate5(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint8_t e) const {
+    uint8_t cards[5] = {a, b, c, d, e};
+    return evaluate(cards, 5);
+}
+
+uint32_t HandEvaluator::evaluate7(const HoleCards& hole, const uint8_t* board) const {
+    uint8_t cards[7] = {hole[0], hole[1], board[0], board[1], board[2], board[3], board[4]};
+    return evaluate(cards, 7);
+}
+
+void HandEvaluator::evaluateBatch(const uint8_t* columns, size_t cardsPerHand, size_t hands,
+                                  uint32_t* out) const {
+    assert(cardsPerHand >= 5 && cardsPerHand <= MAX_CARDS);
+    uint8_t cards[MAX_CARDS];
+    for (size_t i = 0; i < hands; i++) {
+        for (size_t k = 0; k < cardsPerHand; k++) {
+            cards[k] = columns[k * hands + i];
+        }
+        out[i] = evaluate(cards, cardsPerHand);
+    }
+}
+
+const char* HandEvaluator::categoryName(HandCategory category) {
+    switch (category) {
+        case HandCategory::HIGH_CARD:       return "high card";
+        case HandCategory::PAIR:            return "pair";
+        case HandCategory::TWO_PAIR:        return "two pair";
+        case HandCategory::THREE_OF_A_KIND: return "three of a kind";
+        case HandCategory::STRAIGHT:        return "straight";
+        case HandCategory::FLUSH:           return "flush";
+        case HandCategory::FULL_HOUSE:      return "full house";
+        case HandCategory::FOUR_OF_A_KIND:  return "four of a kind";
+        case HandCategory::STRAIGHT_FLUSH:  return "straight flush";
+    }
+    return "unknown";
+}
+
+EquityResult HandEvaluator::equity(const std::vector<HoleCards>& holes,
+                                   const std::vector<uint8_t>& board,
+                                   size_t trials, WorkerPool& pool, uint64_t seed) const {
+    const size_t players = holes.size();
+    if (players < 2 || board.size() > 5) {
+        throw std::invalid_argument("equity needs two or more players and at most five board cards");
+    }
+    bool used[52] = {};
+    auto take = [&used](uint8_t card) {
+        if (card >= 52 || used[card]) {
+            throw std::invalid_argument("equity: card out of range or dealt twice");
+        }
+        used[card] = true;
+    };
+    for (const auto& hole : holes) {
+        take(hole[0]);
+        take(hole[1]);
+    }
+    for (uint8_t card : board) {
+        take(card);
+    }
+    std::vector<uint8_t> stub;
+    for (uint8_t card = 0; card < 52; card++) {
+        if (!used[card]) {
+            stub.push_back(card);
+        }
+    }
+    const size_t draw = 5 - board.size();
+    if (stub.size() < draw) {
+        throw std::invalid_argument("equity: not enough cards left to complete the board");
+    }
+
+    // Fixed-size chunks with their own seeded generators, so the split over
+    // threads does not change the draws
+    size_t chunks = (trials + TRIALS_PER_CHUNK - 1) / TRIALS_PER_CHUNK;
+    std::vector<Tally> tallies(chunks);
+    pool.parallelFor(chunks, [&](size_t chunk) {
+        Tally& tally = tallies[chunk];
+        tally.equity.assign(players, 0.0);
+        tally.wins.assign(players, 0);
+        std::mt19937_64 rng(splitmix64(seed ^ splitmix64(chunk)));
+        std::vector<uint8_t> deck = stub;
+
+        // One column per card position, one lane per (trial, player)
+        std::vector<uint8_t> columns(7 * TRIALS_PER_BLOCK * players);
+        std::vector<uint32_t> values(TRIALS_PER_BLOCK * players);
+        size_t first = chunk * TRIALS_PER_CHUNK;
+        size_t last = std::min(trials, first + TRIALS_PER_CHUNK);
+
+        for (size_t start = first; start < last; start += TRIALS_PER_BLOCK) {
+            size_t count = std::min(TRIALS_PER_BLOCK, last - start);
+            size_t hands = count * players;
+            for (size_t t = 0; t < count; t++) {
+                uint8_t runout[5];
+                std::copy(board.begin(), board.end(), runout);
+                // Partial Fisher-Yates: the first `draw` cards become a fresh sample
+                for (size_t j = 0; j < draw; j++) {
+                    uint64_t span = deck.size() - j;
+                    size_t pick = j + static_cast<size_t>(((rng() >> 32) * span) >> 32);
+                    std::swap(deck[j], deck[pick]);
+                    runout[board.size() + j] = deck[j];
+                }
+                for (size_t p = 0; p < players; p++) {
+                    size_t lane = t * players + p;
+                    columns[lane] = holes[p][0];
+                    columns[hands + lane] = holes[p][1];
+                    for (size_t k = 0; k < 5; k++) {
+                        columns[(2 + k) * hands + lane] = runout[k];
+                    }
+                }
+            }
+            evaluateBatch(columns.data(), 7, hands, values.data());
+
+            for (size_t t = 0; t < count; t++) {
+                const uint32_t* row = values.data() + t * players;
+                uint32_t best = *std::max_element(row, row + players);
+                size_t winners = static_cast<size_t>(std::count(row, row + players, best));
+                double share = 1.0 / static_cast<double>(winners);
+                for (size_t p = 0; p < players; p++) {
+                    if (row[p] == best) {
+                        tally.equity[p] += share;
+                        tally.wins[p] += winners == 1;
+                    }
+                }
+                tally.ties += winners > 1;
+            }
+        }
+    });
+
+    EquityResult result;
+    result.equity.assign(players, 0.0);
+    result.wins.assign(players, 0.0);
+    result.trials = trials;
+    uint64_t ties = 0;
+    for (const Tally& tally : tallies) {
+        for (size_t p = 0; p < players; p++) {
+            result.equity[p] += tally.equity[p];
+            result.wins[p] += static_cast<double>(tally.wins[p]);
+        }
+        ties += tally.ties;
+    }
+    if (trials > 0) {
+        double n = static_cast<double>(trials);
+        for (size_t p = 0; p < players; p++) {
+            result.equity[p] /= n;
+            result.wins[p] /= n;
+        }
+        result.ties = static_cast<double>(ties) / n;
+    }
+    return result;
+}
@@ -0,0 +1,83 @@
+// src/application/HandEvaluator.h
+#pragma once
+#include "WorkerPool.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Cards are 0..51 as DeckCrypto::decode returns them: rank * 4 + suit, rank
+// 0 = deuce .. 12 = ace.
+using HoleCards = std::array<uint8_t, 2>;
+
+enum class HandCategory : uint8_t {
+    HIGH_CARD,
+    PAIR,
+    TWO_PAIR,
+    THREE_OF_A_KIND,
+    STRAIGHT,
+    FLUSH,
+    FULL_HOUSE,
+    FOUR_OF_A_KIND,
+    STRAIGHT_FLUSH
+};
+
+struct EquityResult {
+    std::vector<double> equity;   // per player: wins plus split shares, 0..1
+    std::vector<double> wins;     // outright wins, 0..1
+    double ties = 0;              // share of boards that split the pot
+    uint64_t trials = 0;
+};
+
+// Best-5-of-n poker hand strength for 5, 6 or 7 cards by table lookup.
+//
+// A hand splits into two independent lookups whose maximum is the answer:
+// the rank multiset (pairs up to quads, straights, high cards) through a
+// perfect hash of its per-rank counts, and the 13-bit rank mask of whichever
+// suit holds five or more cards (flushes, straight flushes). A hand without
+// a flush suit looks up the empty mask, which scores 0, so no path depends
+// on the cards and the loops have fixed trip counts. Each card only adds
+// into three per-hand words (rank counts, ranks by suit, cards by suit).
+//
+// Values compare directly: higher is better, equal is a split. The tables
+// (~330 KB) are built once, on first use.
+class HandEvaluator {
+public:
+    static const size_t MAX_CARDS = 7;
+
+    static const HandEvaluator& instance();
+
+    uint32_t evaluate(const uint8_t* cards, size_t count) const;
+    uint32_t evaluate5(uint8_t a, uint8_t b, uint8_t c, uint8_t d, uint8_t e) const;
+    uint32_t evaluate7(const HoleCards& hole, const uint8_t* board) const;
+
+    // Evaluates `hands` hands of cardsPerHand cards each, laid out by card
+    // position: columns[k * hands + i] is card k of hand i. Runs the scalar
+    // path hand by hand; the rank hash is a chain of dependent table loads,
+    // and lane-wise blocks of it measured slower than this.
+    void evaluateBatch(const uint8_t* columns, size_t cardsPerHand, size_t hands,
+                       uint32_t* out) const;
+
+    static HandCategory category(uint32_t value) { return static_cast<HandCategory>(value >> 20); }
+    static const char* categoryName(HandCategory category);
+
+    // Monte Carlo all-in equity: the board is completed `trials` times at
+    // random from the cards nobody holds and every player's best hand is
+    // compared. Trials are split over the pool; a given seed gives the same
+    // result for any pool size.
+    EquityResult equity(const std::vector<HoleCards>& holes, const std::vector<uint8_t>& board,
+                        size_t trials, WorkerPool& pool, uint64_t seed = 1) const;
+
+private:
+    HandEvaluator();
+
+    // rankCounts holds 4 bits per rank
+    uint32_t rankHash(uint64_t rankCounts, size_t cards) const;
+
+    // dp[count][ranks left][cards left]: hash offset of putting `count`
+    // cards on the next rank
+    uint32_t dp[5][13][MAX_CARDS + 1];
+    std::vector<uint32_t> rankTables[MAX_CARDS + 1];   // by number of cards
+    std::vector<uint32_t> flushTable;                    // by 13-bit rank mask
+    std::array<uint8_t, 4096> flushShift;                // by 3-bit-per-suit counts; 52 = none
+};
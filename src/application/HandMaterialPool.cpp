@@ -0,0 +1,96 @@
+// src/application/HandMaterialPool.cpp
+#include "HandMaterialPool.h"
+#include "Metrics.h"
+#include <chrono>
+
+HandMaterialPool::HandMaterialPool(const DeckCrypto& deckCrypto, size_t capacity)
+    : crypto(deckCrypto),
+      ready(capacity),
+      target(capacity),
+      running(false),
+      hits(0),
+      misses(0),
+      produced(0) {}
+
+HandMaterialPool::~HandMaterialPool() {
+    stop();
+    discardAll();
+}
+
+void HandMaterialPool::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    producer = std::thread(&HandMaterialPool::producerLoop, this);
+}
+
+void HandMaterialPool::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMtx);
+    }
+    wake.notify_all();
+    producer.join();
+}
+
+std::unique_ptr<HandMaterial> HandMaterialPool::acquire() {
+    HandMaterial* material = nullptr;
+    if (ready.tryPop(material)) {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        wake.notify_one();
+        return std::unique_ptr<HandMaterial>(material);
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    wake.notify_one();
+    std::lock_guard<std::mutex> lock(inlineMtx);
+    return generate(inlineRng);
+}
+
+HandPoolStats HandMaterialPool::stats() const {
+    HandPoolStats s;
+    s.hits = hits.load(std::memory_order_relaxed);
+    s.misses = misses.load(std::memory_order_relaxed);
+    s.produced = produced.load(std::memory_order_relaxed);
+    s.ready = ready.size();
+    s.capacity = target;
+    return s;
+}
+
+std::unique_ptr<HandMaterial> HandMaterialPool::generate(SecureRandom& rng) const {
+    METRIC_TIMER(timer, metrics::CRYPTO_HAND_MATERIAL_NS);
+    std::unique_ptr<HandMaterial> material(new HandMaterial);
+    material->handKey = crypto.generateKey(rng);
+    material->cardKeys = crypto.generateKeys(DeckCrypto::DECK_SIZE, rng);
+    material->permutation = crypto.randomPermutation(DeckCrypto::DECK_SIZE, rng);
+    return material;
+}
+
+// Tops the stock up to target, then sleeps until a consumer takes one.
+// Consumers notify without the lock, so the wait also times out now and
+// then rather than trusting every wakeup to arrive.
+void HandMaterialPool::producerLoop() {
+    SecureRandom rng;
+    while (running.load()) {
+        if (ready.size() < target) {
+            std::unique_ptr<HandMaterial> material = generate(rng);
+            if (ready.tryPush(material.get())) {
+                material.release();
+                produced.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wakeMtx);
+        wake.wait_for(lock, std::chrono::milliseconds(100), [this]() {
+            return !running.load() || ready.size() < target;
+        });
+    }
+}
+
+void HandMaterialPool::discardAll() {
+    HandMaterial* material = nullptr;
+    while (ready.tryPop(material)) {
+        delete material;
+    }
+}
@@ -0,0 +1,67 @@
+// src/application/HandMaterialPool.h
+#pragma once
+#include "DeckCrypto.h"
+#include "LockFreeRing.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Everything one player draws from the entropy source for one hand
+struct HandMaterial {
+    DeckCrypto::KeyPair handKey;                // shuffle pass
+    std::vector<DeckCrypto::KeyPair> cardKeys;  // remask pass, one per position
+    std::vector<size_t> permutation;
+};
+
+struct HandPoolStats {
+    uint64_t hits = 0;       // acquire() served from the pool
+    uint64_t misses = 0;     // acquire() had to generate inline
+    uint64_t produced = 0;   // made by the background thread
+    size_t ready = 0;
+    size_t capacity = 0;
+};
+
+// Keeps a bounded stock of HandMaterial generated ahead of time by a
+// background thread, so starting a hand does not stall on ~53 modular
+// exponentiations. acquire() pops lock-free; when the stock is empty it
+// falls back to generating on the caller's thread and counts a miss.
+class HandMaterialPool {
+public:
+    static const size_t DEFAULT_CAPACITY = 4;
+
+    HandMaterialPool(const DeckCrypto& crypto, size_t capacity = DEFAULT_CAPACITY);
+    ~HandMaterialPool();
+
+    HandMaterialPool(const HandMaterialPool&) = delete;
+    HandMaterialPool& operator=(const HandMaterialPool&) = delete;
+
+    void start();
+    void stop();
+
+    std::unique_ptr<HandMaterial> acquire();
+    HandPoolStats stats() const;
+
+private:
+    void producerLoop();
+    std::unique_ptr<HandMaterial> generate(SecureRandom& rng) const;
+    void discardAll();
+
+    const DeckCrypto& crypto;
+    LockFreeRing<HandMaterial*> ready;
+    size_t target;
+
+    std::thread producer;
+    std::atomic<bool> running;
+    std::mutex wakeMtx;
+    std::condition_variable wake;
+    SecureRandom inlineRng;      // miss path; guarded by inlineMtx
+    std::mutex inlineMtx;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> produced;
+};
@@ -1,33 +1,181 @@
-#include <vector>
-#include <string>
-#include <mutex>
-#include <algorithm>  // Add this for std::find
+#include "MembershipList.h"
+#include <algorithm>
+#include <stdexcept>
 
-class MembershipList {
-private:
-    std::vector<std::string> members;
-    std::mutex mtx;
+namespace {
 
-public:
-    void updateMembers(const std::vector<std::string>& newMembers) {
-        std::lock_guard<std::mutex> lock(mtx);
-        members = newMembers;
+MembershipList::Snapshot build(uint64_t version, std::vector<std::string> members) {
+    auto snap = std::make_shared<MembershipSnapshot>();
+    snap->version = version;
+    snap->members = std::move(members);
+    snap->index.reserve(snap->members.size());
+    for (size_t i = 0; i < snap->members.size(); i++) {
+        snap->index.emplace(snap->members[i], i);
+        try {
+            size_t used = 0;
+            int id = std::stoi(snap->members[i], &used);
+            if (used == snap->members[i].size()) {
+                snap->nodeIds.push_back(id);
+                snap->nodeIdSet.insert(id);
+            }
+        } catch (const std::exception&) {
+            // not a node id, e.g. a hostname from the room server
+        }
     }
+    std::sort(snap->nodeIds.begin(), snap->nodeIds.end());
+    snap->nodeIds.erase(std::unique(snap->nodeIds.begin(), snap->nodeIds.end()),
+                        snap->nodeIds.end());
+    return snap;
+}
+
+std::atomic<uint64_t> nextInstanceId{1};
+
+// Per thread, the snapshot last loaded from a few lists, by instance id
+struct CachedSnapshot {
+    uint64_t list = 0;
+    MembershipList::Snapshot snap;
+};
+const size_t CACHED_LISTS = 4;
 
-    std::vector<std::string> getMembers() {
-        std::lock_guard<std::mutex> lock(mtx);
-        return members;
+} // namespace
+
+MembershipList::MembershipList()
+    : current(build(0, {})),
+      currentVersion(0),
+      instanceId(nextInstanceId.fetch_add(1, std::memory_order_relaxed)),
+      nextListenerId(1),
+      notifying(0) {}
+
+MembershipList::Snapshot MembershipList::snapshot() const {
+    thread_local CachedSnapshot cache[CACHED_LISTS];
+    CachedSnapshot& slot = cache[instanceId % CACHED_LISTS];
+    if (slot.list == instanceId &&
+        slot.snap->version == currentVersion.load(std::memory_order_acquire)) {
+        return slot.snap;
     }
+    Snapshot snap = std::atomic_load(&current);
+    slot.list = instanceId;
+    slot.snap = snap;
+    return snap;
+}
+
+// Caller holds writeMtx, which is released before the listeners run
+MembershipList::Snapshot MembershipList::publish(std::vector<std::string> members) {
+    Snapshot next = build(snapshot()->version + 1, std::move(members));
+    std::atomic_store(&current, next);
+    currentVersion.store(next->version, std::memory_order_release);
 
-    void addMember(const std::string& member) {
-        std::lock_guard<std::mutex> lock(mtx);
-        if (std::find(members.begin(), members.end(), member) == members.end()) {
-            members.push_back(member);
+    {
+        std::lock_guard<std::mutex> lock(waitMtx);
+    }
+    changed.notify_all();
+    return next;
+}
+
+// Listeners are copied out and called with no lock held: they take locks
+// of their own (Consensus does) and may write to the list again.
+void MembershipList::notify(const Snapshot& snap) {
+    std::vector<std::shared_ptr<Listener>> targets;
+    {
+        std::lock_guard<std::mutex> lock(listenerMtx);
+        targets.reserve(listeners.size());
+        for (const auto& entry : listeners) {
+            targets.push_back(entry.second);
         }
+        notifying++;
+    }
+    for (const auto& listener : targets) {
+        (*listener)(snap);
     }
+    {
+        std::lock_guard<std::mutex> lock(listenerMtx);
+        notifying--;
+    }
+    notified.notify_all();
+}
 
-    bool isMember(const std::string& member) {
-        std::lock_guard<std::mutex> lock(mtx);
-        return std::find(members.begin(), members.end(), member) != members.end();
+void MembershipList::updateMembers(const std::vector<std::string>& newMembers) {
+    Snapshot next;
+    {
+        std::lock_guard<std::mutex> lock(writeMtx);
+        std::vector<std::string> members;
+        std::unordered_set<std::string> seen;
+        for (const auto& member : newMembers) {
+            if (seen.insert(member).second) {
+                members.push_back(member);
+            }
+        }
+        if (members == snapshot()->members) {
+            return;
+        }
+        next = publish(std::move(members));
     }
-};
+    notify(next);
+}
+
+std::vector<std::string> MembershipList::getMembers() {
+    return snapshot()->members;
+}
+
+void MembershipList::addMember(const std::string& member) {
+    Snapshot next;
+    {
+        std::lock_guard<std::mutex> lock(writeMtx);
+        Snapshot snap = snapshot();
+        if (snap->contains(member)) {
+            return;
+        }
+        std::vector<std::string> members = snap->members;
+        members.push_back(member);
+        next = publish(std::move(members));
+    }
+    notify(next);
+}
+
+void MembershipList::removeMember(const std::string& member) {
+    Snapshot next;
+    {
+        std::lock_guard<std::mutex> lock(writeMtx);
+        Snapshot snap = snapshot();
+        auto it = snap->index.find(member);
+        if (it == snap->index.end()) {
+            return;
+        }
+        std::vector<std::string> members = snap->members;
+        members.erase(members.begin() + static_cast<std::ptrdiff_t>(it->second));
+        next = publish(std::move(members));
+    }
+    notify(next);
+}
+
+bool MembershipList::isMember(const std::string& member) {
+    return snapshot()->contains(member);
+}
+
+int MembershipList::subscribe(Listener listener) {
+    std::lock_guard<std::mutex> lock(listenerMtx);
+    int id = nextListenerId++;
+    listeners.emplace_back(id, std::make_shared<Listener>(std::move(listener)));
+    return id;
+}
+
+// Waits for notifications in progress, so the listener is not running once
+// this returns.
+void MembershipList::unsubscribe(int id) {
+    std::unique_lock<std::mutex> lock(listenerMtx);
+    listeners.erase(std::remove_if(listeners.begin(), listeners.end(),
+                                   [id](const std::pair<int, std::shared_ptr<Listener>>& entry) {
+                                       return entry.first == id;
+                                   }),
+                    listeners.end());
+    notified.wait(lock, [this]() { return notifying == 0; });
+}
+
+MembershipList::Snapshot MembershipList::waitForChange(uint64_t seenVersion,
+                                                      std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(waitMtx);
+    changed.wait_for(lock, timeout, [this, seenVersion]() {
+        return snapshot()->version != seenVersion;
+    });
+    return snapshot();
+}
@@ -1,20 +1,86 @@
 #ifndef MEMBERSHIPLIST_H
 #define MEMBERSHIPLIST_H
 
-#include <vector>
-#include <string>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
-class MembershipList {
-private:
-    std::vector<std::string> members;
-    std::mutex mtx;
+// One immutable version of the room. Never modified after it is published,
+// so any number of threads can hold and read it without locking.
+struct MembershipSnapshot {
+    uint64_t version = 0;
+    std::vector<std::string> members;                // join order
+    std::unordered_map<std::string, size_t> index;   // member -> position
+    std::vector<int> nodeIds;                        // numeric members, sorted
+    std::unordered_set<int> nodeIdSet;
+
+    bool contains(const std::string& member) const { return index.count(member) != 0; }
+    bool hasNode(int id) const { return nodeIdSet.count(id) != 0; }
+    size_t size() const { return members.size(); }
+};
 
+// Room membership published RCU-style: writers build a fresh snapshot and
+// swap the pointer, readers take the current one and keep it as long as
+// they like. Writers are serialized among themselves; subscribers are told
+// about every new version after it has been published.
+//
+// std::atomic_load on a shared_ptr takes a lock from a small global pool in
+// libstdc++, and std::atomic<std::shared_ptr> needs C++20. So each thread
+// keeps the snapshot it last loaded from a list, and snapshot() reloads only
+// once the list's published version has moved on: a read that finds nothing
+// new is an atomic load and a reference count increment. A thread holds on
+// to one old snapshot per list it read until it reads that list again.
+class MembershipList {
 public:
+    using Snapshot = std::shared_ptr<const MembershipSnapshot>;
+    using Listener = std::function<void(const Snapshot&)>;
+
+    MembershipList();
+
+    Snapshot snapshot() const;
+    uint64_t version() const { return snapshot()->version; }
+
     void updateMembers(const std::vector<std::string>& newMembers);
     std::vector<std::string> getMembers();
     void addMember(const std::string& member);
+    void removeMember(const std::string& member);
     bool isMember(const std::string& member);
+
+    // Listeners run on the writer's thread with no lock held, so two
+    // writers may notify at once and a listener may see versions out of
+    // order. They must not unsubscribe from inside the callback.
+    int subscribe(Listener listener);
+    void unsubscribe(int id);
+
+    // Blocks until the version differs from seenVersion or the timeout
+    // passes; returns the current snapshot either way.
+    Snapshot waitForChange(uint64_t seenVersion, std::chrono::milliseconds timeout);
+
+private:
+    Snapshot publish(std::vector<std::string> members);
+    void notify(const Snapshot& snap);
+
+    Snapshot current;             // accessed with std::atomic_load/store
+    std::atomic<uint64_t> currentVersion;   // stored after current
+    const uint64_t instanceId;    // keys the per-thread cache; never reused
+    std::mutex writeMtx;
+
+    std::mutex listenerMtx;
+    std::vector<std::pair<int, std::shared_ptr<Listener>>> listeners;
+    int nextListenerId;
+    int notifying;                // notify() calls running listeners
+    std::condition_variable notified;
+
+    std::mutex waitMtx;
+    std::condition_variable changed;
 };
 
 #endif // MEMBERSHIPLIST_H
@@ -0,0 +1,283 @@
+// src/application/Metrics.cpp
+#include "Metrics.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace metrics {
+
+namespace {
+
+const char* const kCounterNames[COUNTER_COUNT] = {
+    "frames_in",
+    "frames_malformed",
+    "handler_errors",
+    "handshakes_completed",
+    "handshakes_failed",
+    "handshakes_expired",
+    "consensus_round_changes",
+    "consensus_heights_decided",
+    "votes_verified",
+    "votes_rejected",
+    "probes_sent",
+    "probes_indirect",
+    "members_suspected",
+    "members_failed",
+};
+
+// Everything not listed here is a duration in ns
+const char* unitOf(Histogram histogram) {
+    switch (histogram) {
+        case SEND_QUEUE_BYTES: return "bytes";
+        case LOG_SYNC_BATCH: return "records";
+        case VERIFY_BATCH: return "signatures";
+        default: return "ns";
+    }
+}
+
+inline bool isDuration(Histogram histogram) {
+    return unitOf(histogram)[0] == 'n';
+}
+
+#if MENTALPOKER_METRICS
+
+// Written only by its owning thread, read by collect(): relaxed atomics
+// keep the reads well-defined without making the writes any dearer.
+struct Slab {
+    struct Hist {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+        std::atomic<uint64_t> buckets[BUCKETS] = {};
+    };
+    std::atomic<uint64_t> counters[COUNTER_COUNT] = {};
+    Hist histograms[HISTOGRAM_COUNT];
+};
+
+inline void bump(std::atomic<uint64_t>& v, uint64_t n) {
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void accumulate(Snapshot& into, const Slab& slab) {
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        into.counters[c] += slab.counters[c].load(std::memory_order_relaxed);
+    }
+    for (size_t h = 0; h < HISTOGRAM_COUNT; h++) {
+        const Slab::Hist& src = slab.histograms[h];
+        HistogramSnapshot& dst = into.histograms[h];
+        dst.count += src.count.load(std::memory_order_relaxed);
+        dst.sum += src.sum.load(std::memory_order_relaxed);
+        uint64_t max = src.max.load(std::memory_order_relaxed);
+        if (max > dst.max) {
+            dst.max = max;
+        }
+        for (size_t b = 0; b < BUCKETS; b++) {
+            dst.buckets[b] += src.buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Leaked on purpose: threads may exit (and retire their slabs) during
+// static destruction.
+struct Registry {
+    std::mutex mtx;
+    std::vector<Slab*> live;
+    Snapshot retired;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+struct ThreadSlab {
+    Slab* slab;
+
+    ThreadSlab() : slab(new Slab) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        r.live.push_back(slab);
+    }
+
+    ~ThreadSlab() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mtx);
+        accumulate(r.retired, *slab);
+        for (auto it = r.live.begin(); it != r.live.end(); ++it) {
+            if (*it == slab) {
+                r.live.erase(it);
+                break;
+            }
+        }
+        delete slab;
+    }
+};
+
+Slab& local() {
+    thread_local ThreadSlab mine;
+    return *mine.slab;
+}
+
+#endif
+
+} // namespace
+
+#if MENTALPOKER_METRICS
+
+void add(Counter counter, uint64_t n) {
+    bump(local().counters[counter], n);
+}
+
+void record(Histogram histogram, uint64_t value) {
+    Slab::Hist& h = local().histograms[histogram];
+    size_t bucket = value == 0 ? 0 : 64 - static_cast<size_t>(__builtin_clzll(value));
+    if (bucket >= BUCKETS) {
+        bucket = BUCKETS - 1;
+    }
+    bump(h.count, 1);
+    bump(h.sum, value);
+    bump(h.buckets[bucket], 1);
+    if (value > h.max.load(std::memory_order_relaxed)) {
+        h.max.store(value, std::memory_order_relaxed);
+    }
+}
+
+Snapshot collect() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mtx);
+    Snapshot snap = r.retired;
+    for (const Slab* slab : r.live) {
+        accumulate(snap, *slab);
+    }
+    return snap;
+}
+
+#else
+
+Snapshot collect() {
+    return Snapshot();
+}
+
+#endif
+
+uint64_t HistogramSnapshot::percentile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count));
+    if (rank >= count) {
+        rank = count - 1;
+    }
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen > rank) {
+            uint64_t upper = b == 0 ? 0 : (uint64_t(1) << b) - 1;
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+const char* counterName(Counter counter) {
+    return counter < COUNTER_COUNT ? kCounterNames[counter] : "unknown";
+}
+
+const char* histogramName(Histogram histogram) {
+    static const char* const kDecode[MESSAGE_SLOTS] = {
+        "decode.json", "decode.hello", "decode.welcome", "decode.action",
+        "decode.proposal", "decode.prevote", "decode.precommit", "decode.cards",
+        "decode.sync", "decode.state", "decode.decided", "decode.commit",
+        "decode.ping", "decode.ack", "decode.ping_req", "decode.auth",
+    };
+    static const char* const kHandle[MESSAGE_SLOTS] = {
+        "handle.json", "handle.hello", "handle.welcome", "handle.action",
+        "handle.proposal", "handle.prevote", "handle.precommit", "handle.cards",
+        "handle.sync", "handle.state", "handle.decided", "handle.commit",
+        "handle.ping", "handle.ack", "handle.ping_req", "handle.auth",
+    };
+    if (histogram >= DECODE_NS && histogram < DECODE_NS + MESSAGE_SLOTS) {
+        return kDecode[histogram - DECODE_NS];
+    }
+    if (histogram >= HANDLE_NS && histogram < HANDLE_NS + MESSAGE_SLOTS) {
+        return kHandle[histogram - HANDLE_NS];
+    }
+    switch (histogram) {
+        case HANDSHAKE_NS: return "handshake";
+        case SEND_QUEUE_BYTES: return "send_queue_bytes";
+        case CONSENSUS_PROPOSE_NS: return "consensus.propose";
+        case CONSENSUS_PREVOTE_NS: return "consensus.prevote";
+        case CONSENSUS_PRECOMMIT_NS: return "consensus.precommit";
+        case CONSENSUS_HEIGHT_NS: return "consensus.height";
+        case CRYPTO_ENCRYPT_NS: return "crypto.encrypt";
+        case CRYPTO_SHUFFLE_NS: return "crypto.shuffle";
+        case CRYPTO_REMASK_NS: return "crypto.remask";
+        case CRYPTO_APPLY_KEYS_NS: return "crypto.apply_keys";
+        case CRYPTO_HAND_MATERIAL_NS: return "crypto.hand_material";
+        case LOG_SYNC_NS: return "log.sync";
+        case LOG_SYNC_BATCH: return "log.sync_batch";
+        case VERIFY_NS: return "votes.verify";
+        case VERIFY_BATCH: return "votes.verify_batch";
+        default: return "unknown";
+    }
+}
+
+void dumpText(std::ostream& out) {
+#if MENTALPOKER_METRICS
+    Snapshot snap = collect();
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        if (snap.counters[c] != 0) {
+            out << counterName(static_cast<Counter>(c)) << " " << snap.counters[c] << "\n";
+        }
+    }
+    for (size_t i = 0; i < HISTOGRAM_COUNT; i++) {
+        Histogram h = static_cast<Histogram>(i);
+        const HistogramSnapshot& hs = snap.histograms[i];
+        if (hs.count == 0) {
+            continue;
+        }
+        // Durations are kept in ns and shown in us
+        double scale = isDuration(h) ? 1000.0 : 1.0;
+        out << histogramName(h) << " (" << (isDuration(h) ? "us" : unitOf(h)) << ")"
+            << " count=" << hs.count
+            << " mean=" << hs.mean() / scale
+            << " p50=" << hs.percentile(0.50) / scale
+            << " p90=" << hs.percentile(0.90) / scale
+            << " p99=" << hs.percentile(0.99) / scale
+            << " max=" << hs.max / scale << "\n";
+    }
+#else
+    out << "metrics disabled at build time\n";
+#endif
+}
+
+Json::Value toJson() {
+    Json::Value root(Json::objectValue);
+    Snapshot snap = collect();
+    Json::Value& counters = root["counters"];
+    counters = Json::Value(Json::objectValue);
+    for (size_t c = 0; c < COUNTER_COUNT; c++) {
+        counters[counterName(static_cast<Counter>(c))] = Json::UInt64(snap.counters[c]);
+    }
+    Json::Value& histograms = root["histograms"];
+    histograms = Json::Value(Json::objectValue);
+    for (size_t i = 0; i < HISTOGRAM_COUNT; i++) {
+        Histogram h = static_cast<Histogram>(i);
+        const HistogramSnapshot& hs = snap.histograms[i];
+        if (hs.count == 0) {
+            continue;
+        }
+        Json::Value entry;
+        entry["unit"] = unitOf(h);
+        entry["count"] = Json::UInt64(hs.count);
+        entry["sum"] = Json::UInt64(hs.sum);
+        entry["max"] = Json::UInt64(hs.max);
+        entry["p50"] = Json::UInt64(hs.percentile(0.50));
+        entry["p90"] = Json::UInt64(hs.percentile(0.90));
+        entry["p99"] = Json::UInt64(hs.percentile(0.99));
+        histograms[histogramName(h)] = entry;
+    }
+    return root;
+}
+
+} // namespace metrics
@@ -0,0 +1,136 @@
+// src/application/Metrics.h
+#pragma once
+#include <json/json.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Hot-path instrumentation: counters and fixed-bucket histograms kept per
+// thread, so recording is a couple of relaxed stores with no sharing between
+// threads. collect() sums every thread's slab into one Snapshot.
+//
+// Build with MENTALPOKER_METRICS=0 (CMake option MENTALPOKER_METRICS=OFF)
+// and the METRIC_* macros compile to nothing.
+#ifndef MENTALPOKER_METRICS
+#define MENTALPOKER_METRICS 1
+#endif
+
+namespace metrics {
+
+enum Counter : uint16_t {
+    FRAMES_IN,
+    FRAMES_MALFORMED,
+    HANDLER_ERRORS,
+    HANDSHAKES_COMPLETED,
+    HANDSHAKES_FAILED,
+    HANDSHAKES_EXPIRED,
+    CONSENSUS_ROUND_CHANGES,
+    CONSENSUS_HEIGHTS_DECIDED,
+    VOTES_VERIFIED,
+    VOTES_REJECTED,
+    PROBES_SENT,
+    PROBES_INDIRECT,
+    MEMBERS_SUSPECTED,
+    MEMBERS_FAILED,
+    COUNTER_COUNT
+};
+
+// Per-message-type ranges are indexed by wire::MessageType; slot 0 is the
+// JSON compatibility path.
+const size_t MESSAGE_SLOTS = 16;
+
+enum Histogram : uint16_t {
+    HANDSHAKE_NS,
+    DECODE_NS,
+    HANDLE_NS = DECODE_NS + MESSAGE_SLOTS,
+    SEND_QUEUE_BYTES = HANDLE_NS + MESSAGE_SLOTS,
+    CONSENSUS_PROPOSE_NS,
+    CONSENSUS_PREVOTE_NS,
+    CONSENSUS_PRECOMMIT_NS,
+    CONSENSUS_HEIGHT_NS,
+    CRYPTO_ENCRYPT_NS,
+    CRYPTO_SHUFFLE_NS,
+    CRYPTO_REMASK_NS,
+    CRYPTO_APPLY_KEYS_NS,
+    CRYPTO_HAND_MATERIAL_NS,
+    LOG_SYNC_NS,
+    LOG_SYNC_BATCH,            // records made durable by one sync
+    VERIFY_NS,                 // one signature batch
+    VERIFY_BATCH,              // signatures checked per batch
+    HISTOGRAM_COUNT
+};
+
+// Bucket b counts values v with 2^(b-1) <= v < 2^b (bucket 0 is v == 0)
+const size_t BUCKETS = 48;
+
+inline Histogram decodeHistogram(unsigned type) {
+    return static_cast<Histogram>(DECODE_NS + (type < MESSAGE_SLOTS ? type : 0));
+}
+
+inline Histogram handleHistogram(unsigned type) {
+    return static_cast<Histogram>(HANDLE_NS + (type < MESSAGE_SLOTS ? type : 0));
+}
+
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    uint64_t buckets[BUCKETS] = {};
+
+    // Upper bound of the bucket holding the q-th value (capped at max)
+    uint64_t percentile(double q) const;
+    double mean() const { return count ? static_cast<double>(sum) / count : 0.0; }
+};
+
+struct Snapshot {
+    uint64_t counters[COUNTER_COUNT] = {};
+    HistogramSnapshot histograms[HISTOGRAM_COUNT];
+};
+
+const char* counterName(Counter counter);
+const char* histogramName(Histogram histogram);
+
+Snapshot collect();
+// One line per non-empty metric; durations are printed in microseconds
+void dumpText(std::ostream& out);
+Json::Value toJson();
+
+#if MENTALPOKER_METRICS
+
+void add(Counter counter, uint64_t n = 1);
+void record(Histogram histogram, uint64_t value);
+
+inline uint64_t elapsedNs(std::chrono::steady_clock::time_point since) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - since).count());
+}
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram h) : histogram(h), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { record(histogram, elapsedNs(start)); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif
+
+} // namespace metrics
+
+#if MENTALPOKER_METRICS
+#define METRIC_COUNT(counter) ::metrics::add(::metrics::counter)
+#define METRIC_RECORD(histogram, value) ::metrics::record(histogram, value)
+#define METRIC_SINCE(histogram, start) ::metrics::record(histogram, ::metrics::elapsedNs(start))
+#define METRIC_TIMER(name, histogram) ::metrics::ScopedTimer name(histogram)
+#else
+#define METRIC_COUNT(counter) ((void)0)
+#define METRIC_RECORD(histogram, value) ((void)sizeof((histogram), (value), 0))
+#define METRIC_SINCE(histogram, start) ((void)sizeof((histogram), (start), 0))
+#define METRIC_TIMER(name, histogram) ((void)0)
+#endif
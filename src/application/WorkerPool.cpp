@@ -0,0 +1,125 @@
+// src/application/WorkerPool.cpp
+#include "WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+// Helpers may start after the caller has finished every item, so the shared
+// state outlives parallelFor; fn is only touched for claimed items.
+struct WorkerPool::Batch {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    size_t count = 0;
+    const std::function<void(size_t)>* fn = nullptr;
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    // Claims and runs one item; false once there are none left
+    bool runOne() {
+        size_t i = next.fetch_add(1);
+        if (i >= count) {
+            return false;
+        }
+        (*fn)(i);
+        if (done.fetch_add(1) + 1 == count) {
+            std::lock_guard<std::mutex> lock(mtx);
+            cv.notify_all();
+        }
+        return true;
+    }
+};
+
+WorkerPool::WorkerPool(size_t threads) : shared(std::make_shared<Shared>()), owner(true) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        shared->workers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::WorkerPool(WorkerPool& parent) : shared(parent.shared), owner(false) {}
+
+WorkerPool::~WorkerPool() {
+    if (!owner) {
+        std::unique_lock<std::mutex> lock(shared->mtx);
+        shared->idle.wait(lock, [this]() { return lane.tasks.empty() && lane.running == 0; });
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(shared->mtx);
+        shared->stopping = true;
+    }
+    shared->cv.notify_all();
+    for (auto& worker : shared->workers) {
+        worker.join();
+    }
+}
+
+void WorkerPool::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(shared->mtx);
+        lane.tasks.push_back(std::move(task));
+        if (!lane.queued) {
+            lane.queued = true;
+            shared->ready.push_back(&lane);
+        }
+    }
+    shared->cv.notify_one();
+}
+
+// Runs on the owning pool's threads for every lane
+void WorkerPool::workerLoop() {
+    Shared& s = *shared;
+    std::unique_lock<std::mutex> lock(s.mtx);
+    while (true) {
+        s.cv.wait(lock, [&s]() { return s.stopping || !s.ready.empty(); });
+        if (s.ready.empty()) {
+            return;   // stopping, and every queued task has run
+        }
+        Lane* next = s.ready.front();
+        s.ready.pop_front();
+        std::function<void()> task = std::move(next->tasks.front());
+        next->tasks.pop_front();
+        if (next->tasks.empty()) {
+            next->queued = false;
+        } else {
+            s.ready.push_back(next);
+        }
+        next->running++;
+
+        lock.unlock();
+        task();
+        task = nullptr;
+        lock.lock();
+
+        if (--next->running == 0 && next->tasks.empty()) {
+            s.idle.notify_all();
+        }
+    }
+}
+
+void WorkerPool::help(std::shared_ptr<Batch> batch) {
+    if (batch->runOne() && batch->next.load() < batch->count) {
+        post([this, batch]() { help(batch); });
+    }
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) {
+        return;
+    }
+    auto batch = std::make_shared<Batch>();
+    batch->count = count;
+    batch->fn = &fn;
+
+    size_t helpers = std::min(size(), count - 1);
+    for (size_t i = 0; i < helpers; i++) {
+        post([this, batch]() { help(batch); });
+    }
+    while (batch->runOne()) {
+    }
+
+    std::unique_lock<std::mutex> lock(batch->mtx);
+    batch->cv.wait(lock, [&batch]() { return batch->done.load() == batch->count; });
+}
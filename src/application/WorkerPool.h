@@ -0,0 +1,64 @@
+// src/application/WorkerPool.h
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for CPU-heavy batches (card crypto, equity
+// runs). parallelFor lets the calling thread work alongside the pool, so it
+// also makes progress when every worker is busy.
+//
+// A pool built from another one is a lane of it: it runs on the parent's
+// threads but keeps its own queue, and the threads take one task from each
+// lane with work in turn. Each table gets its own lanes, so one table's
+// shuffle queues behind its own work rather than in front of another
+// table's votes. Lanes must go before the pool they were made from.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads = 0);
+    explicit WorkerPool(WorkerPool& parent);
+    // The owning pool finishes every queued task; a lane waits for its own
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void post(std::function<void()> task);
+
+    // Runs fn(i) for every i in [0, count) and returns when all are done.
+    // Helpers re-queue after each item, so a long batch takes its turn with
+    // the other lanes instead of holding the threads.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    size_t size() const { return shared->workers.size(); }
+
+private:
+    struct Lane {
+        std::deque<std::function<void()>> tasks;
+        size_t running = 0;
+        bool queued = false;    // in Shared::ready
+    };
+
+    struct Shared {
+        std::vector<std::thread> workers;
+        std::deque<Lane*> ready;            // lanes with tasks, served round robin
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::condition_variable idle;       // a lane ran out of work
+        bool stopping = false;
+    };
+
+    struct Batch;
+
+    void workerLoop();
+    void help(std::shared_ptr<Batch> batch);
+
+    std::shared_ptr<Shared> shared;
+    Lane lane;
+    bool owner;
+};
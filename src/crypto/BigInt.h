@@ -0,0 +1,127 @@
+// src/crypto/BigInt.h
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// Fixed-width unsigned integer of N 64-bit limbs (least significant first).
+// Only what the modular arithmetic needs; the carry/borrow primitives have no
+// data-dependent branches.
+template <size_t N>
+struct UInt {
+    static constexpr size_t LIMBS = N;
+    static constexpr size_t BITS = 64 * N;
+    static constexpr size_t BYTES = 8 * N;
+
+    std::array<uint64_t, N> limb{};
+
+    static UInt fromU64(uint64_t v) {
+        UInt r;
+        r.limb[0] = v;
+        return r;
+    }
+
+    // Big-endian hex; whitespace is skipped.
+    static UInt fromHex(const std::string& hex) {
+        UInt r;
+        size_t bit = 0;
+        for (size_t i = hex.size(); i-- > 0;) {
+            char c = hex[i];
+            uint64_t v;
+            if (c >= '0' && c <= '9') v = c - '0';
+            else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+            else continue;
+            if (bit >= BITS) {
+                throw std::out_of_range("hex value wider than UInt");
+            }
+            r.limb[bit / 64] |= v << (bit % 64);
+            bit += 4;
+        }
+        return r;
+    }
+
+    // Big-endian bytes, at most BYTES of them.
+    static UInt fromBytes(const uint8_t* data, size_t len) {
+        if (len > BYTES) {
+            throw std::out_of_range("byte string wider than UInt");
+        }
+        UInt r;
+        for (size_t i = 0; i < len; i++) {
+            size_t byte = len - 1 - i;
+            r.limb[byte / 8] |= static_cast<uint64_t>(data[i]) << (8 * (byte % 8));
+        }
+        return r;
+    }
+
+    // Writes exactly BYTES big-endian bytes.
+    void toBytes(uint8_t* out) const {
+        for (size_t i = 0; i < BYTES; i++) {
+            size_t byte = BYTES - 1 - i;
+            out[i] = static_cast<uint8_t>(limb[byte / 8] >> (8 * (byte % 8)));
+        }
+    }
+
+    bool isZero() const {
+        uint64_t acc = 0;
+        for (uint64_t l : limb) acc |= l;
+        return acc == 0;
+    }
+
+    bool isOdd() const { return limb[0] & 1; }
+
+    unsigned bit(size_t i) const { return static_cast<unsigned>((limb[i / 64] >> (i % 64)) & 1); }
+
+    unsigned nibble(size_t i) const { return static_cast<unsigned>((limb[i / 16] >> (4 * (i % 16))) & 0xF); }
+
+    // r = a + b, returns the carry out
+    static uint64_t add(UInt& r, const UInt& a, const UInt& b) {
+        unsigned __int128 carry = 0;
+        for (size_t i = 0; i < N; i++) {
+            carry += static_cast<unsigned __int128>(a.limb[i]) + b.limb[i];
+            r.limb[i] = static_cast<uint64_t>(carry);
+            carry >>= 64;
+        }
+        return static_cast<uint64_t>(carry);
+    }
+
+    // r = a + (mask ? b : 0), mask being all ones or all zeros
+    static uint64_t addMasked(UInt& r, const UInt& a, const UInt& b, uint64_t mask) {
+        unsigned __int128 carry = 0;
+        for (size_t i = 0; i < N; i++) {
+            carry += static_cast<unsigned __int128>(a.limb[i]) + (b.limb[i] & mask);
+            r.limb[i] = static_cast<uint64_t>(carry);
+            carry >>= 64;
+        }
+        return static_cast<uint64_t>(carry);
+    }
+
+    // r = a - b, returns the borrow out (1 if a < b)
+    static uint64_t sub(UInt& r, const UInt& a, const UInt& b) {
+        uint64_t borrow = 0;
+        for (size_t i = 0; i < N; i++) {
+            unsigned __int128 d = static_cast<unsigned __int128>(a.limb[i]) - b.limb[i] - borrow;
+            r.limb[i] = static_cast<uint64_t>(d);
+            borrow = static_cast<uint64_t>(d >> 64) & 1;
+        }
+        return borrow;
+    }
+
+    // r = mask ? a : b, mask being all ones or all zeros
+    static void select(UInt& r, uint64_t mask, const UInt& a, const UInt& b) {
+        for (size_t i = 0; i < N; i++) {
+            r.limb[i] = (a.limb[i] & mask) | (b.limb[i] & ~mask);
+        }
+    }
+
+    bool operator==(const UInt& other) const { return limb == other.limb; }
+    bool operator!=(const UInt& other) const { return limb != other.limb; }
+
+    bool operator<(const UInt& other) const {
+        UInt scratch;
+        return sub(scratch, *this, other) != 0;
+    }
+    bool operator>=(const UInt& other) const { return !(*this < other); }
+};
@@ -0,0 +1,179 @@
+// src/crypto/DeckCrypto.cpp
+#include "DeckCrypto.h"
+#include "Metrics.h"
+#include <stdexcept>
+
+namespace {
+
+// RFC 3526 group 14: a 2048-bit safe prime
+const char* kPrimeHex =
+    "FFFFFFFF FFFFFFFF C90FDAA2 2168C234 C4C6628B 80DC1CD1"
+    "29024E08 8A67CC74 020BBEA6 3B139B22 514A0879 8E3404DD"
+    "EF9519B3 CD3A431B 302B0A6D F25F1437 4FE1356D 6D51C245"
+    "E485B576 625E7EC6 F44C42E9 A637ED6B 0BFF5CB6 F406B7ED"
+    "EE386BFB 5A899FA5 AE9F2411 7C4B1FE6 49286651 ECE45B3D"
+    "C2007CB8 A163BF05 98DA4836 1C55D39A 69163FA8 FD24CF5F"
+    "83655D23 DCA3AD96 1C62F356 208552BB 9ED52907 7096966D"
+    "670C354E 4ABC9804 F1746C08 CA18217C 32905E46 2E36CE3B"
+    "E39E772C 180E8603 9B2783A2 EC07A28F B5C55DF0 6F4C52C9"
+    "DE2BCBF6 95581718 3995497C EA956AE5 15D22618 98FA0510"
+    "15728E5A 8AACAA68 FFFFFFFF FFFFFFFF";
+
+DeckCrypto::Card halfOfPrime() {
+    DeckCrypto::Card p = DeckCrypto::Card::fromHex(kPrimeHex);
+    DeckCrypto::Card q;
+    for (size_t i = 0; i < DeckCrypto::Card::LIMBS; i++) {
+        uint64_t next = i + 1 < DeckCrypto::Card::LIMBS ? p.limb[i + 1] : 0;
+        q.limb[i] = (p.limb[i] >> 1) | (next << 63);
+    }
+    return q;
+}
+
+} // namespace
+
+DeckCrypto::DeckCrypto(WorkerPool& workers)
+    : pool(workers),
+      group(Card::fromHex(kPrimeHex)),
+      exponents(halfOfPrime()),
+      q(halfOfPrime()) {}
+
+// e is a random odd value below q, hence a unit mod 2q = p - 1. Its inverse
+// is found mod q by Fermat (e^(q-2)) and lifted to the odd residue mod 2q.
+DeckCrypto::KeyPair DeckCrypto::generateKey(SecureRandom& rng) const {
+    KeyPair key;
+    do {
+        for (size_t i = 0; i < Card::LIMBS; i++) {
+            key.encrypt.limb[i] = rng.next();
+        }
+        key.encrypt.limb[Card::LIMBS - 1] >>= 2;   // below 2^2046 < q
+        key.encrypt.limb[0] |= 1;
+    } while (key.encrypt == Card::fromU64(1));
+
+    Card qMinus2;
+    Card::sub(qMinus2, q, Card::fromU64(2));
+    Card inv = exponents.pow(key.encrypt, qMinus2);
+    // Add q when inv is even, without branching on the key
+    Card::addMasked(inv, inv, q, (inv.limb[0] & 1) - 1);
+    key.decrypt = inv;
+    return key;
+}
+
+std::vector<DeckCrypto::KeyPair> DeckCrypto::generateKeys(size_t count, SecureRandom& rng) const {
+    std::vector<KeyPair> keys(count);
+    for (auto& key : keys) {
+        key = generateKey(rng);
+    }
+    return keys;
+}
+
+std::vector<size_t> DeckCrypto::randomPermutation(size_t count, SecureRandom& rng) const {
+    std::vector<size_t> perm(count);
+    for (size_t i = 0; i < count; i++) {
+        perm[i] = i;
+    }
+    for (size_t i = count; i > 1; i--) {
+        size_t j = rng.uniform(i);
+        std::swap(perm[i - 1], perm[j]);
+    }
+    return perm;
+}
+
+std::vector<DeckCrypto::Card> DeckCrypto::initialDeck() const {
+    std::vector<Card> deck(DECK_SIZE);
+    for (size_t i = 0; i < DECK_SIZE; i++) {
+        deck[i] = Card::fromU64((i + 2) * (i + 2));
+    }
+    return deck;
+}
+
+DeckCrypto::Card DeckCrypto::exponentiate(const Card& card, const Card& key) const {
+    return group.pow(card, key);
+}
+
+void DeckCrypto::encryptAll(std::vector<Card>& deck, const Card& key) const {
+    METRIC_TIMER(timer, metrics::CRYPTO_ENCRYPT_NS);
+    pool.parallelFor(deck.size(), [&](size_t i) {
+        deck[i] = group.pow(deck[i], key);
+    });
+}
+
+void DeckCrypto::encryptAndShuffle(std::vector<Card>& deck, const Card& key,
+                                   const std::vector<size_t>& permutation) const {
+    if (permutation.size() != deck.size()) {
+        throw std::invalid_argument("permutation does not match deck size");
+    }
+    METRIC_TIMER(timer, metrics::CRYPTO_SHUFFLE_NS);
+    std::vector<Card> shuffled(deck.size());
+    pool.parallelFor(deck.size(), [&](size_t i) {
+        shuffled[i] = group.pow(deck[permutation[i]], key);
+    });
+    deck.swap(shuffled);
+}
+
+void DeckCrypto::remask(std::vector<Card>& deck, const Card& handDecrypt,
+                        const std::vector<KeyPair>& cardKeys) const {
+    if (cardKeys.size() != deck.size()) {
+        throw std::invalid_argument("need one card key per deck position");
+    }
+    METRIC_TIMER(timer, metrics::CRYPTO_REMASK_NS);
+    pool.parallelFor(deck.size(), [&](size_t i) {
+        deck[i] = group.pow(deck[i], mulExponents(handDecrypt, cardKeys[i].encrypt));
+    });
+}
+
+void DeckCrypto::applyKeys(std::vector<Card>& cards, const std::vector<Card>& keys) const {
+    if (keys.size() != cards.size()) {
+        throw std::invalid_argument("need one key per card");
+    }
+    METRIC_TIMER(timer, metrics::CRYPTO_APPLY_KEYS_NS);
+    pool.parallelFor(cards.size(), [&](size_t i) {
+        cards[i] = group.pow(cards[i], keys[i]);
+    });
+}
+
+int DeckCrypto::decode(const Card& plain) const {
+    for (size_t i = 1; i < Card::LIMBS; i++) {
+        if (plain.limb[i] != 0) {
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < DECK_SIZE; i++) {
+        if (plain.limb[0] == (i + 2) * (i + 2)) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// Reduce both factors mod q, multiply there, then pick the representative
+// mod 2q with the parity of the true product (CRT with the factor 2).
+DeckCrypto::Card DeckCrypto::mulExponents(const Card& a, const Card& b) const {
+    auto modQ = [this](const Card& x) {
+        Card r;
+        uint64_t borrow = Card::sub(r, x, q);
+        Card::select(r, 0 - borrow, x, r);
+        return r;
+    };
+    Card product = exponents.mul(exponents.toMont(modQ(a)), modQ(b));
+    uint64_t parity = (a.limb[0] & b.limb[0] & 1);
+    Card::addMasked(product, product, q, 0 - ((product.limb[0] ^ parity) & 1));
+    return product;
+}
+
+void DeckCrypto::serialize(const std::vector<Card>& cards, std::vector<uint8_t>& out) {
+    out.resize(cards.size() * CARD_BYTES);
+    for (size_t i = 0; i < cards.size(); i++) {
+        cards[i].toBytes(out.data() + i * CARD_BYTES);
+    }
+}
+
+bool DeckCrypto::deserialize(const uint8_t* data, size_t len, std::vector<Card>& out) {
+    if (len % CARD_BYTES != 0) {
+        return false;
+    }
+    out.resize(len / CARD_BYTES);
+    for (size_t i = 0; i < out.size(); i++) {
+        out[i] = Card::fromBytes(data + i * CARD_BYTES, CARD_BYTES);
+    }
+    return true;
+}
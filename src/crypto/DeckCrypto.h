@@ -0,0 +1,68 @@
+// src/crypto/DeckCrypto.h
+#pragma once
+#include "BigInt.h"
+#include "Montgomery.h"
+#include "SecureRandom.h"
+#include "WorkerPool.h"
+#include <cstddef>
+#include <vector>
+
+// Commutative (SRA / Pohlig-Hellman) card encryption over the 2048-bit
+// RFC 3526 safe prime p = 2q + 1: E_e(m) = m^e mod p, with e*d = 1 mod p-1.
+// Cards are encoded as quadratic residues, (i + 2)^2, so encryption cannot
+// leak a card's residuosity.
+//
+// A hand runs in three batch passes, each spread over the worker pool:
+//   shuffle - every player encrypts the whole deck with a hand key and
+//             permutes it;
+//   remask  - every player swaps its hand key for one key per card position
+//             (a single exponentiation by d * e_j per card);
+//   reveal  - per-card decryption keys are applied to open a card.
+class DeckCrypto {
+public:
+    using Card = UInt<32>;
+    static const size_t DECK_SIZE = 52;
+    static const size_t CARD_BYTES = Card::BYTES;
+
+    struct KeyPair {
+        Card encrypt;
+        Card decrypt;
+    };
+
+    explicit DeckCrypto(WorkerPool& pool);
+
+    KeyPair generateKey(SecureRandom& rng) const;
+    std::vector<KeyPair> generateKeys(size_t count, SecureRandom& rng) const;
+    std::vector<size_t> randomPermutation(size_t count, SecureRandom& rng) const;
+
+    std::vector<Card> initialDeck() const;
+
+    // deck[i] = deck[i]^key for every card, in parallel
+    void encryptAll(std::vector<Card>& deck, const Card& key) const;
+    // encryptAll with the hand key, then deck = permutation applied to it
+    void encryptAndShuffle(std::vector<Card>& deck, const Card& key,
+                           const std::vector<size_t>& permutation) const;
+    // deck[i] = deck[i]^(handDecrypt * cardKeys[i].encrypt)
+    void remask(std::vector<Card>& deck, const Card& handDecrypt,
+                const std::vector<KeyPair>& cardKeys) const;
+    // cards[i] = cards[i]^keys[i]
+    void applyKeys(std::vector<Card>& cards, const std::vector<Card>& keys) const;
+
+    Card exponentiate(const Card& card, const Card& key) const;
+    // Card index 0..51 of a fully decrypted card, or -1
+    int decode(const Card& plain) const;
+
+    static void serialize(const std::vector<Card>& cards, std::vector<uint8_t>& out);
+    static bool deserialize(const uint8_t* data, size_t len, std::vector<Card>& out);
+
+    const Card& prime() const { return group.modulus(); }
+
+private:
+    // a * b mod (p - 1) for a, b < p - 1
+    Card mulExponents(const Card& a, const Card& b) const;
+
+    WorkerPool& pool;
+    Montgomery<32> group;      // mod p, card arithmetic
+    Montgomery<32> exponents;  // mod q, key arithmetic
+    Card q;
+};
@@ -0,0 +1,92 @@
+// src/crypto/Ed25519.cpp
+#include "Ed25519.h"
+#include <openssl/evp.h>
+#include <stdexcept>
+
+namespace {
+
+struct DigestContext {
+    EVP_MD_CTX* ctx;
+    DigestContext() : ctx(EVP_MD_CTX_new()) {
+        if (!ctx) {
+            throw std::bad_alloc();
+        }
+    }
+    ~DigestContext() { EVP_MD_CTX_free(ctx); }
+};
+
+const unsigned char* data(const std::string& s) {
+    return reinterpret_cast<const unsigned char*>(s.data());
+}
+
+} // namespace
+
+std::shared_ptr<const Ed25519PublicKey> Ed25519PublicKey::fromBytes(const std::string& raw) {
+    if (raw.size() != BYTES) {
+        return nullptr;
+    }
+    EVP_PKEY* key = EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr, data(raw), raw.size());
+    if (!key) {
+        return nullptr;
+    }
+    return std::shared_ptr<const Ed25519PublicKey>(new Ed25519PublicKey(key, raw));
+}
+
+Ed25519PublicKey::Ed25519PublicKey(EVP_PKEY* k, std::string bytes) : key(k), raw(std::move(bytes)) {}
+
+Ed25519PublicKey::~Ed25519PublicKey() {
+    EVP_PKEY_free(key);
+}
+
+bool Ed25519PublicKey::verify(const std::string& message, const std::string& signature) const {
+    if (signature.size() != SIGNATURE_BYTES) {
+        return false;
+    }
+    DigestContext md;
+    return EVP_DigestVerifyInit(md.ctx, nullptr, nullptr, nullptr, key) == 1 &&
+           EVP_DigestVerify(md.ctx, data(signature), signature.size(),
+                            data(message), message.size()) == 1;
+}
+
+Ed25519PrivateKey::Ed25519PrivateKey() : key(nullptr) {
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_ED25519, nullptr);
+    bool ok = ctx && EVP_PKEY_keygen_init(ctx) == 1 && EVP_PKEY_keygen(ctx, &key) == 1;
+    EVP_PKEY_CTX_free(ctx);
+    if (!ok) {
+        throw std::runtime_error("Ed25519 key generation failed");
+    }
+    loadPublicKey();
+}
+
+Ed25519PrivateKey::Ed25519PrivateKey(const std::string& seed) : key(nullptr) {
+    if (seed.size() != SEED_BYTES) {
+        throw std::invalid_argument("Ed25519 seed must be 32 bytes");
+    }
+    key = EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, nullptr, data(seed), seed.size());
+    if (!key) {
+        throw std::runtime_error("Ed25519 key import failed");
+    }
+    loadPublicKey();
+}
+
+void Ed25519PrivateKey::loadPublicKey() {
+    size_t len = Ed25519PublicKey::BYTES;
+    pub.resize(len);
+    EVP_PKEY_get_raw_public_key(key, reinterpret_cast<unsigned char*>(&pub[0]), &len);
+}
+
+Ed25519PrivateKey::~Ed25519PrivateKey() {
+    EVP_PKEY_free(key);
+}
+
+std::string Ed25519PrivateKey::sign(const std::string& message) const {
+    DigestContext md;
+    std::string signature(Ed25519PublicKey::SIGNATURE_BYTES, '\0');
+    size_t len = signature.size();
+    if (EVP_DigestSignInit(md.ctx, nullptr, nullptr, nullptr, key) != 1 ||
+        EVP_DigestSign(md.ctx, reinterpret_cast<unsigned char*>(&signature[0]), &len,
+                       data(message), message.size()) != 1) {
+        throw std::runtime_error("Ed25519 signing failed");
+    }
+    return signature;
+}
@@ -0,0 +1,56 @@
+// src/crypto/Ed25519.h
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+
+typedef struct evp_pkey_st EVP_PKEY;
+
+// Ed25519 signatures (RFC 8032) through OpenSSL's EVP interface. Keys are
+// immutable once built, so one key may sign or verify on many threads.
+class Ed25519PublicKey {
+public:
+    static const size_t BYTES = 32;
+    static const size_t SIGNATURE_BYTES = 64;
+
+    // nullptr unless raw is a 32-byte encoded point
+    static std::shared_ptr<const Ed25519PublicKey> fromBytes(const std::string& raw);
+    ~Ed25519PublicKey();
+
+    Ed25519PublicKey(const Ed25519PublicKey&) = delete;
+    Ed25519PublicKey& operator=(const Ed25519PublicKey&) = delete;
+
+    bool verify(const std::string& message, const std::string& signature) const;
+    const std::string& bytes() const { return raw; }
+
+private:
+    Ed25519PublicKey(EVP_PKEY* key, std::string raw);
+
+    EVP_PKEY* key;
+    std::string raw;
+};
+
+class Ed25519PrivateKey {
+public:
+    static const size_t SEED_BYTES = 32;
+
+    // Fresh key from the OS entropy source
+    Ed25519PrivateKey();
+    // The key a 32-byte RFC 8032 seed expands to, so a node keeps its
+    // identity across restarts. Throws std::invalid_argument for any other
+    // length.
+    explicit Ed25519PrivateKey(const std::string& seed);
+    ~Ed25519PrivateKey();
+
+    Ed25519PrivateKey(const Ed25519PrivateKey&) = delete;
+    Ed25519PrivateKey& operator=(const Ed25519PrivateKey&) = delete;
+
+    std::string sign(const std::string& message) const;
+    const std::string& publicKey() const { return pub; }
+
+private:
+    void loadPublicKey();
+
+    EVP_PKEY* key;
+    std::string pub;
+};
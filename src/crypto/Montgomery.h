@@ -0,0 +1,125 @@
+// src/crypto/Montgomery.h
+#pragma once
+#include "BigInt.h"
+
+// Arithmetic modulo an odd N-limb modulus m in Montgomery form (R = 2^(64N)).
+// Multiplication is CIOS with a branch-free final subtraction, and pow() is a
+// fixed 4-bit window over every exponent bit with a full table scan per
+// lookup, so timing depends only on the operand width.
+template <size_t N>
+class Montgomery {
+public:
+    using Int = UInt<N>;
+
+    explicit Montgomery(const Int& modulus) : m(modulus) {
+        if (!m.isOdd()) {
+            throw std::invalid_argument("Montgomery modulus must be odd");
+        }
+        // -m^-1 mod 2^64 by Newton iteration
+        uint64_t inv = 1;
+        for (int i = 0; i < 6; i++) {
+            inv *= 2 - m.limb[0] * inv;
+        }
+        m0inv = 0 - inv;
+
+        // R mod m and R^2 mod m by modular doubling
+        Int x = Int::fromU64(1);
+        for (size_t i = 0; i < Int::BITS; i++) {
+            x = twice(x);
+        }
+        rOne = x;
+        for (size_t i = 0; i < Int::BITS; i++) {
+            x = twice(x);
+        }
+        r2 = x;
+    }
+
+    const Int& modulus() const { return m; }
+    const Int& one() const { return rOne; }
+
+    // Any a < R; the result is reduced below m.
+    Int toMont(const Int& a) const { return mul(a, r2); }
+    Int fromMont(const Int& a) const { return mul(a, Int::fromU64(1)); }
+
+    // a * b * R^-1 mod m
+    Int mul(const Int& a, const Int& b) const {
+        uint64_t t[N + 2] = {};
+        for (size_t i = 0; i < N; i++) {
+            unsigned __int128 c = 0;
+            for (size_t j = 0; j < N; j++) {
+                c += static_cast<unsigned __int128>(a.limb[j]) * b.limb[i] + t[j];
+                t[j] = static_cast<uint64_t>(c);
+                c >>= 64;
+            }
+            c += t[N];
+            t[N] = static_cast<uint64_t>(c);
+            t[N + 1] = static_cast<uint64_t>(c >> 64);
+
+            uint64_t q = t[0] * m0inv;
+            c = static_cast<unsigned __int128>(q) * m.limb[0] + t[0];
+            c >>= 64;
+            for (size_t j = 1; j < N; j++) {
+                c += static_cast<unsigned __int128>(q) * m.limb[j] + t[j];
+                t[j - 1] = static_cast<uint64_t>(c);
+                c >>= 64;
+            }
+            c += t[N];
+            t[N - 1] = static_cast<uint64_t>(c);
+            t[N] = t[N + 1] + static_cast<uint64_t>(c >> 64);
+        }
+
+        Int r;
+        for (size_t i = 0; i < N; i++) {
+            r.limb[i] = t[i];
+        }
+        Int reduced;
+        uint64_t borrow = Int::sub(reduced, r, m);
+        // keep r only when it was already below m (borrow and no overflow word)
+        uint64_t keep = 0 - (borrow & static_cast<uint64_t>(t[N] == 0));
+        Int::select(r, keep, r, reduced);
+        return r;
+    }
+
+    // base^exp mod m, plain (non-Montgomery) input and output
+    Int pow(const Int& base, const Int& exp) const {
+        Int table[16];
+        table[0] = rOne;
+        table[1] = toMont(base);
+        for (int i = 2; i < 16; i++) {
+            table[i] = mul(table[i - 1], table[1]);
+        }
+
+        Int acc = rOne;
+        for (size_t n = Int::BITS / 4; n-- > 0;) {
+            for (int s = 0; s < 4; s++) {
+                acc = mul(acc, acc);
+            }
+            unsigned digit = exp.nibble(n);
+            Int entry;
+            for (unsigned i = 0; i < 16; i++) {
+                uint64_t match = 0 - static_cast<uint64_t>(i == digit);
+                Int::select(entry, match, table[i], entry);
+            }
+            acc = mul(acc, entry);
+        }
+        return fromMont(acc);
+    }
+
+private:
+    // 2x mod m for x < m
+    Int twice(const Int& x) const {
+        Int doubled;
+        uint64_t carry = Int::add(doubled, x, x);
+        Int reduced;
+        uint64_t borrow = Int::sub(reduced, doubled, m);
+        uint64_t keep = 0 - (borrow & (carry ^ 1));
+        Int r;
+        Int::select(r, keep, doubled, reduced);
+        return r;
+    }
+
+    Int m;
+    Int rOne;
+    Int r2;
+    uint64_t m0inv;
+};
@@ -0,0 +1,28 @@
+// src/crypto/SecureRandom.h
+#pragma once
+#include <cstdint>
+#include <random>
+
+// Thin wrapper over the OS entropy source (std::random_device is backed by
+// getrandom / arc4random on the platforms we build for).
+class SecureRandom {
+public:
+    uint64_t next() {
+        uint64_t hi = device();
+        uint64_t lo = device();
+        return (hi << 32) | lo;
+    }
+
+    // Uniform in [0, bound) without modulo bias
+    uint64_t uniform(uint64_t bound) {
+        uint64_t limit = UINT64_MAX - UINT64_MAX % bound;
+        uint64_t v;
+        do {
+            v = next();
+        } while (v >= limit);
+        return v % bound;
+    }
+
+private:
+    std::random_device device;
+};
@@ -1,8 +1,16 @@
 #include "MembershipList.h"
 #include "NetworkManager.h"
 #include "GameEngine.h"
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 #include <iostream>
 #include <cctype>
 
@@ -19,8 +27,20 @@ int extractNodeId(const std::string& hostname) {
 }
 
 int main() {
-    MembershipList membershipList;
-    
+    // TABLES=<n> hosts n tables, "room1" .. "room<n>", in this one process.
+    // They share the peer connections, io threads and the crypto workers.
+    size_t tableCount = 1;
+    const char* tables = std::getenv("TABLES");
+    if (tables) {
+        tableCount = std::max<size_t>(1, std::strtoul(tables, nullptr, 10));
+    }
+    WorkerPool workers;
+    std::vector<std::unique_ptr<MembershipList>> membershipLists;
+    for (size_t i = 0; i < tableCount; i++) {
+        membershipLists.emplace_back(new MembershipList());
+    }
+    MembershipList& membershipList = *membershipLists[0];
+
     // Get hostname from environment
     const char* hostname = std::getenv("HOSTNAME");
     const char* server_host = std::getenv("SERVER_HOST");
@@ -42,16 +62,93 @@ int main() {
         membershipList, 
         hostname,
         server_host,
+        8080,
         nodeId
     );
+    networkManager.setWorkerPool(workers);
+    for (size_t i = 1; i < tableCount; i++) {
+        networkManager.addTable(i, "room" + std::to_string(i + 1), *membershipLists[i]);
+    }
 
-    GameEngine gameEngine(membershipList);
+    // NODE_KEY=<64 hex digits> is the seed of this node's signing key, so it
+    // keeps its identity across restarts; PEER_KEYS=<file> lists "<node id>
+    // <hex public key>" per line, and only those peers are let in
+    const char* nodeKey = std::getenv("NODE_KEY");
+    if (nodeKey && *nodeKey) {
+        try {
+            networkManager.setSigningKey(ConsensusMessage::fromHex(nodeKey));
+        } catch (const std::invalid_argument& e) {
+            std::cerr << "NODE_KEY: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "Node " << nodeId << " public key "
+              << ConsensusMessage::toHex(networkManager.publicKey()) << std::endl;
+    const char* peerKeysFile = std::getenv("PEER_KEYS");
+    if (peerKeysFile && *peerKeysFile) {
+        std::ifstream in(peerKeysFile);
+        if (!in) {
+            std::cerr << "Cannot read PEER_KEYS file " << peerKeysFile << std::endl;
+            return 1;
+        }
+        std::map<int, std::string> peerKeys;
+        int peer;
+        std::string key;
+        while (in >> peer >> key) {
+            peerKeys[peer] = ConsensusMessage::fromHex(key);
+        }
+        networkManager.setPeerKeys(std::move(peerKeys));
+    }
+
+    // WIRE_FORMAT=json sends human-readable frames for debugging
+    const char* wireFormat = std::getenv("WIRE_FORMAT");
+    if (wireFormat && std::string(wireFormat) == "json") {
+        networkManager.setWireFormat(wire::Format::JSON);
+    }
+
+    // IO_THREADS sizes the peer io pool (default: one thread per core)
+    const char* ioThreads = std::getenv("IO_THREADS");
+    if (ioThreads) {
+        networkManager.setIoThreads(std::strtoul(ioThreads, nullptr, 10));
+    }
+
+    // METRICS_INTERVAL=<seconds> logs the metrics dump; METRICS_JSON=1 as JSON
+    const char* metricsInterval = std::getenv("METRICS_INTERVAL");
+    if (metricsInterval) {
+        const char* metricsJson = std::getenv("METRICS_JSON");
+        networkManager.setMetricsLog(std::chrono::seconds(std::strtoul(metricsInterval, nullptr, 10)),
+                                     metricsJson && std::string(metricsJson) == "1");
+    }
+
+    // GAME_LOG_DIR=<path> keeps decided heights on disk for crash recovery;
+    // tables past the first log under <path>/room<n>
+    const char* gameLogDir = std::getenv("GAME_LOG_DIR");
+    if (gameLogDir && *gameLogDir) {
+        networkManager.setGameLog(gameLogDir);
+        for (size_t i = 1; i < tableCount; i++) {
+            networkManager.setGameLog(std::string(gameLogDir) + "/room" + std::to_string(i + 1), i);
+        }
+    }
+
+    // Each engine gets its own lane of the shared pool, so one table's
+    // shuffle takes turns with the others' work instead of queueing ahead of it
+    std::vector<std::unique_ptr<GameEngine>> gameEngines;
+    for (size_t i = 0; i < tableCount; i++) {
+        gameEngines.emplace_back(new GameEngine(*membershipLists[i], workers));
+    }
 
     // Start the network manager (gossip and consensus)
     networkManager.start();
 
-    // Run the main game engine
-    gameEngine.runGame();
+    // Run the game engines, the first one on this thread
+    std::vector<std::thread> tableThreads;
+    for (size_t i = 1; i < tableCount; i++) {
+        tableThreads.emplace_back(&GameEngine::runGame, gameEngines[i].get());
+    }
+    gameEngines[0]->runGame();
+    for (auto& thread : tableThreads) {
+        thread.join();
+    }
 
     return 0;
 }
@@ -0,0 +1,88 @@
+// src/network/ConnectionTable.cpp
+#include "ConnectionTable.h"
+
+void ConnectionTable::insert(const Ptr& conn) {
+    Shard& shard = shardFor(conn->socket);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    shard.bySocket[conn->socket] = conn;
+}
+
+ConnectionTable::Ptr ConnectionTable::find(int socket) const {
+    const Shard& shard = shardFor(socket);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.bySocket.find(socket);
+    return it == shard.bySocket.end() ? nullptr : it->second;
+}
+
+ConnectionTable::Ptr ConnectionTable::findPeer(int peerId) const {
+    const Shard& shard = shardFor(peerId);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    auto it = shard.byPeer.find(peerId);
+    return it == shard.byPeer.end() ? nullptr : it->second;
+}
+
+ConnectionTable::Ptr ConnectionTable::bindPeer(const Ptr& conn) {
+    Shard& shard = shardFor(conn->peerId);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+    Ptr& slot = shard.byPeer[conn->peerId];
+    Ptr previous = slot == conn ? nullptr : slot;
+    slot = conn;
+    return previous;
+}
+
+ConnectionTable::Ptr ConnectionTable::erase(int socket) {
+    Ptr conn;
+    {
+        Shard& shard = shardFor(socket);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.bySocket.find(socket);
+        if (it == shard.bySocket.end()) {
+            return nullptr;
+        }
+        conn = it->second;
+        shard.bySocket.erase(it);
+    }
+    int peerId = conn->peerId;
+    if (peerId >= 0) {
+        Shard& shard = shardFor(peerId);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.byPeer.find(peerId);
+        if (it != shard.byPeer.end() && it->second == conn) {
+            shard.byPeer.erase(it);
+        }
+    }
+    return conn;
+}
+
+size_t ConnectionTable::size() const {
+    size_t n = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        n += shard.bySocket.size();
+    }
+    return n;
+}
+
+std::vector<ConnectionTable::Ptr> ConnectionTable::snapshot() const {
+    std::vector<Ptr> out;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        for (const auto& entry : shard.bySocket) {
+            out.push_back(entry.second);
+        }
+    }
+    return out;
+}
+
+std::vector<ConnectionTable::Ptr> ConnectionTable::established() const {
+    std::vector<Ptr> out;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        for (const auto& entry : shard.byPeer) {
+            if (entry.second->state == HandshakeState::ESTABLISHED) {
+                out.push_back(entry.second);
+            }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,105 @@
+// src/network/ConnectionTable.h
+#pragma once
+#include "FrameDecoder.h"
+#include "SendQueue.h"
+#include "TimerWheel.h"
+#include <boost/asio.hpp>
+#include <netinet/in.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class HandshakeState {
+    INIT,
+    WAIT_HELLO,
+    WAIT_WELCOME,
+    WAIT_AUTH,
+    ESTABLISHED,
+    ERROR
+};
+
+// One peer socket. Handlers for it run on the socket's strand, so only the
+// atomics below are read from other threads.
+struct PendingConnection {
+    int socket;
+    std::atomic<HandshakeState> state;
+    std::string peerHostname;
+    std::atomic<int> peerId;
+    std::chrono::steady_clock::time_point startTime;
+    TimerWheel::Handle handshakeTimer;   // reaps the connection if the handshake stalls
+    bool isOutgoing;
+    struct sockaddr_in addr;
+    std::shared_ptr<boost::asio::ip::tcp::socket> stream;
+    std::shared_ptr<FrameDecoder> decoder;
+    std::shared_ptr<SendQueue> sendQueue;
+    // Snapshots being received from this peer, by table (strand only)
+    struct IncomingState {
+        std::string buffer;
+        uint64_t height = 0;
+        uint32_t total = 0;   // fixed by the first chunk
+    };
+    std::map<uint32_t, IncomingState> incomingState;
+    // Handshake: our nonce is fixed when the connection is registered; the
+    // rest is filled on the strand while the peer proves its key
+    struct Challenge {
+        std::string nonce;
+        std::string peerNonce;
+        int peerId = -1;
+        std::string peerKey;
+        std::vector<std::pair<uint32_t, uint64_t>> joins;   // (table, peer height) until AUTH
+    } challenge;
+
+    PendingConnection() :
+        socket(-1),
+        state(HandshakeState::INIT),
+        peerId(-1),
+        isOutgoing(false) {}
+
+    PendingConnection(int sock, bool outgoing) :
+        socket(sock),
+        state(outgoing ? HandshakeState::WAIT_WELCOME : HandshakeState::WAIT_HELLO),
+        peerId(-1),
+        startTime(std::chrono::steady_clock::now()),
+        isOutgoing(outgoing) {}
+};
+
+// Connections keyed by socket, with a second index by peer id once the
+// handshake names the peer. Each key hashes to one of SHARDS independently
+// locked maps, so accepts, handshakes and broadcasts on different sockets
+// rarely touch the same lock.
+class ConnectionTable {
+public:
+    using Ptr = std::shared_ptr<PendingConnection>;
+    static const size_t SHARDS = 16;
+
+    void insert(const Ptr& conn);
+    Ptr find(int socket) const;
+    Ptr findPeer(int peerId) const;
+    // Indexes an established connection under its peer id. Returns the
+    // connection it replaced, if the peer was already connected.
+    Ptr bindPeer(const Ptr& conn);
+    Ptr erase(int socket);
+    size_t size() const;
+
+    // Copies out the entries so callers can act on them without any lock.
+    std::vector<Ptr> snapshot() const;
+    std::vector<Ptr> established() const;
+
+private:
+    struct Shard {
+        mutable std::mutex mtx;
+        std::unordered_map<int, Ptr> bySocket;
+        std::unordered_map<int, Ptr> byPeer;
+    };
+
+    Shard& shardFor(int key) { return shards[static_cast<unsigned>(key) % SHARDS]; }
+    const Shard& shardFor(int key) const { return shards[static_cast<unsigned>(key) % SHARDS]; }
+
+    std::array<Shard, SHARDS> shards;
+};
@@ -0,0 +1,1487 @@
+// src/network/Consensus.cpp
+#include "Consensus.h"
+#include "Metrics.h"
+#include <openssl/evp.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+metrics::Histogram stepHistogram(ConsensusStep step) {
+    switch (step) {
+        case ConsensusStep::PROPOSE: return metrics::CONSENSUS_PROPOSE_NS;
+        case ConsensusStep::PREVOTE: return metrics::CONSENSUS_PREVOTE_NS;
+        default: return metrics::CONSENSUS_PRECOMMIT_NS;
+    }
+}
+
+const char* typeName(ConsensusMessageType type) {
+    switch (type) {
+        case ConsensusMessageType::ACTION: return "ACTION";
+        case ConsensusMessageType::PROPOSAL: return "PROPOSAL";
+        case ConsensusMessageType::PREVOTE: return "PREVOTE";
+        case ConsensusMessageType::PRECOMMIT: return "PRECOMMIT";
+        case ConsensusMessageType::COMMIT: return "COMMIT";
+    }
+    return "";
+}
+
+const uint64_t kMaxHeightsAhead = 64;   // buffered future heights we accept
+const std::chrono::milliseconds kCertificateResend(250);   // per peer and height
+
+} // namespace
+
+std::string ConsensusMessage::toHex(const std::string& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(bytes.size() * 2);
+    for (unsigned char c : bytes) {
+        out.push_back(digits[c >> 4]);
+        out.push_back(digits[c & 0xF]);
+    }
+    return out;
+}
+
+std::string ConsensusMessage::fromHex(const std::string& hex) {
+    auto nibble = [](char c) {
+        return c >= 'a' ? c - 'a' + 10 : c >= 'A' ? c - 'A' + 10 : c - '0';
+    };
+    std::string out;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        out.push_back(static_cast<char>((nibble(hex[i]) << 4) | nibble(hex[i + 1])));
+    }
+    return out;
+}
+
+Json::Value CommitEntry::toJson() const {
+    Json::Value value;
+    value["player_id"] = playerId;
+    value["seq"] = Json::UInt64(seq);
+    value["action"] = action;
+    value["phase"] = phase;
+    value["amount"] = amount;
+    return value;
+}
+
+CommitEntry CommitEntry::fromJson(const Json::Value& value) {
+    CommitEntry entry;
+    entry.playerId = value["player_id"].asInt();
+    entry.seq = value["seq"].asUInt64();
+    entry.action = value["action"].asString();
+    entry.phase = value["phase"].asString();
+    entry.amount = value["amount"].asInt();
+    return entry;
+}
+
+Json::Value ConsensusMessage::toJson() const {
+    Json::Value value;
+    value["type"] = typeName(type);
+    value["node_id"] = sender;
+    value["height"] = Json::UInt64(height);
+    value["round"] = round;
+    value["value_id"] = valueId;
+    if (type == ConsensusMessageType::PROPOSAL || type == ConsensusMessageType::COMMIT) {
+        value["parent_id"] = parentId;
+        value["valid_round"] = validRound;
+    }
+    if (!signature.empty()) {
+        value["signature"] = toHex(signature);
+    }
+    if (type == ConsensusMessageType::COMMIT) {
+        Json::Value list(Json::arrayValue);
+        for (const auto& vote : certificate) {
+            Json::Value item;
+            item["node_id"] = vote.sender;
+            item["signature"] = toHex(vote.signature);
+            list.append(item);
+        }
+        value["certificate"] = list;
+    }
+    if (!entries.empty()) {
+        Json::Value list(Json::arrayValue);
+        for (const auto& entry : entries) {
+            list.append(entry.toJson());
+        }
+        value["entries"] = list;
+    }
+    return value;
+}
+
+bool ConsensusMessage::isConsensusType(const std::string& type) {
+    return type == "ACTION" || type == "PROPOSAL" || type == "PREVOTE" || type == "PRECOMMIT" ||
+           type == "COMMIT";
+}
+
+bool ConsensusMessage::fromJson(const Json::Value& value, ConsensusMessage& out) {
+    std::string type = value["type"].asString();
+    if (type == "ACTION") {
+        out.type = ConsensusMessageType::ACTION;
+    } else if (type == "PROPOSAL") {
+        out.type = ConsensusMessageType::PROPOSAL;
+    } else if (type == "PREVOTE") {
+        out.type = ConsensusMessageType::PREVOTE;
+    } else if (type == "PRECOMMIT") {
+        out.type = ConsensusMessageType::PRECOMMIT;
+    } else if (type == "COMMIT") {
+        out.type = ConsensusMessageType::COMMIT;
+    } else {
+        return false;
+    }
+    out.sender = value["node_id"].asInt();
+    out.height = value["height"].asUInt64();
+    out.round = value["round"].asInt();
+    out.valueId = value["value_id"].asString();
+    out.parentId = value.get("parent_id", "").asString();
+    out.validRound = value.get("valid_round", -1).asInt();
+    out.entries.clear();
+    for (const auto& entry : value["entries"]) {
+        out.entries.push_back(CommitEntry::fromJson(entry));
+    }
+    out.signature = fromHex(value.get("signature", "").asString());
+    out.certificate.clear();
+    for (const auto& item : value["certificate"]) {
+        VoteSignature vote;
+        vote.sender = item["node_id"].asInt();
+        vote.signature = fromHex(item["signature"].asString());
+        out.certificate.push_back(vote);
+    }
+    return out.round >= 0;
+}
+
+std::string ConsensusMessage::voteBytes(ConsensusMessageType type, int sender, uint64_t height,
+                                        int round, const std::string& valueId) {
+    // Tagged and length-delimited so no two votes share an encoding
+    std::string out = type == ConsensusMessageType::PREVOTE ? "MPV1/prevote/" : "MPV1/precommit/";
+    out += std::to_string(sender) + "/" + std::to_string(height) + "/" + std::to_string(round) +
+           "/" + std::to_string(valueId.size()) + "/" + valueId;
+    return out;
+}
+
+std::string ConsensusMessage::proposalBytes(int sender, uint64_t height, int round,
+                                            int validRound, const std::string& valueId) {
+    return "MPV1/proposal/" + std::to_string(sender) + "/" + std::to_string(height) + "/" +
+           std::to_string(round) + "/" + std::to_string(validRound) + "/" +
+           std::to_string(valueId.size()) + "/" + valueId;
+}
+
+std::string ConsensusMessage::signedBytes() const {
+    return type == ConsensusMessageType::PROPOSAL
+        ? proposalBytes(sender, height, round, validRound, valueId)
+        : voteBytes();
+}
+
+const char* const ValidatorSchedule::PHASE = "MEMBERSHIP";
+
+const std::vector<int>& ValidatorSchedule::at(uint64_t height) const {
+    static const std::vector<int> none;
+    auto it = byHeight.upper_bound(height);
+    return it == byHeight.begin() ? none : std::prev(it)->second;
+}
+
+const std::vector<int>& ValidatorSchedule::latest() const {
+    static const std::vector<int> none;
+    return byHeight.empty() ? none : byHeight.rbegin()->second;
+}
+
+bool ValidatorSchedule::changes(const CommitEntry& entry) const {
+    const std::vector<int>& set = latest();
+    bool member = std::binary_search(set.begin(), set.end(), entry.amount);
+    return entry.action == "JOIN" ? !member : member && set.size() > 1;
+}
+
+void ValidatorSchedule::apply(uint64_t height, const std::vector<CommitEntry>& entries) {
+    for (const auto& entry : entries) {
+        if (!isChange(entry)) {
+            continue;
+        }
+        if (byHeight.empty()) {
+            if (entry.action == "JOIN" && entry.playerId == entry.amount) {
+                byHeight[height + 1] = std::vector<int>(1, entry.amount);
+            }
+            continue;
+        }
+        if (!changes(entry)) {
+            continue;
+        }
+        // Decided in height order, so nothing is scheduled past this yet
+        std::vector<int> next = latest();
+        if (entry.action == "JOIN") {
+            next.insert(std::lower_bound(next.begin(), next.end(), entry.amount), entry.amount);
+        } else {
+            next.erase(std::lower_bound(next.begin(), next.end(), entry.amount));
+        }
+        byHeight[height + DELAY] = std::move(next);
+    }
+}
+
+void ValidatorSchedule::found(uint64_t height, int id) {
+    if (byHeight.empty()) {
+        byHeight[height] = std::vector<int>(1, id);
+    }
+}
+
+void ValidatorSchedule::prune(uint64_t height) {
+    auto it = byHeight.upper_bound(height);
+    if (it != byHeight.begin()) {
+        byHeight.erase(byHeight.begin(), std::prev(it));
+    }
+}
+
+CommitEntry ValidatorSchedule::change(int submitter, int subject, bool join, uint64_t height) {
+    CommitEntry entry;
+    entry.playerId = submitter;
+    entry.seq = (uint64_t(1) << 63) | (height << 21) | (uint64_t(join ? 0 : 1) << 20) |
+                (static_cast<uint64_t>(subject) & 0xFFFFF);
+    entry.action = join ? "JOIN" : "LEAVE";
+    entry.phase = PHASE;
+    entry.amount = subject;
+    return entry;
+}
+
+bool CommittedEntries::contains(int playerId, uint64_t seq) const {
+    if (ValidatorSchedule::isChangeSeq(seq)) {
+        return ValidatorSchedule::submittedAt(seq) < floor ||
+               recentChanges.count(std::make_pair(playerId, seq)) > 0;
+    }
+    auto it = highestSeq.find(playerId);
+    return it != highestSeq.end() && seq <= it->second;
+}
+
+void CommittedEntries::add(int playerId, uint64_t seq) {
+    if (ValidatorSchedule::isChangeSeq(seq)) {
+        if (ValidatorSchedule::submittedAt(seq) >= floor) {
+            recentChanges.emplace(playerId, seq);
+        }
+        return;
+    }
+    auto it = highestSeq.emplace(playerId, seq).first;
+    it->second = std::max(it->second, seq);
+}
+
+void CommittedEntries::merge(const CommittedEntries& other) {
+    for (const auto& player : other.highestSeq) {
+        add(player.first, player.second);
+    }
+    floor = std::max(floor, other.floor);
+    for (const auto& change : other.recentChanges) {
+        add(change.first, change.second);
+    }
+    advance(0);
+}
+
+void CommittedEntries::advance(uint64_t nextHeight) {
+    if (nextHeight > CHANGE_WINDOW) {
+        floor = std::max(floor, nextHeight - CHANGE_WINDOW);
+    }
+    for (auto it = recentChanges.begin(); it != recentChanges.end();) {
+        it = ValidatorSchedule::submittedAt(it->second) < floor ? recentChanges.erase(it)
+                                                                 : std::next(it);
+    }
+}
+
+const std::string Consensus::GENESIS_ID = "genesis";
+
+Consensus::Consensus(int id,
+                     MembershipList& list,
+                     BroadcastFn broadcastFn,
+                     CommitFn commitFn,
+                     ScheduleFn scheduleFn,
+                     ConsensusConfig cfg)
+    : nodeId(id),
+      membershipList(list),
+      membershipSubscription(0),
+      broadcast(std::move(broadcastFn)),
+      commit(std::move(commitFn)),
+      schedule(std::move(scheduleFn)),
+      config(cfg),
+      backpressure(false),
+      running(false),
+      delivering(false),
+      nextDeliver(0),
+      lastCommittedId(GENESIS_ID) {
+    if (config.pipelineDepth == 0 || config.pipelineDepth > ValidatorSchedule::DELAY) {
+        throw std::invalid_argument("pipelineDepth must be 1.." +
+                                    std::to_string(ValidatorSchedule::DELAY));
+    }
+    membershipSubscription = membershipList.subscribe(
+        [this](const MembershipList::Snapshot&) { onMembershipChanged(); });
+}
+
+Consensus::~Consensus() {
+    membershipList.unsubscribe(membershipSubscription);
+}
+
+void Consensus::setSigner(SignFn signer) {
+    std::lock_guard<std::mutex> lock(mtx);
+    sign = std::move(signer);
+}
+
+void Consensus::setSendTo(SendToFn fn) {
+    std::lock_guard<std::mutex> lock(mtx);
+    sendTo = std::move(fn);
+}
+
+void Consensus::setDecidedHandler(DecidedFn fn) {
+    std::lock_guard<std::mutex> lock(mtx);
+    decidedFn = std::move(fn);
+}
+
+void Consensus::start() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = true;
+        maybeStartNextHeight();
+        evaluateAll();
+    }
+    flush();
+}
+
+void Consensus::found() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!validatorSchedule.empty()) {
+            return;
+        }
+        validatorSchedule.found(nextDeliver, nodeId);
+        refreshValidators();
+        ConsensusMessage msg;
+        msg.type = ConsensusMessageType::ACTION;
+        msg.entries.push_back(ValidatorSchedule::change(nodeId, nodeId, true, nextDeliver));
+        send(msg);
+        proposeMembership();
+        onNewWork();
+        evaluateAll();
+    }
+    flush();
+}
+
+std::vector<int> Consensus::validatorSet() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return validatorSchedule.at(nextDeliver);
+}
+
+void Consensus::submit(const CommitEntry& entry) {
+    ConsensusMessage msg;
+    msg.type = ConsensusMessageType::ACTION;
+    msg.entries.push_back(entry);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        send(msg);
+        onNewWork();
+        evaluateAll();
+    }
+    flush();
+}
+
+void Consensus::onMessage(const ConsensusMessage& msg) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        record(msg);
+        if (msg.type == ConsensusMessageType::ACTION) {
+            onNewWork();
+        }
+        evaluateAll();
+    }
+    flush();
+}
+
+void Consensus::onMessages(const std::vector<ConsensusMessage>& msgs) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bool work = false;
+        for (const auto& msg : msgs) {
+            record(msg);
+            work = work || msg.type == ConsensusMessageType::ACTION;
+        }
+        if (work) {
+            onNewWork();
+        }
+        evaluateAll();
+    }
+    flush();
+}
+
+void Consensus::setBackpressure(bool congested) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (backpressure == congested) {
+            return;
+        }
+        backpressure = congested;
+        if (!congested) {
+            onNewWork();
+            evaluateAll();
+        }
+    }
+    flush();
+}
+
+uint64_t Consensus::committedHeight() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return nextDeliver;
+}
+
+bool Consensus::behind(uint64_t height) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return height >= nextDeliver + config.pipelineDepth ||
+           (height > nextDeliver && validatorSchedule.at(nextDeliver).empty());
+}
+
+int Consensus::currentRound() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = heights.find(nextDeliver);
+    return it == heights.end() ? 0 : it->second.round;
+}
+
+void Consensus::restore(uint64_t nextHeight, const std::string& lastValueId,
+                        const CommittedEntries& committedEntries,
+                        const ValidatorSchedule::Sets& validators) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (running && nextHeight <= nextDeliver) {
+            return;
+        }
+        // Votes already buffered for later heights stay
+        heights.erase(heights.begin(), heights.lower_bound(nextHeight));
+        nextDeliver = nextHeight;
+        lastCommittedId = lastValueId;
+        committed.merge(committedEntries);
+        committed.advance(nextHeight);
+        validatorSchedule = ValidatorSchedule(validators);
+        for (auto& entry : heights) {
+            entry.second.validators = validatorSchedule.at(entry.first);
+        }
+        if (running) {
+            proposeMembership();
+            maybeStartNextHeight();
+            evaluateAll();
+        }
+    }
+    flush();
+}
+
+bool Consensus::adoptDecided(const ConsensusMessage& msg) {
+    bool taken = false;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (msg.height == nextDeliver && msg.parentId == lastCommittedId &&
+            computeValueId(msg.parentId, msg.entries) == msg.valueId && certified(msg)) {
+            HeightState& hs = heights[msg.height];
+            hs.started = true;
+            hs.decided = true;
+            hs.validators = validatorSchedule.at(msg.height);
+            hs.decision.valueId = msg.valueId;
+            hs.decision.parentId = msg.parentId;
+            hs.decision.validRound = msg.validRound;
+            hs.decision.entries = msg.entries;
+            ConsensusMessage cert = msg;
+            cert.type = ConsensusMessageType::COMMIT;
+            certificates[msg.height] = std::move(cert);
+            while (certificates.size() > CERTIFICATE_HISTORY) {
+                certificates.erase(certificates.begin());
+            }
+            deliverDecided();
+            if (running) {
+                maybeStartNextHeight();
+                evaluateAll();
+            }
+            taken = true;
+        }
+    }
+    flush();
+    return taken;
+}
+
+// Precommits for the value from distinct validators of its height; the
+// signatures were checked on the way in
+bool Consensus::certified(const ConsensusMessage& msg) const {
+    std::vector<int> validators = validatorSchedule.at(msg.height);
+    if (validatorSchedule.empty()) {
+        for (const auto& entry : msg.entries) {
+            if (ValidatorSchedule::isChange(entry) && entry.action == "JOIN" &&
+                entry.playerId == entry.amount) {
+                validators.assign(1, entry.amount);
+                break;
+            }
+        }
+    }
+    return quorumSigned(validators, msg.certificate);
+}
+
+bool Consensus::certifiesSnapshot(const ConsensusMessage& cert,
+                                  const ValidatorSchedule::Sets& offered) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (validatorSchedule.empty()) {
+        return quorumSigned(ValidatorSchedule(offered).at(cert.height), cert.certificate);
+    }
+    return quorumSigned(validatorSchedule.at(cert.height), cert.certificate);
+}
+
+bool Consensus::quorumSigned(const std::vector<int>& validators,
+                             const std::vector<VoteSignature>& certificate) {
+    if (validators.empty()) {
+        return false;
+    }
+    std::set<int> signers;
+    for (const auto& vote : certificate) {
+        if (std::binary_search(validators.begin(), validators.end(), vote.sender)) {
+            signers.insert(vote.sender);
+        }
+    }
+    return signers.size() >= validators.size() - (validators.size() - 1) / 3;
+}
+
+std::string Consensus::computeValueId(const std::string& parentId,
+                                      const std::vector<CommitEntry>& entries) {
+    // Every field length-prefixed, so no two batches share an encoding.
+    // Signatures cover the id, so it has to be collision resistant.
+    std::string data;
+    auto put = [&data](const std::string& s) {
+        data += std::to_string(s.size());
+        data += ':';
+        data += s;
+    };
+    put(parentId);
+    for (const auto& entry : entries) {
+        put(entry.key());
+        put(entry.action);
+        put(entry.phase);
+        put(std::to_string(entry.amount));
+    }
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    if (EVP_Digest(data.data(), data.size(), digest, &len, EVP_sha256(), nullptr) != 1) {
+        throw std::runtime_error("SHA-256 failed");
+    }
+    return ConsensusMessage::toHex(std::string(reinterpret_cast<const char*>(digest), len));
+}
+
+// Self plus the members this node is connected to and believes alive
+std::vector<int> Consensus::localView() const {
+    std::vector<int> ids;
+    ids.push_back(nodeId);
+    MembershipList::Snapshot snap = membershipList.snapshot();
+    ids.insert(ids.end(), snap->nodeIds.begin(), snap->nodeIds.end());
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+bool Consensus::agrees(const CommitEntry& change) const {
+    std::vector<int> view = localView();
+    bool present = std::binary_search(view.begin(), view.end(), change.amount);
+    return change.action == "JOIN" ? present : !present;
+}
+
+// A decided change is still to take effect at or after height, or one is in
+// a value that a height below it builds on
+bool Consensus::changePending(uint64_t height) const {
+    if (!validatorSchedule.empty() && validatorSchedule.sets().rbegin()->first > height) {
+        return true;
+    }
+    for (uint64_t h = nextDeliver; h < height; h++) {
+        auto it = heights.find(h);
+        if (it == heights.end()) {
+            continue;
+        }
+        const HeightState& hs = it->second;
+        auto vit = hs.values.find(hs.decided ? hs.decision.valueId : hs.validValue);
+        if (vit == hs.values.end()) {
+            continue;
+        }
+        for (const auto& entry : vit->second.entries) {
+            if (ValidatorSchedule::isChange(entry)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Heights that started before the schedule was known take it now
+void Consensus::refreshValidators() {
+    for (auto& entry : heights) {
+        if (entry.second.validators.empty() && !entry.second.decided) {
+            entry.second.validators = validatorSchedule.at(entry.first);
+        }
+    }
+}
+
+// A validator submits every difference between its view and the set the
+// schedule ends on, once: it is an ordinary entry from here on.
+void Consensus::proposeMembership() {
+    const std::vector<int>& target = validatorSchedule.latest();
+    if (!std::binary_search(target.begin(), target.end(), nodeId)) {
+        return;
+    }
+    std::vector<int> view = localView();
+    std::vector<CommitEntry> changes;
+    for (int id : view) {
+        if (!std::binary_search(target.begin(), target.end(), id)) {
+            changes.push_back(ValidatorSchedule::change(nodeId, id, true, nextDeliver));
+        }
+    }
+    for (int id : target) {
+        if (!std::binary_search(view.begin(), view.end(), id)) {
+            changes.push_back(ValidatorSchedule::change(nodeId, id, false, nextDeliver));
+        }
+    }
+    for (const auto& change : changes) {
+        bool queued = std::any_of(pending.begin(), pending.end(), [&](const CommitEntry& e) {
+            return e.playerId == nodeId && ValidatorSchedule::isChange(e) &&
+                   e.action == change.action && e.amount == change.amount;
+        });
+        if (!queued && validatorSchedule.changes(change)) {
+            ConsensusMessage msg;
+            msg.type = ConsensusMessageType::ACTION;
+            msg.entries.push_back(change);
+            send(msg);
+        }
+    }
+}
+
+size_t Consensus::faultTolerance(const HeightState& hs) const {
+    return hs.validators.empty() ? 0 : (hs.validators.size() - 1) / 3;
+}
+
+size_t Consensus::quorum(const HeightState& hs) const {
+    return hs.validators.size() - faultTolerance(hs);
+}
+
+int Consensus::proposer(const HeightState& hs, uint64_t height, int round) const {
+    if (hs.validators.empty()) {
+        return -1;
+    }
+    return hs.validators[(height + static_cast<uint64_t>(round)) % hs.validators.size()];
+}
+
+bool Consensus::isValidator(const HeightState& hs, int id) const {
+    return std::binary_search(hs.validators.begin(), hs.validators.end(), id);
+}
+
+size_t Consensus::count(const HeightState& hs, const std::map<int, std::string>& votes,
+                        const std::string& valueId) const {
+    size_t n = 0;
+    for (const auto& vote : votes) {
+        if (vote.second == valueId && isValidator(hs, vote.first)) {
+            n++;
+        }
+    }
+    return n;
+}
+
+size_t Consensus::voters(const HeightState& hs, const std::map<int, std::string>& votes) const {
+    size_t n = 0;
+    for (const auto& vote : votes) {
+        if (isValidator(hs, vote.first)) {
+            n++;
+        }
+    }
+    return n;
+}
+
+// The value this height builds on is settled and is not the proposal's parent
+bool Consensus::orphaned(uint64_t height, const Proposal& proposal) const {
+    if (height == nextDeliver) {
+        return proposal.parentId != lastCommittedId;
+    }
+    auto it = heights.find(height - 1);
+    return it != heights.end() && it->second.decided &&
+           it->second.decision.valueId != proposal.parentId;
+}
+
+const Consensus::Proposal* Consensus::proposalFor(const HeightState& hs, uint64_t height,
+                                                  int round) const {
+    auto rit = hs.rounds.find(round);
+    if (rit == hs.rounds.end()) {
+        return nullptr;
+    }
+    auto pit = rit->second.proposals.find(proposer(hs, height, round));
+    return pit == rit->second.proposals.end() ? nullptr : &pit->second;
+}
+
+void Consensus::startHeight(uint64_t height) {
+    HeightState& hs = heights[height];
+    hs.started = true;
+    hs.heightStart = hs.stepStart = std::chrono::steady_clock::now();
+    hs.validators = validatorSchedule.at(height);
+    startRound(height, 0);
+}
+
+void Consensus::startRound(uint64_t height, int round) {
+    HeightState& hs = heights[height];
+    if (round > 0) {
+        METRIC_COUNT(CONSENSUS_ROUND_CHANGES);
+        enterStep(hs, ConsensusStep::PROPOSE);
+    } else {
+        hs.step = ConsensusStep::PROPOSE;
+    }
+    hs.round = round;
+    tryPropose(height);
+}
+
+// Records how long this node spent in the step it is leaving
+void Consensus::enterStep(HeightState& hs, ConsensusStep step) {
+    METRIC_SINCE(stepHistogram(hs.step), hs.stepStart);
+    hs.step = step;
+    hs.stepStart = std::chrono::steady_clock::now();
+}
+
+// Begin the next height once the newest started one has a value this node
+// precommitted (or decided), keeping at most pipelineDepth heights in flight.
+void Consensus::maybeStartNextHeight() {
+    while (true) {
+        uint64_t top = nextDeliver;
+        bool any = false;
+        for (const auto& entry : heights) {
+            if (entry.second.started) {
+                top = entry.first;
+                any = true;
+            }
+        }
+        if (!any) {
+            startHeight(nextDeliver);
+            continue;
+        }
+        const HeightState& hs = heights[top];
+        bool valueKnown = hs.decided ||
+            (hs.step == ConsensusStep::PRECOMMIT && !hs.lockedValue.empty() &&
+             hs.lockedRound == hs.round);
+        if (!valueKnown || top + 1 - nextDeliver >= config.pipelineDepth) {
+            return;
+        }
+        startHeight(top + 1);
+    }
+}
+
+// The local view only decides which changes this node submits and votes
+// for; the validator set moves when the table decides them.
+void Consensus::onMembershipChanged() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        proposeMembership();
+        onNewWork();
+        evaluateAll();
+    }
+    flush();
+}
+
+void Consensus::onNewWork() {
+    for (auto& entry : heights) {
+        if (entry.second.started && !entry.second.decided) {
+            tryPropose(entry.first);
+        }
+    }
+}
+
+// Proposer sends its batch; everyone else arms the propose timeout once there
+// is work that should be decided, so an idle table does not spin rounds.
+void Consensus::tryPropose(uint64_t height) {
+    HeightState& hs = heights[height];
+    if (hs.step != ConsensusStep::PROPOSE) {
+        return;
+    }
+    if (hs.validators.empty()) {
+        return;
+    }
+    RoundVotes& rv = hs.rounds[hs.round];
+    if (proposer(hs, height, hs.round) == nodeId) {
+        if (rv.proposalSent || backpressure) {
+            return;
+        }
+        Proposal proposal;
+        if (!hs.validValue.empty() && hs.values.count(hs.validValue)) {
+            proposal = hs.values[hs.validValue];
+            proposal.validRound = hs.validRound;
+        } else {
+            if (!expectedParent(height, proposal.parentId)) {
+                armProposeTimeout(height, hs, rv, false);
+                return;
+            }
+            proposal.entries = collectBatch(height);
+            if (proposal.entries.empty() && !changePending(height)) {
+                armProposeTimeout(height, hs, rv, false);
+                return;
+            }
+            proposal.validRound = -1;
+            proposal.valueId = computeValueId(proposal.parentId, proposal.entries);
+        }
+        rv.proposalSent = true;
+
+        ConsensusMessage msg;
+        msg.type = ConsensusMessageType::PROPOSAL;
+        msg.height = height;
+        msg.round = hs.round;
+        msg.valueId = proposal.valueId;
+        msg.parentId = proposal.parentId;
+        msg.validRound = proposal.validRound;
+        msg.entries = proposal.entries;
+        send(msg);
+    } else if (!rv.proposeTimeoutScheduled) {
+        armProposeTimeout(height, hs, rv, !collectBatch(height).empty() || changePending(height));
+    }
+}
+
+// Idle heights wait for work without timers. Once a round has traffic (or
+// is past round 0) it must not wait forever on a proposal this node missed
+// or, as proposer, has nothing to fill: the timeout prevotes nil, which also
+// tells peers that already decided to send the certificate.
+void Consensus::armProposeTimeout(uint64_t height, HeightState& hs, RoundVotes& rv,
+                                  bool haveWork) {
+    bool active = haveWork || hs.round > 0 || !rv.proposals.empty() ||
+                  !rv.prevotes.empty() || !rv.precommits.empty();
+    if (rv.proposeTimeoutScheduled || !active) {
+        return;
+    }
+    rv.proposeTimeoutScheduled = true;
+    scheduleTimeout(config.timeoutPropose, hs.round, &Consensus::onTimeoutPropose, height);
+}
+
+bool Consensus::expectedParent(uint64_t height, std::string& parent) const {
+    if (height == nextDeliver) {
+        parent = lastCommittedId;
+        return true;
+    }
+    auto it = heights.find(height - 1);
+    if (it == heights.end()) {
+        return false;
+    }
+    const HeightState& prev = it->second;
+    if (prev.decided) {
+        parent = prev.decision.valueId;
+        return true;
+    }
+    if (!prev.validValue.empty()) {
+        parent = prev.validValue;
+        return true;
+    }
+    return false;
+}
+
+// Keys already claimed by the values that heights below this one build on.
+std::set<std::string> Consensus::inflightKeys(uint64_t height) const {
+    std::set<std::string> keys;
+    for (uint64_t h = nextDeliver; h < height; h++) {
+        auto it = heights.find(h);
+        if (it == heights.end()) {
+            continue;
+        }
+        const HeightState& hs = it->second;
+        const std::string& id = hs.decided ? hs.decision.valueId : hs.validValue;
+        auto vit = hs.values.find(id);
+        if (vit == hs.values.end()) {
+            continue;
+        }
+        for (const auto& entry : vit->second.entries) {
+            keys.insert(entry.key());
+        }
+    }
+    return keys;
+}
+
+// Entries of players who do not validate this height yet, and changes this
+// node would not vote for, wait in the pool.
+std::vector<CommitEntry> Consensus::collectBatch(uint64_t height) const {
+    std::set<std::string> skip = inflightKeys(height);
+    auto it = heights.find(height);
+    std::vector<CommitEntry> batch;
+    for (const auto& entry : pending) {
+        if (batch.size() >= config.maxBatchSize || it == heights.end()) {
+            break;
+        }
+        if (!skip.count(entry.key()) && isValidator(it->second, entry.playerId) &&
+            (!ValidatorSchedule::isChange(entry) || agrees(entry))) {
+            batch.push_back(entry);
+        }
+    }
+    return batch;
+}
+
+// Empty batches are well formed (they carry a change into effect); whether
+// one is needed is for each voter to judge.
+bool Consensus::wellFormed(const HeightState& hs, const Proposal& proposal) const {
+    if (proposal.entries.size() > config.maxBatchSize) {
+        return false;
+    }
+    std::set<std::string> seen;
+    for (const auto& entry : proposal.entries) {
+        if (!isValidator(hs, entry.playerId) || entry.amount < 0 ||
+            committed.contains(entry) || !seen.insert(entry.key()).second) {
+            return false;
+        }
+        if (ValidatorSchedule::isChange(entry) && entry.action != "JOIN" &&
+            entry.action != "LEAVE") {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Consensus::validValueFor(uint64_t height, const Proposal& proposal) const {
+    auto it = heights.find(height);
+    if (it == heights.end() || !wellFormed(it->second, proposal) ||
+        (proposal.entries.empty() && !changePending(height))) {
+        return false;
+    }
+    for (const auto& entry : proposal.entries) {
+        if (ValidatorSchedule::isChange(entry) && !agrees(entry)) {
+            return false;
+        }
+    }
+    std::string parent;
+    if (!expectedParent(height, parent) || parent != proposal.parentId) {
+        return false;
+    }
+    std::set<std::string> claimed = inflightKeys(height);
+    for (const auto& entry : proposal.entries) {
+        if (claimed.count(entry.key())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Consensus::send(ConsensusMessage msg) {
+    msg.sender = nodeId;
+    if (msg.type == ConsensusMessageType::PROPOSAL && sign) {
+        msg.signature = sign(msg.signedBytes());
+    }
+    if (msg.isVote()) {
+        if (sign) {
+            msg.signature = sign(msg.signedBytes());
+        }
+        RoundVotes& rv = heights[msg.height].rounds[msg.round];
+        if (!rv.rebroadcastScheduled) {
+            rv.rebroadcastScheduled = true;
+            scheduleTimeout(config.timeoutPropose, msg.round, &Consensus::onTimeoutRebroadcast,
+                            msg.height);
+        }
+    }
+    outbox.push_back(msg);
+    record(msg);
+}
+
+void Consensus::record(const ConsensusMessage& msg) {
+    if (msg.type == ConsensusMessageType::ACTION) {
+        for (const auto& entry : msg.entries) {
+            std::string key = entry.key();
+            if (!committed.contains(entry) && pendingKeys.insert(key).second) {
+                pending.push_back(entry);
+            }
+        }
+        return;
+    }
+    if (msg.height < nextDeliver) {
+        // The sender is still working on a height decided here
+        if (msg.type != ConsensusMessageType::COMMIT && msg.sender != nodeId) {
+            sendCertificate(msg.sender, msg.height);
+        }
+        return;
+    }
+    if (msg.height >= nextDeliver + kMaxHeightsAhead) {
+        return;
+    }
+    if (msg.type == ConsensusMessageType::COMMIT) {
+        recordCertificate(msg);
+        return;
+    }
+    HeightState& hs = heights[msg.height];
+    RoundVotes& rv = hs.rounds[msg.round];
+    switch (msg.type) {
+        case ConsensusMessageType::PROPOSAL: {
+            Proposal proposal;
+            proposal.parentId = msg.parentId;
+            proposal.validRound = msg.validRound;
+            proposal.entries = msg.entries;
+            proposal.signature = msg.signature;
+            proposal.valueId = computeValueId(msg.parentId, msg.entries);
+            if (proposal.valueId != msg.valueId) {
+                return;
+            }
+            rv.proposals.emplace(msg.sender, proposal);
+            hs.values.emplace(proposal.valueId, proposal);
+            break;
+        }
+        case ConsensusMessageType::PREVOTE:
+            if (rv.prevotes.emplace(msg.sender, msg.valueId).second) {
+                rv.prevoteSigs[msg.sender] = msg.signature;
+            }
+            break;
+        case ConsensusMessageType::PRECOMMIT:
+            if (rv.precommits.emplace(msg.sender, msg.valueId).second) {
+                rv.precommitSigs[msg.sender] = msg.signature;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// A certificate stands in for the proposal and precommits it carries; the
+// usual decision rule then fires once the height is running.
+void Consensus::recordCertificate(const ConsensusMessage& msg) {
+    if (computeValueId(msg.parentId, msg.entries) != msg.valueId) {
+        return;
+    }
+    HeightState& hs = heights[msg.height];
+    if (hs.validators.empty()) {
+        hs.validators = validatorSchedule.at(msg.height);
+    }
+    RoundVotes& rv = hs.rounds[msg.round];
+    Proposal proposal;
+    proposal.valueId = msg.valueId;
+    proposal.parentId = msg.parentId;
+    proposal.validRound = msg.validRound;
+    proposal.entries = msg.entries;
+    rv.proposals[proposer(hs, msg.height, msg.round)] = proposal;
+    hs.values.emplace(proposal.valueId, proposal);
+    for (const auto& vote : msg.certificate) {
+        rv.precommits[vote.sender] = msg.valueId;
+        rv.precommitSigs[vote.sender] = vote.signature;
+    }
+}
+
+void Consensus::storeCertificate(uint64_t height, const HeightState& hs, const Proposal& value) {
+    ConsensusMessage cert;
+    cert.type = ConsensusMessageType::COMMIT;
+    cert.sender = nodeId;
+    cert.height = height;
+    cert.valueId = value.valueId;
+    cert.parentId = value.parentId;
+    cert.validRound = value.validRound;
+    cert.entries = value.entries;
+    for (const auto& round : hs.rounds) {
+        if (count(hs, round.second.precommits, value.valueId) < quorum(hs)) {
+            continue;
+        }
+        cert.round = round.first;
+        for (const auto& vote : round.second.precommits) {
+            if (vote.second == value.valueId && isValidator(hs, vote.first)) {
+                auto sig = round.second.precommitSigs.find(vote.first);
+                VoteSignature signature;
+                signature.sender = vote.first;
+                signature.signature = sig == round.second.precommitSigs.end() ? "" : sig->second;
+                cert.certificate.push_back(signature);
+            }
+        }
+        break;
+    }
+    certificates[height] = std::move(cert);
+    while (certificates.size() > CERTIFICATE_HISTORY) {
+        certificates.erase(certificates.begin());
+    }
+}
+
+void Consensus::sendCertificate(int peer, uint64_t height) {
+    auto it = certificates.find(height);
+    if (it == certificates.end()) {
+        return;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    auto& last = certificateSent[peer];
+    if (last.first == height && now - last.second < kCertificateResend) {
+        return;
+    }
+    last = std::make_pair(height, now);
+    directOutbox.emplace_back(peer, it->second);
+}
+
+void Consensus::evaluateAll() {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        std::vector<uint64_t> active;
+        for (const auto& entry : heights) {
+            if (entry.second.started) {
+                active.push_back(entry.first);
+            }
+        }
+        for (uint64_t height : active) {
+            while (heights.count(height) && advance(height)) {
+                changed = true;
+            }
+        }
+        if (changed) {
+            maybeStartNextHeight();
+        }
+    }
+}
+
+// Applies at most one rule of the Tendermint state machine to a height and
+// reports whether anything changed.
+bool Consensus::advance(uint64_t height) {
+    HeightState& hs = heights[height];
+    if (!hs.started || hs.decided || hs.validators.empty()) {
+        return false;
+    }
+    const int r = hs.round;
+    RoundVotes& rv = hs.rounds[r];
+    const size_t q = quorum(hs);
+    const Proposal* proposal = proposalFor(hs, height, r);
+
+    // Decision: a proposal of any round with 2f+1 precommits for it. Parent
+    // validity is re-checked when the height is delivered; a value whose
+    // parent already lost is skipped, or the rounds that decided it would
+    // decide it again every time the height restarts.
+    for (const auto& entry : hs.rounds) {
+        const Proposal* p = proposalFor(hs, height, entry.first);
+        if (p && count(hs, entry.second.precommits, p->valueId) >= q && wellFormed(hs, *p) &&
+            !orphaned(height, *p)) {
+            decide(height, *p);
+            return true;
+        }
+    }
+
+    if (hs.step == ConsensusStep::PROPOSE && !proposal) {
+        armProposeTimeout(height, hs, rv, false);
+    }
+
+    if (hs.step == ConsensusStep::PROPOSE && proposal) {
+        bool vote = false;
+        bool act = false;
+        if (proposal->validRound < 0) {
+            act = true;
+            vote = validValueFor(height, *proposal) &&
+                   (hs.lockedRound == -1 || hs.lockedValue == proposal->valueId);
+        } else if (proposal->validRound < r) {
+            auto vr = hs.rounds.find(proposal->validRound);
+            if (vr != hs.rounds.end() && count(hs, vr->second.prevotes, proposal->valueId) >= q) {
+                act = true;
+                vote = validValueFor(height, *proposal) &&
+                       (hs.lockedRound <= proposal->validRound ||
+                        hs.lockedValue == proposal->valueId);
+            }
+        }
+        if (act) {
+            ConsensusMessage msg;
+            msg.type = ConsensusMessageType::PREVOTE;
+            msg.height = height;
+            msg.round = r;
+            msg.valueId = vote ? proposal->valueId : "";
+            enterStep(hs, ConsensusStep::PREVOTE);
+            send(msg);
+            return true;
+        }
+    }
+
+    if (hs.step == ConsensusStep::PREVOTE && !rv.prevoteTimeoutScheduled &&
+        voters(hs, rv.prevotes) >= q) {
+        rv.prevoteTimeoutScheduled = true;
+        scheduleTimeout(config.timeoutPrevote, r, &Consensus::onTimeoutPrevote, height);
+        return true;
+    }
+
+    if (proposal && !rv.polkaSeen && hs.step != ConsensusStep::PROPOSE &&
+        count(hs, rv.prevotes, proposal->valueId) >= q && validValueFor(height, *proposal)) {
+        rv.polkaSeen = true;
+        if (hs.step == ConsensusStep::PREVOTE) {
+            hs.lockedValue = proposal->valueId;
+            hs.lockedRound = r;
+            ConsensusMessage msg;
+            msg.type = ConsensusMessageType::PRECOMMIT;
+            msg.height = height;
+            msg.round = r;
+            msg.valueId = proposal->valueId;
+            enterStep(hs, ConsensusStep::PRECOMMIT);
+            send(msg);
+        }
+        hs.validValue = proposal->valueId;
+        hs.validRound = r;
+        return true;
+    }
+
+    if (hs.step == ConsensusStep::PREVOTE && count(hs, rv.prevotes, "") >= q) {
+        ConsensusMessage msg;
+        msg.type = ConsensusMessageType::PRECOMMIT;
+        msg.height = height;
+        msg.round = r;
+        enterStep(hs, ConsensusStep::PRECOMMIT);
+        send(msg);
+        return true;
+    }
+
+    if (!rv.precommitTimeoutScheduled && voters(hs, rv.precommits) >= q) {
+        rv.precommitTimeoutScheduled = true;
+        scheduleTimeout(config.timeoutPrecommit, r, &Consensus::onTimeoutPrecommit, height);
+        return true;
+    }
+
+    // Skip ahead when f+1 validators are already in a later round
+    for (auto it = hs.rounds.upper_bound(r); it != hs.rounds.end(); ++it) {
+        std::set<int> senders;
+        for (const auto& p : it->second.proposals) senders.insert(p.first);
+        for (const auto& v : it->second.prevotes) senders.insert(v.first);
+        for (const auto& v : it->second.precommits) senders.insert(v.first);
+        size_t n = 0;
+        for (int sender : senders) {
+            if (isValidator(hs, sender)) {
+                n++;
+            }
+        }
+        if (n >= faultTolerance(hs) + 1) {
+            startRound(height, it->first);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Consensus::decide(uint64_t height, const Proposal& value) {
+    HeightState& hs = heights[height];
+    METRIC_SINCE(stepHistogram(hs.step), hs.stepStart);
+    METRIC_SINCE(metrics::CONSENSUS_HEIGHT_NS, hs.heightStart);
+    METRIC_COUNT(CONSENSUS_HEIGHTS_DECIDED);
+    hs.decided = true;
+    hs.decision = value;
+    storeCertificate(height, hs, value);
+    deliverDecided();
+}
+
+void Consensus::deliverDecided() {
+    while (true) {
+        auto it = heights.find(nextDeliver);
+        if (it == heights.end() || !it->second.decided) {
+            break;
+        }
+        HeightState& hs = it->second;
+        if (hs.decision.parentId != lastCommittedId) {
+            // Built on a value that lost at the previous height: run it again
+            certificates.erase(nextDeliver);
+            hs.decided = false;
+            hs.lockedValue.clear();
+            hs.lockedRound = -1;
+            hs.validValue.clear();
+            hs.validRound = -1;
+            startRound(nextDeliver, hs.round + 1);
+            break;
+        }
+
+        for (const auto& entry : hs.decision.entries) {
+            committed.add(entry);
+        }
+        auto cert = certificates.find(nextDeliver);
+        if (cert != certificates.end()) {
+            decidedQueue.push_back(cert->second);
+        } else {
+            storeCertificate(nextDeliver, hs, hs.decision);
+            decidedQueue.push_back(certificates[nextDeliver]);
+        }
+        lastCommittedId = hs.decision.valueId;
+        validatorSchedule.apply(nextDeliver, hs.decision.entries);
+        heights.erase(it);
+        nextDeliver++;
+        committed.advance(nextDeliver);
+        validatorSchedule.prune(nextDeliver);
+        refreshValidators();
+        // Entries decided (or stale) now, and changes that are already in
+        // effect, whoever submitted them
+        pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                     [this](const CommitEntry& e) {
+                                         if (!committed.contains(e) &&
+                                             (!ValidatorSchedule::isChange(e) ||
+                                              validatorSchedule.changes(e))) {
+                                             return false;
+                                         }
+                                         pendingKeys.erase(e.key());
+                                         return true;
+                                     }),
+                      pending.end());
+        proposeMembership();
+
+        // Locks on values built on a different parent can never be decided
+        auto next = heights.find(nextDeliver);
+        if (next != heights.end()) {
+            HeightState& ns = next->second;
+            auto stale = [&](const std::string& id) {
+                auto vit = ns.values.find(id);
+                return !id.empty() &&
+                       (vit == ns.values.end() || vit->second.parentId != lastCommittedId);
+            };
+            if (stale(ns.lockedValue)) {
+                ns.lockedValue.clear();
+                ns.lockedRound = -1;
+            }
+            if (stale(ns.validValue)) {
+                ns.validValue.clear();
+                ns.validRound = -1;
+            }
+        }
+    }
+}
+
+void Consensus::flush() {
+    std::vector<ConsensusMessage> messages;
+    std::vector<std::pair<int, ConsensusMessage>> direct;
+    SendToFn directSend;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        messages.swap(outbox);
+        direct.swap(directOutbox);
+        directSend = sendTo;
+    }
+    for (const auto& msg : messages) {
+        if (broadcast) {
+            broadcast(msg);
+        }
+    }
+    for (const auto& entry : direct) {
+        if (directSend) {
+            directSend(entry.first, entry.second);
+        } else if (broadcast) {
+            broadcast(entry.second);
+        }
+    }
+
+    // Decided heights reach the commit callback in order: one thread drains
+    // the queue while others leave their share to it
+    std::vector<ConsensusMessage> decided;
+    DecidedFn decidedSink;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (delivering) {
+            return;
+        }
+        delivering = true;
+        decidedSink = decidedFn;
+    }
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            decided.clear();
+            decided.swap(decidedQueue);
+            if (decided.empty()) {
+                delivering = false;
+                return;
+            }
+        }
+        size_t done = 0;
+        try {
+            for (; done < decided.size(); done++) {
+                if (decidedSink) {
+                    decidedSink(decided[done]);
+                } else if (commit) {
+                    commit(decided[done].height, decided[done].entries);
+                }
+            }
+        } catch (...) {
+            // Hand the heights after the failed one to the next flush
+            std::lock_guard<std::mutex> lock(mtx);
+            decidedQueue.insert(decidedQueue.begin(),
+                                std::make_move_iterator(decided.begin() + done + 1),
+                                std::make_move_iterator(decided.end()));
+            delivering = false;
+            throw;
+        }
+    }
+}
+
+void Consensus::scheduleTimeout(std::chrono::milliseconds base, int round,
+                                void (Consensus::*fn)(uint64_t, int), uint64_t height) {
+    if (!schedule) {
+        return;
+    }
+    // Rounds that keep failing are usually a slow or partitioned link, so
+    // give each one more time than the last
+    double scaled = base.count() * std::pow(config.timeoutBackoff, round);
+    std::chrono::milliseconds delay = scaled >= config.timeoutMax.count()
+        ? config.timeoutMax
+        : std::chrono::milliseconds(static_cast<int64_t>(scaled));
+    schedule(delay, [this, fn, height, round]() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            (this->*fn)(height, round);
+            evaluateAll();
+        }
+        flush();
+    });
+}
+
+void Consensus::onTimeoutPropose(uint64_t height, int round) {
+    auto it = heights.find(height);
+    if (it == heights.end() || it->second.decided) {
+        return;
+    }
+    HeightState& hs = it->second;
+    if (hs.round == round && hs.step == ConsensusStep::PROPOSE) {
+        ConsensusMessage msg;
+        msg.type = ConsensusMessageType::PREVOTE;
+        msg.height = height;
+        msg.round = round;
+        enterStep(hs, ConsensusStep::PREVOTE);
+        send(msg);
+    }
+}
+
+void Consensus::onTimeoutPrevote(uint64_t height, int round) {
+    auto it = heights.find(height);
+    if (it == heights.end() || it->second.decided) {
+        return;
+    }
+    HeightState& hs = it->second;
+    if (hs.round == round && hs.step == ConsensusStep::PREVOTE) {
+        ConsensusMessage msg;
+        msg.type = ConsensusMessageType::PRECOMMIT;
+        msg.height = height;
+        msg.round = round;
+        enterStep(hs, ConsensusStep::PRECOMMIT);
+        send(msg);
+    }
+}
+
+// Still in the round this node voted in: send its own messages for the
+// round again, in case they (or the replies) were lost
+void Consensus::onTimeoutRebroadcast(uint64_t height, int round) {
+    auto it = heights.find(height);
+    if (it == heights.end() || it->second.decided || it->second.round != round) {
+        return;
+    }
+    RoundVotes& rv = it->second.rounds[round];
+    auto proposal = rv.proposals.find(nodeId);
+    if (proposal != rv.proposals.end()) {
+        ConsensusMessage msg;
+        msg.type = ConsensusMessageType::PROPOSAL;
+        msg.sender = nodeId;
+        msg.height = height;
+        msg.round = round;
+        msg.valueId = proposal->second.valueId;
+        msg.parentId = proposal->second.parentId;
+        msg.validRound = proposal->second.validRound;
+        msg.entries = proposal->second.entries;
+        msg.signature = proposal->second.signature;
+        outbox.push_back(msg);
+    }
+    auto resend = [&](ConsensusMessageType type, const std::map<int, std::string>& votes,
+                      const std::map<int, std::string>& sigs) {
+        auto vote = votes.find(nodeId);
+        if (vote == votes.end()) {
+            return;
+        }
+        ConsensusMessage msg;
+        msg.type = type;
+        msg.sender = nodeId;
+        msg.height = height;
+        msg.round = round;
+        msg.valueId = vote->second;
+        auto sig = sigs.find(nodeId);
+        if (sig != sigs.end()) {
+            msg.signature = sig->second;
+        }
+        outbox.push_back(msg);
+    };
+    resend(ConsensusMessageType::PREVOTE, rv.prevotes, rv.prevoteSigs);
+    resend(ConsensusMessageType::PRECOMMIT, rv.precommits, rv.precommitSigs);
+    scheduleTimeout(config.timeoutPropose, round, &Consensus::onTimeoutRebroadcast, height);
+}
+
+void Consensus::onTimeoutPrecommit(uint64_t height, int round) {
+    auto it = heights.find(height);
+    if (it == heights.end() || it->second.decided) {
+        return;
+    }
+    if (it->second.round == round) {
+        startRound(height, round + 1);
+    }
+}
@@ -0,0 +1,401 @@
+// src/network/Consensus.h
+#pragma once
+#include "MembershipList.h"
+#include <json/json.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+// One player action agreed on by the table. A height decides a batch of these.
+struct CommitEntry {
+    int playerId;
+    uint64_t seq;          // per-player sequence number, increasing; makes entries unique
+    std::string action;    // e.g. "BET", "CALL", "FOLD"
+    std::string phase;     // game phase the action belongs to
+    int amount;
+
+    CommitEntry() : playerId(-1), seq(0), amount(0) {}
+
+    std::string key() const { return std::to_string(playerId) + ":" + std::to_string(seq); }
+
+    Json::Value toJson() const;
+    static CommitEntry fromJson(const Json::Value& value);
+};
+
+// Validator sets by the height they take effect at. The set changes only
+// through decided entries (see change()), each taking effect DELAY heights
+// after the height that decided it, so every node switches at the same
+// height and heights already in flight keep the set they started with. On
+// an empty schedule the first decided JOIN a node makes of itself is the
+// genesis: that node alone, from the next height on.
+class ValidatorSchedule {
+public:
+    using Sets = std::map<uint64_t, std::vector<int>>;
+
+    static const uint64_t DELAY = 4;
+    static const char* const PHASE;   // phase of membership entries
+
+    ValidatorSchedule() {}
+    explicit ValidatorSchedule(Sets initial) : byHeight(std::move(initial)) {}
+
+    bool empty() const { return byHeight.empty(); }
+    // Sorted ids voting at height; empty before the genesis
+    const std::vector<int>& at(uint64_t height) const;
+    // The set once every decided change is in effect
+    const std::vector<int>& latest() const;
+    // Whether a change entry, decided now, would alter latest()
+    bool changes(const CommitEntry& entry) const;
+    // Folds in the change entries of a decided height
+    void apply(uint64_t height, const std::vector<CommitEntry>& entries);
+    // This node alone from height on; ignored once there is a set
+    void found(uint64_t height, int id);
+    // Forgets the sets no height from `height` on can use
+    void prune(uint64_t height);
+    const Sets& sets() const { return byHeight; }
+
+    // JOIN or LEAVE of `subject` (in amount), submitted by a validator. The
+    // top bit of seq keeps it apart from the submitter's own actions.
+    static CommitEntry change(int submitter, int subject, bool join, uint64_t height);
+    static bool isChange(const CommitEntry& entry) { return entry.phase == PHASE; }
+    static bool isChangeSeq(uint64_t seq) { return (seq >> 63) != 0; }
+    // Height a change was submitted at
+    static uint64_t submittedAt(uint64_t seq) { return (seq & ~(uint64_t(1) << 63)) >> 21; }
+
+private:
+    Sets byHeight;
+};
+
+// What the duplicate check needs of every entry decided so far, in space
+// that does not grow with the table's history: each player's highest
+// decided action seq (a player's actions are decided in seq order, so one
+// at or below it is a repeat), and the membership changes submitted in the
+// last CHANGE_WINDOW heights. An older change counts as decided whether it
+// was or not; if it is still wanted, its submitter sends a fresh one.
+class CommittedEntries {
+public:
+    using Changes = std::set<std::pair<int, uint64_t>>;   // (submitter, seq)
+
+    static const uint64_t CHANGE_WINDOW = 64;
+
+    CommittedEntries() : floor(0) {}
+
+    bool contains(int playerId, uint64_t seq) const;
+    bool contains(const CommitEntry& entry) const { return contains(entry.playerId, entry.seq); }
+    void add(int playerId, uint64_t seq);
+    void add(const CommitEntry& entry) { add(entry.playerId, entry.seq); }
+    // Takes in everything `other` has decided
+    void merge(const CommittedEntries& other);
+    // Heights below nextHeight are decided: drops the changes now stale
+    void advance(uint64_t nextHeight);
+
+    const std::map<int, uint64_t>& highest() const { return highestSeq; }
+    const Changes& changes() const { return recentChanges; }
+
+private:
+    std::map<int, uint64_t> highestSeq;
+    Changes recentChanges;
+    uint64_t floor;   // changes submitted below this are stale
+};
+
+enum class ConsensusStep {
+    PROPOSE,
+    PREVOTE,
+    PRECOMMIT
+};
+
+enum class ConsensusMessageType {
+    ACTION,     // a player hands an entry to every proposer's pending pool
+    PROPOSAL,
+    PREVOTE,
+    PRECOMMIT,
+    COMMIT      // a decided proposal with the precommits that decided it
+};
+
+struct VoteSignature {
+    int sender;
+    std::string signature;
+};
+
+struct ConsensusMessage {
+    ConsensusMessageType type;
+    int sender;
+    uint64_t height;
+    int round;
+    std::string valueId;               // empty means nil
+    std::string parentId;              // PROPOSAL: value this batch builds on
+    int validRound;                    // PROPOSAL: -1 when not re-proposing
+    std::vector<CommitEntry> entries;  // PROPOSAL / COMMIT batch or single ACTION
+    std::string signature;             // PROPOSAL / PREVOTE / PRECOMMIT: sender's over signedBytes()
+    std::vector<VoteSignature> certificate;   // COMMIT: precommits for valueId at round
+
+    ConsensusMessage()
+        : type(ConsensusMessageType::PREVOTE), sender(-1), height(0), round(0), validRound(-1) {}
+
+    bool isVote() const {
+        return type == ConsensusMessageType::PREVOTE || type == ConsensusMessageType::PRECOMMIT;
+    }
+    // What a vote signature covers
+    static std::string voteBytes(ConsensusMessageType type, int sender, uint64_t height,
+                                 int round, const std::string& valueId);
+    std::string voteBytes() const { return voteBytes(type, sender, height, round, valueId); }
+    // What a proposal signature covers; valueId commits to parent and entries
+    static std::string proposalBytes(int sender, uint64_t height, int round, int validRound,
+                                     const std::string& valueId);
+    // The bytes this message's own signature covers
+    std::string signedBytes() const;
+
+    Json::Value toJson() const;
+    static bool fromJson(const Json::Value& value, ConsensusMessage& out);
+    static bool isConsensusType(const std::string& type);
+
+    // Binary fields (signatures, keys) as they travel in JSON
+    static std::string toHex(const std::string& bytes);
+    static std::string fromHex(const std::string& hex);
+};
+
+struct ConsensusConfig {
+    size_t maxBatchSize = 16;
+    size_t pipelineDepth = 2;   // heights allowed in flight at once
+    std::chrono::milliseconds timeoutPropose{1000};
+    std::chrono::milliseconds timeoutPrevote{500};
+    std::chrono::milliseconds timeoutPrecommit{500};
+    double timeoutBackoff = 1.5;                   // timeouts grow by this each round
+    std::chrono::milliseconds timeoutMax{8000};    // ... up to this
+};
+
+// Tendermint-style BFT agreement on batches of CommitEntry.
+//
+// Height h+1 is started as soon as this node has precommitted a value for h,
+// so its PROPOSE/PREVOTE phases overlap with h's PRECOMMIT collection. Each
+// proposal names the value it builds on (parentId); decisions are delivered
+// strictly in height order and a decided h+1 whose parent lost at h is
+// discarded and re-run.
+//
+// Proposals and votes carry signatures; checking them is the caller's job
+// (see VoteVerifier), this class only signs its own.
+//
+// Who votes comes from the ValidatorSchedule, never from the local
+// MembershipList: that is only this node's view (who it is connected to and
+// believes alive). A validator whose view differs from the schedule submits
+// the difference as JOIN / LEAVE entries and prevotes a change only when its
+// own view agrees, so a change needs 2f+1 validators to see it. While a
+// decided change waits to take effect, proposers fill the heights in
+// between with empty batches. Everyone else still runs the rounds, though
+// their votes count for nothing: a nil prevote is how a follower that missed
+// a decision gets the certificate for it. The precommits that decide
+// a height are kept as a certificate: a peer still voting on a height this
+// node has decided gets that one COMMIT message back, and an undecided
+// round re-sends this node's own votes until it moves on, so lost votes do
+// not stall the table.
+class Consensus {
+public:
+    using BroadcastFn = std::function<void(const ConsensusMessage&)>;
+    using CommitFn = std::function<void(uint64_t height, const std::vector<CommitEntry>&)>;
+    // Gets a delivered height as a COMMIT: the batch plus the round and
+    // precommits that decided it
+    using DecidedFn = std::function<void(const ConsensusMessage& decided)>;
+    using ScheduleFn = std::function<void(std::chrono::milliseconds, std::function<void()>)>;
+    using SignFn = std::function<std::string(const std::string& bytes)>;
+    using SendToFn = std::function<void(int peer, const ConsensusMessage&)>;
+
+    static const size_t CERTIFICATE_HISTORY = 64;   // decided heights kept for stragglers
+
+    Consensus(int nodeId,
+              MembershipList& list,
+              BroadcastFn broadcast,
+              CommitFn commit,
+              ScheduleFn schedule,
+              ConsensusConfig config = ConsensusConfig());
+    ~Consensus();
+
+    Consensus(const Consensus&) = delete;
+    Consensus& operator=(const Consensus&) = delete;
+
+    // Own proposals and votes are signed with this; set before start().
+    // Without one they go out unsigned.
+    void setSigner(SignFn signer);
+    // Point-to-point sends (certificates for lagging peers); broadcast is
+    // used when unset.
+    void setSendTo(SendToFn sendTo);
+    // Called instead of the commit callback when set, for callers that keep
+    // the certificates (e.g. to serve state transfer)
+    void setDecidedHandler(DecidedFn decided);
+
+    void start();
+    void submit(const CommitEntry& entry);
+    void onMessage(const ConsensusMessage& msg);
+    // A batch already checked (e.g. vote signatures), evaluated in one pass
+    void onMessages(const std::vector<ConsensusMessage>& msgs);
+    // While set, this node holds back new proposals (votes still go out)
+    // so a slow link is not flooded with batches it cannot drain.
+    void setBackpressure(bool congested);
+
+    // Starts a table nobody else holds: this node alone validates, and the
+    // first height it decides records that for everyone who syncs later.
+    // Ignored once there is a validator set.
+    void found();
+    // Who validates the next height to decide (empty until founded or
+    // synced); decided changes join it once they take effect
+    std::vector<int> validatorSet() const;
+
+    uint64_t committedHeight() const;
+    // Whether a peer at work on `height` has decided heights this node has
+    // not: the height is past this node's pipeline, or this node has no
+    // validator set to follow it with yet
+    bool behind(uint64_t height) const;
+    // Round this node is in at committedHeight()
+    int currentRound() const;
+    // Resume from what the game log or a transferred snapshot holds: heights
+    // below nextHeight are done, lastValueId is the value they ended on and
+    // validators the schedule they left. While running it only ever moves
+    // forward.
+    void restore(uint64_t nextHeight, const std::string& lastValueId,
+                 const CommittedEntries& committedEntries,
+                 const ValidatorSchedule::Sets& validators);
+    // Deliver a height decided without this node (a COMMIT-shaped message
+    // from state transfer). Taken only if it extends exactly what has been
+    // delivered so far and its certificate holds precommits from a quorum
+    // of that height's validators; the caller has already dropped the
+    // signatures that do not verify. The height that founds a table has no
+    // schedule to check against, so there the founder's own precommit is
+    // the quorum. Returns whether it was taken.
+    bool adoptDecided(const ConsensusMessage& msg);
+    // Whether a transferred snapshot may be installed: `cert` is the COMMIT
+    // for its last height (already filtered to the signatures that verify)
+    // and must hold precommits from a quorum of that height's validators as
+    // this node already knows them. A node that knows none yet, joining for
+    // the first time, can only take the snapshot's own schedule, as a
+    // founding height is taken on the founder's word.
+    bool certifiesSnapshot(const ConsensusMessage& cert, const ValidatorSchedule::Sets& offered) const;
+
+    // Parent of the first height
+    static const std::string GENESIS_ID;
+    // Hex SHA-256 over the parent and every entry field
+    static std::string computeValueId(const std::string& parentId,
+                                      const std::vector<CommitEntry>& entries);
+
+private:
+    struct Proposal {
+        std::string valueId;
+        std::string parentId;
+        int validRound = -1;
+        std::vector<CommitEntry> entries;
+        std::string signature;   // proposer's, kept for rebroadcast
+    };
+
+    struct RoundVotes {
+        std::map<int, Proposal> proposals;      // sender -> proposal
+        std::map<int, std::string> prevotes;    // sender -> valueId
+        std::map<int, std::string> precommits;
+        std::map<int, std::string> prevoteSigs;
+        std::map<int, std::string> precommitSigs;
+        bool proposalSent = false;
+        bool rebroadcastScheduled = false;
+        bool proposeTimeoutScheduled = false;
+        bool prevoteTimeoutScheduled = false;
+        bool precommitTimeoutScheduled = false;
+        bool polkaSeen = false;
+    };
+
+    struct HeightState {
+        bool started = false;
+        int round = 0;
+        ConsensusStep step = ConsensusStep::PROPOSE;
+        std::vector<int> validators;
+        std::string lockedValue;
+        int lockedRound = -1;
+        std::string validValue;
+        int validRound = -1;
+        std::map<std::string, Proposal> values;   // valueId -> full proposal
+        std::map<int, RoundVotes> rounds;
+        bool decided = false;
+        Proposal decision;
+        std::chrono::steady_clock::time_point heightStart;
+        std::chrono::steady_clock::time_point stepStart;
+    };
+
+    int nodeId;
+    MembershipList& membershipList;
+    int membershipSubscription;
+    BroadcastFn broadcast;
+    CommitFn commit;
+    ScheduleFn schedule;
+    SignFn sign;
+    SendToFn sendTo;
+    DecidedFn decidedFn;
+    ConsensusConfig config;
+
+    mutable std::mutex mtx;
+    std::map<uint64_t, HeightState> heights;
+    ValidatorSchedule validatorSchedule;
+    std::vector<CommitEntry> pending;             // arrival order
+    std::set<std::string> pendingKeys;
+    CommittedEntries committed;                   // for the duplicate check
+    bool backpressure;
+    bool running;
+    bool delivering;                              // a thread is handing out decidedQueue
+    uint64_t nextDeliver;                         // lowest undelivered height
+    std::string lastCommittedId;
+    std::vector<ConsensusMessage> outbox;
+    std::vector<std::pair<int, ConsensusMessage>> directOutbox;
+    std::map<uint64_t, ConsensusMessage> certificates;   // recent decided heights
+    std::map<int, std::pair<uint64_t, std::chrono::steady_clock::time_point>> certificateSent;
+    std::vector<ConsensusMessage> decidedQueue;          // COMMITs not yet handed out
+
+    std::vector<int> localView() const;
+    bool agrees(const CommitEntry& change) const;
+    bool changePending(uint64_t height) const;
+    void refreshValidators();
+    void proposeMembership();
+    size_t quorum(const HeightState& hs) const;
+    size_t faultTolerance(const HeightState& hs) const;
+    int proposer(const HeightState& hs, uint64_t height, int round) const;
+    bool isValidator(const HeightState& hs, int id) const;
+
+    size_t count(const HeightState& hs, const std::map<int, std::string>& votes,
+                 const std::string& valueId) const;
+    // Validators among the senders, whatever they voted for
+    size_t voters(const HeightState& hs, const std::map<int, std::string>& votes) const;
+    bool certified(const ConsensusMessage& msg) const;
+    static bool quorumSigned(const std::vector<int>& validators,
+                             const std::vector<VoteSignature>& certificate);
+    bool orphaned(uint64_t height, const Proposal& proposal) const;
+    const Proposal* proposalFor(const HeightState& hs, uint64_t height, int round) const;
+
+    void startHeight(uint64_t height);
+    void startRound(uint64_t height, int round);
+    void enterStep(HeightState& hs, ConsensusStep step);
+    void maybeStartNextHeight();
+    void armProposeTimeout(uint64_t height, HeightState& hs, RoundVotes& rv, bool haveWork);
+    void onNewWork();
+    void onMembershipChanged();
+    bool expectedParent(uint64_t height, std::string& parent) const;
+    std::set<std::string> inflightKeys(uint64_t height) const;
+    bool validValueFor(uint64_t height, const Proposal& proposal) const;
+    bool wellFormed(const HeightState& hs, const Proposal& proposal) const;
+    std::vector<CommitEntry> collectBatch(uint64_t height) const;
+    void tryPropose(uint64_t height);
+
+    void send(ConsensusMessage msg);
+    void record(const ConsensusMessage& msg);
+    void recordCertificate(const ConsensusMessage& msg);
+    void sendCertificate(int peer, uint64_t height);
+    void storeCertificate(uint64_t height, const HeightState& hs, const Proposal& value);
+    void evaluateAll();
+    bool advance(uint64_t height);
+    void decide(uint64_t height, const Proposal& value);
+    void deliverDecided();
+    void flush();
+
+    void onTimeoutPropose(uint64_t height, int round);
+    void onTimeoutRebroadcast(uint64_t height, int round);
+    void onTimeoutPrevote(uint64_t height, int round);
+    void onTimeoutPrecommit(uint64_t height, int round);
+    void scheduleTimeout(std::chrono::milliseconds base, int round,
+                         void (Consensus::*fn)(uint64_t, int), uint64_t height);
+};
@@ -0,0 +1,350 @@
+// src/network/FailureDetector.cpp
+#include "FailureDetector.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+FailureDetector::FailureDetector(int id,
+                                 MembershipFn membershipFn,
+                                 SendFn sendFn,
+                                 ScheduleFn scheduleFn,
+                                 FailureDetectorConfig cfg)
+    : nodeId(id),
+      membership(std::move(membershipFn)),
+      send(std::move(sendFn)),
+      schedule(std::move(scheduleFn)),
+      config(cfg),
+      ownIncarnation(0),
+      probeIndex(0),
+      rng(std::random_device()()),
+      nextSeq(1),
+      nextSuspicion(1),
+      period(0),
+      probeSeq(0),
+      probeTarget(-1),
+      probeAcked(true) {}
+
+void FailureDetector::start() {
+    schedule(config.protocolPeriod, [this] { tick(); });
+}
+
+void FailureDetector::addMember(int node) {
+    if (node == nodeId) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = members.find(node);
+    if (it == members.end()) {
+        members[node] = Member();
+        // New members join the round robin at a random position
+        std::uniform_int_distribution<size_t> pos(probeIndex, probeOrder.size());
+        probeOrder.insert(probeOrder.begin() + pos(rng), node);
+    } else if (it->second.state != MemberState::ALIVE) {
+        it->second.state = MemberState::ALIVE;
+        it->second.suspicion = 0;
+    }
+}
+
+void FailureDetector::tick() {
+    Outgoing out;
+    uint32_t seq = 0;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        period++;
+        for (auto it = relays.begin(); it != relays.end();) {
+            it = it->second.period + 2 < period ? relays.erase(it) : std::next(it);
+        }
+        int target = nextTarget();
+        if (target >= 0) {
+            seq = nextSeq++;
+            probeSeq = seq;
+            probeTarget = target;
+            probeAcked = false;
+            queue(out, target, ProbeType::PING, seq, target);
+            METRIC_COUNT(PROBES_SENT);
+        }
+    }
+    if (seq == 0) {
+        schedule(config.protocolPeriod, [this] { tick(); });
+        return;
+    }
+    dispatch(out, std::vector<int>(), std::vector<int>());
+    schedule(config.probeTimeout, [this, seq] { probeTimedOut(seq); });
+    schedule(config.protocolPeriod, [this, seq] { periodEnded(seq); });
+}
+
+void FailureDetector::probeTimedOut(uint32_t seq) {
+    Outgoing out;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (seq != probeSeq || probeAcked) {
+            return;
+        }
+        for (int helper : randomMembers(config.indirectProbes, probeTarget)) {
+            queue(out, helper, ProbeType::PING_REQ, seq, probeTarget);
+            METRIC_COUNT(PROBES_INDIRECT);
+        }
+    }
+    dispatch(out, std::vector<int>(), std::vector<int>());
+}
+
+void FailureDetector::periodEnded(uint32_t seq) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (seq == probeSeq && !probeAcked) {
+            auto it = members.find(probeTarget);
+            if (it != members.end() && it->second.state == MemberState::ALIVE) {
+                suspect(probeTarget, it->second);
+            }
+        }
+    }
+    tick();
+}
+
+void FailureDetector::suspicionExpired(int node, uint64_t suspicion) {
+    std::vector<int> removed;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = members.find(node);
+        if (it == members.end() || it->second.state != MemberState::SUSPECT ||
+            it->second.suspicion != suspicion) {
+            return;
+        }
+        it->second.state = MemberState::DEAD;
+        gossip(MemberUpdate{node, MemberState::DEAD, it->second.incarnation});
+        removed.push_back(node);
+    }
+    Outgoing none;
+    dispatch(none, removed, std::vector<int>());
+}
+
+void FailureDetector::onProbe(int from, const Probe& probe) {
+    Outgoing out;
+    std::vector<int> removed;
+    std::vector<int> revived;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const auto& update : probe.updates) {
+            apply(update, removed, revived);
+        }
+        switch (probe.type) {
+            case ProbeType::PING:
+                queue(out, from, ProbeType::ACK, probe.seq, nodeId);
+                break;
+
+            case ProbeType::ACK: {
+                if (probe.seq == probeSeq && probe.target == probeTarget) {
+                    probeAcked = true;
+                    break;
+                }
+                auto it = relays.find(probe.seq);
+                if (it != relays.end()) {
+                    queue(out, it->second.origin, ProbeType::ACK, it->second.originSeq, probe.target);
+                    relays.erase(it);
+                }
+                break;
+            }
+
+            case ProbeType::PING_REQ: {
+                uint32_t seq = nextSeq++;
+                relays[seq] = Relay{from, probe.seq, period};
+                queue(out, probe.target, ProbeType::PING, seq, probe.target);
+                break;
+            }
+        }
+    }
+    dispatch(out, removed, revived);
+}
+
+void FailureDetector::onUpdates(const std::vector<MemberUpdate>& updates) {
+    std::vector<int> removed;
+    std::vector<int> revived;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const auto& update : updates) {
+            apply(update, removed, revived);
+        }
+    }
+    Outgoing none;
+    dispatch(none, removed, revived);
+}
+
+std::vector<MemberUpdate> FailureDetector::takeUpdates() {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<MemberUpdate> out;
+    if (pendingGossip.empty()) {
+        return out;
+    }
+    size_t take = std::min(config.maxPiggyback, pendingGossip.size());
+    std::partial_sort(pendingGossip.begin(), pendingGossip.begin() + take, pendingGossip.end(),
+                      [](const Gossip& a, const Gossip& b) { return a.sent < b.sent; });
+    size_t limit = retransmitLimit();
+    for (size_t i = 0; i < take; i++) {
+        out.push_back(pendingGossip[i].update);
+        pendingGossip[i].sent++;
+    }
+    pendingGossip.erase(std::remove_if(pendingGossip.begin(), pendingGossip.end(),
+                                       [limit](const Gossip& g) { return g.sent >= limit; }),
+                        pendingGossip.end());
+    return out;
+}
+
+MemberState FailureDetector::state(int node) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = members.find(node);
+    return it == members.end() ? MemberState::DEAD : it->second.state;
+}
+
+uint32_t FailureDetector::incarnation() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return ownIncarnation;
+}
+
+// Caller holds mtx. Walks a shuffled copy of the live members and reshuffles
+// once it has been through all of them.
+int FailureDetector::nextTarget() {
+    for (int pass = 0; pass < 2; pass++) {
+        while (probeIndex < probeOrder.size()) {
+            int node = probeOrder[probeIndex++];
+            auto it = members.find(node);
+            if (it != members.end() && it->second.state != MemberState::DEAD) {
+                return node;
+            }
+        }
+        probeOrder.clear();
+        for (const auto& entry : members) {
+            if (entry.second.state != MemberState::DEAD) {
+                probeOrder.push_back(entry.first);
+            }
+        }
+        std::shuffle(probeOrder.begin(), probeOrder.end(), rng);
+        probeIndex = 0;
+    }
+    return -1;
+}
+
+// Caller holds mtx
+std::vector<int> FailureDetector::randomMembers(size_t count, int exclude) {
+    std::vector<int> candidates;
+    for (const auto& entry : members) {
+        if (entry.first != exclude && entry.second.state == MemberState::ALIVE) {
+            candidates.push_back(entry.first);
+        }
+    }
+    std::shuffle(candidates.begin(), candidates.end(), rng);
+    if (candidates.size() > count) {
+        candidates.resize(count);
+    }
+    return candidates;
+}
+
+// Caller holds mtx. SWIM's precedence: ALIVE needs a higher incarnation to
+// override anything, SUSPECT overrides ALIVE at the same one, DEAD overrides
+// both. A DEAD member comes back only through a newer ALIVE or a fresh
+// handshake.
+void FailureDetector::apply(const MemberUpdate& update, std::vector<int>& removed,
+                            std::vector<int>& revived) {
+    if (update.node == nodeId) {
+        if (update.state != MemberState::ALIVE && update.incarnation >= ownIncarnation) {
+            // Refute: we are evidently still here
+            ownIncarnation = update.incarnation + 1;
+            gossip(MemberUpdate{nodeId, MemberState::ALIVE, ownIncarnation});
+        }
+        return;
+    }
+    auto it = members.find(update.node);
+    if (it == members.end()) {
+        // Members come from handshakes; gossip about others is not ours to act on
+        return;
+    }
+    Member& m = it->second;
+    switch (update.state) {
+        case MemberState::ALIVE:
+            if (update.incarnation > m.incarnation) {
+                if (m.state == MemberState::DEAD) {
+                    revived.push_back(update.node);
+                }
+                m.state = MemberState::ALIVE;
+                m.incarnation = update.incarnation;
+                m.suspicion = 0;
+                gossip(update);
+            }
+            break;
+
+        case MemberState::SUSPECT:
+            if ((m.state == MemberState::ALIVE && update.incarnation >= m.incarnation) ||
+                (m.state == MemberState::SUSPECT && update.incarnation > m.incarnation)) {
+                m.incarnation = update.incarnation;
+                suspect(update.node, m);
+            }
+            break;
+
+        case MemberState::DEAD:
+            if (m.state != MemberState::DEAD && update.incarnation >= m.incarnation) {
+                m.state = MemberState::DEAD;
+                m.incarnation = update.incarnation;
+                gossip(update);
+                removed.push_back(update.node);
+            }
+            break;
+    }
+}
+
+// Caller holds mtx
+void FailureDetector::suspect(int node, Member& m) {
+    METRIC_COUNT(MEMBERS_SUSPECTED);
+    m.state = MemberState::SUSPECT;
+    m.suspicion = nextSuspicion++;
+    gossip(MemberUpdate{node, MemberState::SUSPECT, m.incarnation});
+    uint64_t suspicion = m.suspicion;
+    schedule(suspicionTimeout(), [this, node, suspicion] { suspicionExpired(node, suspicion); });
+}
+
+// Caller holds mtx. A newer update about a node replaces the queued one.
+void FailureDetector::gossip(const MemberUpdate& update) {
+    for (auto& g : pendingGossip) {
+        if (g.update.node == update.node) {
+            g.update = update;
+            g.sent = 0;
+            return;
+        }
+    }
+    pendingGossip.push_back(Gossip{update, 0});
+}
+
+size_t FailureDetector::retransmitLimit() const {
+    double n = static_cast<double>(members.size() + 1);
+    return config.retransmitMultiplier * static_cast<size_t>(std::ceil(std::log2(n + 1)));
+}
+
+std::chrono::milliseconds FailureDetector::suspicionTimeout() const {
+    double n = static_cast<double>(members.size() + 1);
+    size_t scale = std::max<size_t>(1, static_cast<size_t>(std::ceil(std::log2(n + 1))));
+    return config.protocolPeriod * static_cast<long>(config.suspicionMultiplier * scale);
+}
+
+void FailureDetector::queue(Outgoing& out, int peer, ProbeType type, uint32_t seq, int target) {
+    Probe probe;
+    probe.type = type;
+    probe.seq = seq;
+    probe.target = target;
+    out.emplace_back(peer, std::move(probe));
+}
+
+// Runs without mtx: sends and membership listeners may call back in
+void FailureDetector::dispatch(Outgoing& out, const std::vector<int>& removed,
+                               const std::vector<int>& revived) {
+    for (auto& entry : out) {
+        entry.second.updates = takeUpdates();
+        send(entry.first, entry.second);
+    }
+    for (int node : removed) {
+        METRIC_COUNT(MEMBERS_FAILED);
+        std::cout << "Peer " << node << " failed, removing it from its tables" << std::endl;
+        membership(node, false);
+    }
+    for (int node : revived) {
+        membership(node, true);
+    }
+}
@@ -0,0 +1,156 @@
+// src/network/FailureDetector.h
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <vector>
+
+enum class MemberState : uint8_t {
+    ALIVE = 0,
+    SUSPECT = 1,
+    DEAD = 2
+};
+
+// One piece of membership gossip: `node` is in `state` as of `incarnation`
+struct MemberUpdate {
+    int32_t node;
+    MemberState state;
+    uint32_t incarnation;
+};
+
+enum class ProbeType : uint8_t {
+    PING,
+    ACK,
+    PING_REQ    // ask the receiver to ping `target` for us
+};
+
+struct Probe {
+    ProbeType type;
+    uint32_t seq;
+    int32_t target;                       // node whose liveness is in question
+    std::vector<MemberUpdate> updates;    // piggybacked gossip
+};
+
+struct FailureDetectorConfig {
+    std::chrono::milliseconds protocolPeriod{500};
+    std::chrono::milliseconds probeTimeout{150};   // direct ack wait before ping-req
+    size_t indirectProbes = 3;                      // members asked to ping-req
+    size_t suspicionMultiplier = 3;                 // periods per log2(n + 1) before DEAD
+    size_t retransmitMultiplier = 3;                // sends per log2(n + 1) for each update
+    size_t maxPiggyback = 8;                        // updates per outgoing message
+};
+
+// SWIM failure detector (Das, Gupta, Motivala 2002) for the peers at the
+// table.
+//
+// Every protocol period one member is pinged, in a freshly shuffled round
+// robin so each is probed within n periods. Without an ack inside
+// probeTimeout, indirectProbes other members are asked to ping it; without
+// any ack by the end of the period it becomes SUSPECT, and a suspect that
+// does not refute within the suspicion timeout is declared DEAD. The
+// MembershipFn hears of every DEAD member (and of one that comes back) so
+// the caller can stop routing to it. That is this node's view only: any
+// peer may gossip DEAD, so a table's validators change only once consensus
+// decides the change (see ValidatorSchedule).
+//
+// State changes spread by piggybacking on outgoing messages: each update
+// rides on a bounded number of them, so per-node load stays constant as the
+// table grows. A node that hears it is suspected raises its incarnation and
+// gossips ALIVE, which overrides any suspicion at a lower incarnation.
+//
+// The transport is the caller's: sends go through SendFn, timers through
+// ScheduleFn, and takeUpdates() hands out gossip for any other message the
+// caller is about to send.
+class FailureDetector {
+public:
+    using SendFn = std::function<void(int peer, const Probe&)>;
+    using ScheduleFn = std::function<void(std::chrono::milliseconds, std::function<void()>)>;
+    using MembershipFn = std::function<void(int node, bool alive)>;
+
+    FailureDetector(int nodeId,
+                    MembershipFn membership,
+                    SendFn send,
+                    ScheduleFn schedule,
+                    FailureDetectorConfig config = FailureDetectorConfig());
+
+    FailureDetector(const FailureDetector&) = delete;
+    FailureDetector& operator=(const FailureDetector&) = delete;
+
+    void start();
+
+    // A peer completed the handshake; it is ALIVE again even if it was
+    // declared DEAD before.
+    void addMember(int node);
+    void onProbe(int from, const Probe& probe);
+    void onUpdates(const std::vector<MemberUpdate>& updates);
+
+    // Up to maxPiggyback pending updates, least-sent first, for a message
+    // about to go out
+    std::vector<MemberUpdate> takeUpdates();
+
+    MemberState state(int node) const;
+    uint32_t incarnation() const;
+
+private:
+    struct Member {
+        MemberState state = MemberState::ALIVE;
+        uint32_t incarnation = 0;
+        uint64_t suspicion = 0;   // id of the pending suspicion timeout
+    };
+
+    struct Gossip {
+        MemberUpdate update;
+        size_t sent = 0;
+    };
+
+    // A ping we send on behalf of another member's PING_REQ
+    struct Relay {
+        int origin;
+        uint32_t originSeq;
+        uint64_t period;
+    };
+
+    using Outgoing = std::vector<std::pair<int, Probe>>;
+
+    void tick();
+    void probeTimedOut(uint32_t seq);
+    void periodEnded(uint32_t seq);
+    void suspicionExpired(int node, uint64_t suspicion);
+
+    int nextTarget();
+    std::vector<int> randomMembers(size_t count, int exclude);
+    void apply(const MemberUpdate& update, std::vector<int>& removed, std::vector<int>& revived);
+    void suspect(int node, Member& m);
+    void gossip(const MemberUpdate& update);
+    size_t retransmitLimit() const;
+    std::chrono::milliseconds suspicionTimeout() const;
+    void queue(Outgoing& out, int peer, ProbeType type, uint32_t seq, int target);
+    void dispatch(Outgoing& out, const std::vector<int>& removed, const std::vector<int>& revived);
+
+    int nodeId;
+    MembershipFn membership;
+    SendFn send;
+    ScheduleFn schedule;
+    FailureDetectorConfig config;
+
+    mutable std::mutex mtx;
+    uint32_t ownIncarnation;
+    std::map<int, Member> members;
+    std::vector<Gossip> pendingGossip;
+    std::vector<int> probeOrder;
+    size_t probeIndex;
+    std::mt19937 rng;
+    uint32_t nextSeq;
+    uint64_t nextSuspicion;
+
+    // Probe of the current period
+    uint64_t period;
+    uint32_t probeSeq;
+    int probeTarget;
+    bool probeAcked;
+    std::map<uint32_t, Relay> relays;
+};
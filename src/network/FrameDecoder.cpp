@@ -0,0 +1,68 @@
+// src/network/FrameDecoder.cpp
+#include "FrameDecoder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+} // namespace
+
+FrameDecoder::FrameDecoder(size_t capacity, uint32_t maxFrameSize)
+    : ring(roundUpPow2(std::max<size_t>(capacity, 64))),
+      mask(ring.size() - 1),
+      head(0),
+      tail(0),
+      state(State::LENGTH),
+      bodyLength(0),
+      maxFrame(maxFrameSize) {}
+
+std::array<FrameDecoder::Region, 2> FrameDecoder::writable() {
+    std::array<Region, 2> regions{{{nullptr, 0}, {nullptr, 0}}};
+    size_t free = ring.size() - buffered();
+    if (free == 0) {
+        return regions;
+    }
+    size_t start = tail & mask;
+    size_t first = std::min(free, ring.size() - start);
+    regions[0] = {ring.data() + start, first};
+    if (free > first) {
+        regions[1] = {ring.data(), free - first};
+    }
+    return regions;
+}
+
+void FrameDecoder::commit(size_t bytes) {
+    tail += bytes;
+}
+
+void FrameDecoder::copyOut(size_t offset, char* dst, size_t len) const {
+    size_t start = (head + offset) & mask;
+    size_t first = std::min(len, ring.size() - start);
+    std::memcpy(dst, ring.data() + start, first);
+    if (len > first) {
+        std::memcpy(dst + first, ring.data(), len - first);
+    }
+}
+
+// Grows the ring when a single frame would not fit; the ring never shrinks,
+// so a connection pays for this at most a few times.
+void FrameDecoder::reserve(size_t bytes) {
+    if (bytes <= ring.size()) {
+        return;
+    }
+    std::vector<char> bigger(roundUpPow2(bytes));
+    size_t used = buffered();
+    copyOut(0, bigger.data(), used);
+    ring.swap(bigger);
+    mask = ring.size() - 1;
+    head = 0;
+    tail = used;
+}
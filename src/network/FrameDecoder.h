@@ -0,0 +1,101 @@
+// src/network/FrameDecoder.h
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Per-connection receive buffer that splits a byte stream into
+// length-prefixed frames (4-byte big-endian length, then the body).
+//
+// Reads land directly in a power-of-two ring. drain() hands every complete
+// frame to a callback as a pointer into the ring; a frame that wraps the end
+// is copied once into a reusable scratch buffer. Partial frames stay
+// buffered until the next read completes them, so nothing ever blocks.
+class FrameDecoder {
+public:
+    static const size_t DEFAULT_CAPACITY = 16 * 1024;
+    static const uint32_t DEFAULT_MAX_FRAME = 4 * 1024 * 1024;
+
+    struct Region {
+        char* data;
+        size_t size;
+    };
+
+    explicit FrameDecoder(size_t capacity = DEFAULT_CAPACITY,
+                          uint32_t maxFrame = DEFAULT_MAX_FRAME);
+
+    // Free space to read into, as up to two regions (the second one is
+    // non-empty when the free space wraps around).
+    std::array<Region, 2> writable();
+    void commit(size_t bytes);
+
+    // Calls fn(const char* data, size_t len) for each complete frame.
+    // Returns false if the peer announced a frame larger than maxFrame;
+    // the connection should then be dropped.
+    template <typename Fn>
+    bool drain(Fn&& fn);
+
+    size_t buffered() const { return tail - head; }
+    size_t capacity() const { return ring.size(); }
+
+private:
+    enum class State {
+        LENGTH,
+        BODY
+    };
+
+    void copyOut(size_t offset, char* dst, size_t len) const;
+    void reserve(size_t bytes);
+
+    std::vector<char> ring;
+    std::vector<char> scratch;
+    size_t mask;
+    uint64_t head;   // absolute offsets; index = offset & mask
+    uint64_t tail;
+    State state;
+    uint32_t bodyLength;
+    uint32_t maxFrame;
+};
+
+template <typename Fn>
+bool FrameDecoder::drain(Fn&& fn) {
+    while (true) {
+        if (state == State::LENGTH) {
+            if (buffered() < 4) {
+                break;
+            }
+            unsigned char prefix[4];
+            copyOut(0, reinterpret_cast<char*>(prefix), 4);
+            bodyLength = (static_cast<uint32_t>(prefix[0]) << 24) |
+                         (static_cast<uint32_t>(prefix[1]) << 16) |
+                         (static_cast<uint32_t>(prefix[2]) << 8) |
+                         static_cast<uint32_t>(prefix[3]);
+            if (bodyLength > maxFrame) {
+                return false;
+            }
+            head += 4;
+            state = State::BODY;
+            reserve(bodyLength);
+        }
+
+        if (buffered() < bodyLength) {
+            break;
+        }
+        size_t start = head & mask;
+        if (start + bodyLength <= ring.size()) {
+            fn(static_cast<const char*>(ring.data() + start), static_cast<size_t>(bodyLength));
+        } else {
+            scratch.resize(bodyLength);
+            copyOut(0, scratch.data(), bodyLength);
+            fn(static_cast<const char*>(scratch.data()), static_cast<size_t>(bodyLength));
+        }
+        head += bodyLength;
+        state = State::LENGTH;
+    }
+    if (head == tail) {
+        head = tail = 0;   // keep the next frame contiguous when idle
+    }
+    return true;
+}
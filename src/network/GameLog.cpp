@@ -0,0 +1,651 @@
+// src/network/GameLog.cpp
+#include "GameLog.h"
+#include "Metrics.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+const uint32_t SEGMENT_MAGIC = 0x4D50474C;    // "MPGL"
+const uint32_t SNAPSHOT_MAGIC = 0x4D50534E;   // "MPSN"
+const uint32_t FORMAT_VERSION = 1;
+const size_t SEGMENT_HEADER = 16;
+const size_t RECORD_HEADER = 8;
+
+// CRC-32C (Castagnoli), table driven
+struct Crc32cTable {
+    uint32_t entries[256];
+    Crc32cTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+uint32_t crc32c(const char* data, size_t len) {
+    static const Crc32cTable table;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) {
+        crc = table.entries[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void putU32(char* p, uint32_t v) {
+    for (int i = 3; i >= 0; i--) {
+        p[i] = static_cast<char>(v & 0xFF);
+        v >>= 8;
+    }
+}
+
+void putU64(char* p, uint64_t v) {
+    for (int i = 7; i >= 0; i--) {
+        p[i] = static_cast<char>(v & 0xFF);
+        v >>= 8;
+    }
+}
+
+uint32_t getU32(const char* p) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        v = (v << 8) | static_cast<uint8_t>(p[i]);
+    }
+    return v;
+}
+
+uint64_t getU64(const char* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        v = (v << 8) | static_cast<uint8_t>(p[i]);
+    }
+    return v;
+}
+
+std::string fileName(const char* prefix, uint64_t height, const char* suffix) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%s%020llu%s", prefix,
+                  static_cast<unsigned long long>(height), suffix);
+    return buf;
+}
+
+[[noreturn]] void fail(const std::string& what) {
+    throw std::runtime_error("game log: " + what + ": " + std::strerror(errno));
+}
+
+size_t pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+void syncRange(char* base, size_t from, size_t to) {
+    if (to <= from) {
+        return;
+    }
+    size_t start = from - from % pageSize();
+    msync(base + start, to - start, MS_SYNC);
+}
+
+} // namespace
+
+struct GameLog::Segment {
+    std::string path;
+    int fd = -1;
+    char* base = nullptr;
+    size_t size = 0;
+    size_t used = 0;
+
+    ~Segment() {
+        if (base) {
+            munmap(base, size);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+GameLog::GameLog(std::string directory, size_t segSize)
+    : dir(std::move(directory)),
+      segmentSize(std::max(segSize, pageSize())),
+      activeSynced(0),
+      nextHeight(0),
+      lastValueId(Consensus::GENESIS_ID),
+      appendSeq(0),
+      durableSeq(0),
+      opened(false),
+      stopping(false),
+      compactPending(false),
+      snapshotFloor(0) {}
+
+GameLog::~GameLog() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    appended.notify_all();
+    synced.notify_all();
+    compactQueued.notify_all();
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+    if (compactor.joinable()) {
+        compactor.join();
+    }
+}
+
+std::vector<std::pair<uint64_t, std::string>> GameLog::listFiles(const char* prefix,
+                                                                const char* suffix) const {
+    std::vector<std::pair<uint64_t, std::string>> files;
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        return files;
+    }
+    size_t prefixLen = std::strlen(prefix);
+    size_t suffixLen = std::strlen(suffix);
+    while (struct dirent* ent = readdir(d)) {
+        std::string name = ent->d_name;
+        if (name.size() != prefixLen + 20 + suffixLen || name.compare(0, prefixLen, prefix) != 0 ||
+            name.compare(name.size() - suffixLen, suffixLen, suffix) != 0) {
+            continue;
+        }
+        uint64_t height = std::strtoull(name.c_str() + prefixLen, nullptr, 10);
+        files.emplace_back(height, dir + "/" + name);
+    }
+    closedir(d);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+void GameLog::syncDirectory() const {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+bool GameLog::readSnapshot(const std::string& path, Snapshot& out) const {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    std::string data;
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        data.append(buf, static_cast<size_t>(n));
+    }
+    close(fd);
+
+    if (data.size() < 8 + 8 + 2 + 4 || getU32(data.data()) != SNAPSHOT_MAGIC ||
+        getU32(data.data() + 4) != crc32c(data.data() + 8, data.size() - 8)) {
+        return false;
+    }
+    const char* p = data.data() + 8;
+    out.height = getU64(p);
+    size_t idLen = (static_cast<uint8_t>(p[8]) << 8) | static_cast<uint8_t>(p[9]);
+    p += 10;
+    if (static_cast<size_t>(data.data() + data.size() - p) < idLen + 4) {
+        return false;
+    }
+    out.lastValueId.assign(p, idLen);
+    p += idLen;
+    size_t stateLen = getU32(p);
+    p += 4;
+    if (static_cast<size_t>(data.data() + data.size() - p) != stateLen) {
+        return false;
+    }
+    out.state.assign(p, stateLen);
+    return true;
+}
+
+GameLog::Recovery GameLog::open(const SnapshotFn& restore, const ReplayFn& replay) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (opened) {
+        throw std::logic_error("game log already open");
+    }
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        fail("cannot create " + dir);
+    }
+
+    Recovery rec;
+    rec.lastValueId = Consensus::GENESIS_ID;
+    auto snapshots = listFiles("snapshot-", ".snap");
+    for (auto it = snapshots.rbegin(); it != snapshots.rend(); ++it) {
+        if (readSnapshot(it->second, rec.snapshot)) {
+            rec.hasSnapshot = true;
+            rec.nextHeight = rec.snapshot.height + 1;
+            rec.lastValueId = rec.snapshot.lastValueId;
+            idsSinceSnapshot[rec.snapshot.height] = rec.lastValueId;
+            snapshotFloor = rec.snapshot.height;
+            if (restore) {
+                restore(rec.snapshot);
+            }
+            break;
+        }
+    }
+
+    // Walk every segment through a read-only mapping. The first record that
+    // is missing, torn or out of sequence ends the log.
+    segments = listFiles("segment-", ".log");
+    size_t tail = 0;
+    size_t tailOffset = SEGMENT_HEADER;
+    bool tailHeader = false;
+    bool ended = false;
+    for (size_t i = 0; i < segments.size() && !ended; i++) {
+        int fd = ::open(segments[i].second.c_str(), O_RDONLY);
+        if (fd < 0) {
+            fail("cannot open " + segments[i].second);
+        }
+        struct stat st;
+        fstat(fd, &st);
+        size_t size = static_cast<size_t>(st.st_size);
+        void* map = size >= SEGMENT_HEADER ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)
+                                           : MAP_FAILED;
+        close(fd);
+        tail = i;
+        tailOffset = SEGMENT_HEADER;
+        tailHeader = false;
+        if (map == MAP_FAILED) {
+            rec.tornTail = true;
+            ended = true;
+            break;
+        }
+        const char* base = static_cast<const char*>(map);
+        if (getU32(base) != SEGMENT_MAGIC || getU32(base + 4) != FORMAT_VERSION ||
+            getU64(base + 8) != segments[i].first) {
+            munmap(map, size);
+            rec.tornTail = true;
+            ended = true;
+            break;
+        }
+        tailHeader = true;
+
+        size_t pos = SEGMENT_HEADER;
+        while (pos + RECORD_HEADER <= size) {
+            uint32_t len = getU32(base + pos);
+            if (len == 0) {
+                break;
+            }
+            wire::FrameView frame;
+            const char* body = base + pos + RECORD_HEADER;
+            if (len > size - pos - RECORD_HEADER || getU32(base + pos + 4) != crc32c(body, len) ||
+                !wire::decode(body, len, frame) ||
+                (frame.type != wire::MessageType::PROPOSAL &&
+                 frame.type != wire::MessageType::COMMIT) ||
+                frame.height > rec.nextHeight) {
+                rec.tornTail = true;
+                ended = true;
+                break;
+            }
+            if (frame.height == rec.nextHeight) {
+                replay(frame.height, frame);
+                rec.nextHeight++;
+                rec.lastValueId.assign(frame.valueId.data(), frame.valueId.size());
+                idsSinceSnapshot[frame.height] = rec.lastValueId;
+                rec.records++;
+            }
+            pos += RECORD_HEADER + len;
+        }
+        tailOffset = pos;
+        munmap(map, size);
+        // A segment that stops short (rolled early) is followed by the next
+        // one; only a bad record ends the walk
+    }
+
+    // Anything after a torn record is unreachable
+    for (size_t i = tail + 1; i < segments.size(); i++) {
+        unlink(segments[i].second.c_str());
+    }
+    if (!segments.empty()) {
+        segments.resize(tail + 1);
+    }
+
+    nextHeight = rec.nextHeight;
+    lastValueId = rec.lastValueId;
+
+    // A tail whose header never made it to disk (empty, short or garbled)
+    // cannot be mapped for appending; neither can an empty one that starts
+    // past the recovered height. Start either over.
+    if (segments.empty() || !tailHeader ||
+        (tailOffset == SEGMENT_HEADER && segments[tail].first != nextHeight)) {
+        if (!segments.empty()) {
+            unlink(segments[tail].second.c_str());
+            segments.pop_back();
+        }
+        openSegment(nextHeight);
+    } else {
+        auto seg = std::make_shared<Segment>();
+        seg->path = segments[tail].second;
+        seg->fd = ::open(seg->path.c_str(), O_RDWR);
+        if (seg->fd < 0) {
+            fail("cannot reopen " + seg->path);
+        }
+        struct stat st;
+        fstat(seg->fd, &st);
+        seg->size = static_cast<size_t>(st.st_size);
+        void* map = mmap(nullptr, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+        if (map == MAP_FAILED) {
+            fail("cannot map " + seg->path);
+        }
+        seg->base = static_cast<char*>(map);
+        seg->used = tailOffset;
+        if (rec.tornTail) {
+            // Clear the torn bytes so they can never pass for a record later
+            std::memset(seg->base + seg->used, 0, seg->size - seg->used);
+            syncRange(seg->base, seg->used, seg->size);
+        }
+        active = seg;
+        activeSynced = seg->used;
+    }
+
+    opened = true;
+    flusher = std::thread(&GameLog::flusherLoop, this);
+    compactor = std::thread(&GameLog::compactorLoop, this);
+    return rec;
+}
+
+// Caller holds mtx
+void GameLog::openSegment(uint64_t baseHeight) {
+    openSegmentSized(baseHeight, segmentSize);
+}
+
+void GameLog::openSegmentSized(uint64_t baseHeight, size_t size) {
+    auto seg = std::make_shared<Segment>();
+    seg->path = dir + "/" + fileName("segment-", baseHeight, ".log");
+    seg->fd = ::open(seg->path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (seg->fd < 0) {
+        fail("cannot create " + seg->path);
+    }
+    size = (size + pageSize() - 1) / pageSize() * pageSize();
+    if (ftruncate(seg->fd, static_cast<off_t>(size)) != 0) {
+        fail("cannot size " + seg->path);
+    }
+    void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+    if (map == MAP_FAILED) {
+        fail("cannot map " + seg->path);
+    }
+    seg->base = static_cast<char*>(map);
+    seg->size = size;
+    putU32(seg->base, SEGMENT_MAGIC);
+    putU32(seg->base + 4, FORMAT_VERSION);
+    putU64(seg->base + 8, baseHeight);
+    seg->used = SEGMENT_HEADER;
+    syncRange(seg->base, 0, SEGMENT_HEADER);
+    fsync(seg->fd);
+    syncDirectory();
+
+    if (active) {
+        sealed.push_back(active);
+    }
+    active = seg;
+    activeSynced = seg->used;
+    segments.emplace_back(baseHeight, seg->path);
+}
+
+uint64_t GameLog::append(uint64_t height, const std::vector<CommitEntry>& entries) {
+    ConsensusMessage decided;
+    decided.height = height;
+    decided.entries = entries;
+    return append(decided);
+}
+
+uint64_t GameLog::append(const ConsensusMessage& decided) {
+    uint64_t height = decided.height;
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!opened) {
+        throw std::logic_error("game log not open");
+    }
+    if (height < nextHeight) {
+        return appendSeq;   // already logged, e.g. replayed at startup
+    }
+    if (height > nextHeight) {
+        throw std::logic_error("game log: height " + std::to_string(height) +
+                               " appended before " + std::to_string(nextHeight));
+    }
+
+    ConsensusMessage msg;
+    msg.type = decided.certificate.empty() ? ConsensusMessageType::PROPOSAL
+                                           : ConsensusMessageType::COMMIT;
+    msg.height = height;
+    msg.round = decided.round;
+    msg.validRound = decided.validRound;
+    msg.parentId = lastValueId;
+    msg.valueId = Consensus::computeValueId(lastValueId, decided.entries);
+    msg.entries = decided.entries;
+    msg.certificate = decided.certificate;
+    scratch.clear();
+    wire::encodeConsensus(scratch, msg);
+
+    size_t recordSize = RECORD_HEADER + scratch.size();
+    if (active->used + recordSize > active->size) {
+        openSegmentSized(height, std::max(segmentSize, SEGMENT_HEADER + recordSize));
+    }
+
+    // Body and checksum before the length, so a torn write never looks valid
+    char* p = active->base + active->used;
+    std::memcpy(p + RECORD_HEADER, scratch.data(), scratch.size());
+    putU32(p + 4, crc32c(scratch.data(), scratch.size()));
+    putU32(p, static_cast<uint32_t>(scratch.size()));
+    active->used += recordSize;
+
+    idsSinceSnapshot[height] = msg.valueId;
+    lastValueId = msg.valueId;
+    nextHeight++;
+    counters.appends++;
+    counters.bytes += recordSize;
+    uint64_t seq = ++appendSeq;
+    lock.unlock();
+    appended.notify_one();
+    return seq;
+}
+
+void GameLog::waitDurable(uint64_t seq) {
+    std::unique_lock<std::mutex> lock(mtx);
+    synced.wait(lock, [this, seq]() { return durableSeq >= seq || stopping; });
+}
+
+// Group commit: every pass syncs all records appended since the previous
+// one, so a burst of decisions costs one msync.
+void GameLog::flusherLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        appended.wait(lock, [this]() { return stopping || appendSeq > durableSeq; });
+        if (appendSeq == durableSeq) {
+            return;   // stopping with nothing left to sync
+        }
+        uint64_t target = appendSeq;
+        uint64_t batch = appendSeq - durableSeq;
+        std::vector<std::shared_ptr<Segment>> rolled;
+        rolled.swap(sealed);
+        std::shared_ptr<Segment> seg = active;
+        size_t from = activeSynced;
+        size_t to = seg->used;
+        lock.unlock();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (const auto& old : rolled) {
+            syncRange(old->base, 0, old->used);
+        }
+        syncRange(seg->base, from, to);
+        METRIC_SINCE(metrics::LOG_SYNC_NS, start);
+        METRIC_RECORD(metrics::LOG_SYNC_BATCH, batch);
+
+        lock.lock();
+        if (seg == active && to > activeSynced) {
+            activeSynced = to;
+        }
+        durableSeq = target;
+        counters.syncs++;
+        synced.notify_all();
+    }
+}
+
+void GameLog::compact(uint64_t height, const std::string& state) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = idsSinceSnapshot.find(height);
+        if (it == idsSinceSnapshot.end()) {
+            throw std::invalid_argument("game log: height " + std::to_string(height) +
+                                        " is not in the log");
+        }
+        if (height < snapshotFloor || (compactPending && height < pendingCompact.height)) {
+            return;
+        }
+        pendingCompact.height = height;
+        pendingCompact.lastValueId = it->second;
+        pendingCompact.state = state;
+        compactPending = true;
+    }
+    compactQueued.notify_one();
+}
+
+// Snapshot files are fsynced, renamed and the directory synced, which can
+// take milliseconds; doing it here keeps that off the commit path. Whatever
+// is pending at shutdown is still written.
+void GameLog::compactorLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        compactQueued.wait(lock, [this]() { return stopping || compactPending; });
+        if (!compactPending) {
+            return;
+        }
+        Snapshot snap;
+        std::swap(snap, pendingCompact);
+        compactPending = false;
+        lock.unlock();
+
+        try {
+            std::lock_guard<std::mutex> writing(snapshotMtx);
+            bool stale;
+            {
+                std::lock_guard<std::mutex> relock(mtx);
+                stale = snap.height < snapshotFloor;
+            }
+            if (!stale) {
+                writeSnapshot(snap.height, snap.lastValueId, snap.state);
+                dropCompacted(snap.height);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Game log compaction failed: " << e.what() << std::endl;
+        }
+        lock.lock();
+    }
+}
+
+// Segments whose successor starts at or below height + 1 only hold heights
+// the snapshot now covers. Caller holds snapshotMtx.
+void GameLog::dropCompacted(uint64_t height) {
+    std::lock_guard<std::mutex> lock(mtx);
+    snapshotFloor = std::max(snapshotFloor, height);
+    idsSinceSnapshot.erase(idsSinceSnapshot.begin(), idsSinceSnapshot.lower_bound(height));
+    size_t drop = 0;
+    while (drop + 1 < segments.size() && segments[drop + 1].first <= height + 1) {
+        unlink(segments[drop].second.c_str());
+        drop++;
+    }
+    segments.erase(segments.begin(), segments.begin() + static_cast<std::ptrdiff_t>(drop));
+    removeSnapshotsBefore(height);
+}
+
+// Synchronous, unlike compact(): the segments are dropped right after, and a
+// crash in between must find the snapshot already on disk.
+void GameLog::installSnapshot(const Snapshot& snapshot) {
+    std::lock_guard<std::mutex> writing(snapshotMtx);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!opened) {
+            throw std::logic_error("game log not open");
+        }
+        if (snapshot.height < nextHeight) {
+            return;
+        }
+    }
+    writeSnapshot(snapshot.height, snapshot.lastValueId, snapshot.state);
+
+    // Everything logged so far is older than the snapshot: continue in a
+    // fresh segment and drop the rest
+    std::lock_guard<std::mutex> lock(mtx);
+    if (compactPending && pendingCompact.height <= snapshot.height) {
+        compactPending = false;
+        pendingCompact = Snapshot();
+    }
+    snapshotFloor = snapshot.height;
+    nextHeight = snapshot.height + 1;
+    lastValueId = snapshot.lastValueId;
+    idsSinceSnapshot.clear();
+    idsSinceSnapshot[snapshot.height] = snapshot.lastValueId;
+    openSegment(nextHeight);
+    for (size_t i = 0; i + 1 < segments.size(); i++) {
+        unlink(segments[i].second.c_str());
+    }
+    segments.erase(segments.begin(), segments.end() - 1);
+    removeSnapshotsBefore(snapshot.height);
+}
+
+// Written beside, synced, then renamed over: a crash leaves the old snapshot
+void GameLog::writeSnapshot(uint64_t height, const std::string& valueId,
+                            const std::string& state) const {
+    std::string data(8, '\0');
+    char fixed[10];
+    putU64(fixed, height);
+    fixed[8] = static_cast<char>((valueId.size() >> 8) & 0xFF);
+    fixed[9] = static_cast<char>(valueId.size() & 0xFF);
+    data.append(fixed, sizeof(fixed));
+    data += valueId;
+    char stateLen[4];
+    putU32(stateLen, static_cast<uint32_t>(state.size()));
+    data.append(stateLen, sizeof(stateLen));
+    data += state;
+    putU32(&data[0], SNAPSHOT_MAGIC);
+    putU32(&data[4], crc32c(data.data() + 8, data.size() - 8));
+
+    std::string path = dir + "/" + fileName("snapshot-", height, ".snap");
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fail("cannot create " + tmp);
+    }
+    size_t off = 0;
+    while (off < data.size()) {
+        ssize_t n = write(fd, data.data() + off, data.size() - off);
+        if (n <= 0) {
+            close(fd);
+            fail("cannot write " + tmp);
+        }
+        off += static_cast<size_t>(n);
+    }
+    fsync(fd);
+    close(fd);
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        fail("cannot rename " + tmp);
+    }
+    syncDirectory();
+}
+
+void GameLog::removeSnapshotsBefore(uint64_t height) const {
+    for (const auto& snap : listFiles("snapshot-", ".snap")) {
+        if (snap.first < height) {
+            unlink(snap.second.c_str());
+        }
+    }
+}
+
+GameLog::Stats GameLog::stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return counters;
+}
@@ -0,0 +1,131 @@
+// src/network/GameLog.h
+#pragma once
+#include "Consensus.h"
+#include "WireCodec.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Append-only record of every decided height, so a restarted node picks up
+// where it stopped instead of losing the hand.
+//
+// The log is a directory of fixed-size, memory-mapped segment files named
+// after the first height they hold. A record is
+//     u32 length | u32 crc32c | COMMIT frame (height, valueId, parentId,
+//                                            entries, certificate)
+// in the wire codec's binary format, so replay hands out FrameViews straight
+// from the mapping. A height appended without its certificate is written as
+// a PROPOSAL frame, which is the same less the certificate. A zero length marks the end of the written part; a bad
+// checksum marks a torn write and everything after it is discarded.
+//
+// append() only copies into the mapping. A flusher thread msyncs whatever
+// has accumulated since its last pass, so heights decided close together
+// share one sync. compact() hands a snapshot to a second thread, which writes
+// it and deletes the segments it covers; only the newest pending snapshot is
+// written, and one thread at a time writes snapshot files.
+class GameLog {
+public:
+    static const size_t DEFAULT_SEGMENT_SIZE = 8 * 1024 * 1024;
+
+    struct Snapshot {
+        uint64_t height = 0;          // last height folded in
+        std::string lastValueId;
+        std::string state;            // opaque application state
+    };
+
+    struct Recovery {
+        bool hasSnapshot = false;
+        Snapshot snapshot;
+        uint64_t nextHeight = 0;      // first height not in the log
+        std::string lastValueId;      // Consensus::GENESIS_ID for an empty log
+        size_t records = 0;           // replayed after the snapshot
+        bool tornTail = false;
+    };
+
+    struct Stats {
+        uint64_t appends = 0;
+        uint64_t syncs = 0;
+        uint64_t bytes = 0;
+    };
+
+    using SnapshotFn = std::function<void(const Snapshot& snapshot)>;
+    using ReplayFn = std::function<void(uint64_t height, const wire::FrameView& frame)>;
+
+    explicit GameLog(std::string directory, size_t segmentSize = DEFAULT_SEGMENT_SIZE);
+    ~GameLog();
+
+    GameLog(const GameLog&) = delete;
+    GameLog& operator=(const GameLog&) = delete;
+
+    // Hands the newest snapshot to `restore`, replays every record after it
+    // and opens the log for appending. Throws std::runtime_error on I/O
+    // failure.
+    Recovery open(const SnapshotFn& restore, const ReplayFn& replay);
+
+    // Heights must arrive in order. Returns a sequence number for waitDurable.
+    uint64_t append(const ConsensusMessage& decided);
+    uint64_t append(uint64_t height, const std::vector<CommitEntry>& entries);
+    void waitDurable(uint64_t seq);
+
+    // Folds every height up to and including `height` (which must have been
+    // appended since the last snapshot) into a snapshot holding `state`.
+    // Returns once the snapshot is queued; a newer one replaces it unwritten.
+    void compact(uint64_t height, const std::string& state);
+    // Continues the log after a snapshot taken elsewhere (state transfer),
+    // dropping everything older. Ignored unless it is ahead of the log.
+    void installSnapshot(const Snapshot& snapshot);
+
+    Stats stats() const;
+
+private:
+    struct Segment;
+
+    void openSegment(uint64_t baseHeight);
+    void openSegmentSized(uint64_t baseHeight, size_t size);
+    void flusherLoop();
+    void compactorLoop();
+    void dropCompacted(uint64_t height);
+    bool readSnapshot(const std::string& path, Snapshot& out) const;
+    void writeSnapshot(uint64_t height, const std::string& valueId, const std::string& state) const;
+    void removeSnapshotsBefore(uint64_t height) const;
+    std::vector<std::pair<uint64_t, std::string>> listFiles(const char* prefix,
+                                                           const char* suffix) const;
+    void syncDirectory() const;
+
+    std::string dir;
+    size_t segmentSize;
+
+    mutable std::mutex mtx;
+    std::condition_variable appended;
+    std::condition_variable synced;
+    std::shared_ptr<Segment> active;
+    std::vector<std::shared_ptr<Segment>> sealed;       // rolled, not yet fully synced
+    std::vector<std::pair<uint64_t, std::string>> segments;  // base height, path
+    size_t activeSynced;
+    uint64_t nextHeight;
+    std::string lastValueId;
+    std::map<uint64_t, std::string> idsSinceSnapshot;   // height -> valueId, snapshot on
+    uint64_t appendSeq;
+    uint64_t durableSeq;
+    Stats counters;
+    bool opened;
+    bool stopping;
+    std::thread flusher;
+    std::string scratch;
+
+    // Newest snapshot waiting for the compactor, and the height of the last
+    // one written. snapshotMtx keeps snapshot files to one writer.
+    bool compactPending;
+    Snapshot pendingCompact;
+    uint64_t snapshotFloor;
+    std::condition_variable compactQueued;
+    std::mutex snapshotMtx;
+    std::thread compactor;
+};
@@ -0,0 +1,44 @@
+// src/network/IoPool.cpp
+#include "IoPool.h"
+#include <algorithm>
+
+IoPool::IoPool(size_t count)
+    : ioContext(),
+      work(boost::asio::make_work_guard(ioContext)),
+      threadCount(0) {
+    setThreads(count);
+}
+
+IoPool::~IoPool() {
+    stop();
+}
+
+// 0 means one thread per core
+void IoPool::setThreads(size_t count) {
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = count;
+}
+
+void IoPool::start() {
+    if (!threads.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back([this]() { ioContext.run(); });
+    }
+}
+
+void IoPool::stop() {
+    work.reset();
+    ioContext.stop();
+    for (auto& thread : threads) {
+        if (thread.joinable() && thread.get_id() != std::this_thread::get_id()) {
+            thread.join();
+        } else if (thread.joinable()) {
+            thread.detach();
+        }
+    }
+    threads.clear();
+}
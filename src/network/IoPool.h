@@ -0,0 +1,34 @@
+// src/network/IoPool.h
+#pragma once
+#include <boost/asio.hpp>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// One io_context run by a fixed set of threads. Per-connection ordering is
+// provided by giving every socket its own strand (see makeStrand), so
+// handlers for different peers run in parallel across the pool.
+class IoPool {
+public:
+    using Strand = boost::asio::strand<boost::asio::io_context::executor_type>;
+
+    explicit IoPool(size_t threads = 0);
+    ~IoPool();
+
+    IoPool(const IoPool&) = delete;
+    IoPool& operator=(const IoPool&) = delete;
+
+    void start();
+    void stop();
+
+    boost::asio::io_context& context() { return ioContext; }
+    Strand makeStrand() { return boost::asio::make_strand(ioContext); }
+    size_t size() const { return threadCount; }
+    void setThreads(size_t threads);
+
+private:
+    boost::asio::io_context ioContext;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work;
+    std::vector<std::thread> threads;
+    size_t threadCount;
+};
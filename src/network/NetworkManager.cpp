@@ -1,278 +1,1375 @@
-// NetworkManager.h
+// NetworkManager.cpp
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
+#include <netdb.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include "NetworkManager.h"
 #include <errno.h>
 #include "MembershipList.h"
+#include "Metrics.h"
+#include "SecureRandom.h"
 #include <json/json.h>
 #include <vector>
 #include <map>
 #include <chrono>
 #include <string>
-#include <iostream>  // Add this for std::cerr
-#include <thread>    // Add this for std::thread
-#include <boost/asio.hpp>  // Add this for boost::asio
-
-enum class HandshakeState {
-    INIT,
-    WAIT_HELLO,
-    WAIT_WELCOME,
-    ESTABLISHED,
-    ERROR
-};
-
-struct PendingConnection {
-    int socket;
-    HandshakeState state;
-    std::string peerHostname;
-    int peerId;
-    std::chrono::steady_clock::time_point startTime;
-    bool isOutgoing;
-    struct sockaddr_in addr;  // Add this line
-
-    PendingConnection() : 
-        socket(-1), 
-        state(HandshakeState::INIT), 
-        peerId(-1), 
-        isOutgoing(false) {}
-
-    PendingConnection(int sock, bool outgoing) : 
-        socket(sock),
-        state(outgoing ? HandshakeState::WAIT_WELCOME : HandshakeState::WAIT_HELLO),
-        peerId(-1),
-        startTime(std::chrono::steady_clock::now()),
-        isOutgoing(outgoing) {}
-};
-
-class NetworkManager {
-private:
-    MembershipList& membershipList;
-    std::string clientId;
-    std::string serverHost;
-    int serverPort;
-    int serverSocket;  // Changed from sock
-    bool connected;
-    std::mutex mtx;
-    int nodeId;
-    boost::asio::io_context io_context;
-    boost::asio::ip::tcp::acceptor acceptor;
-    std::thread io_thread_;
-    std::map<int, PendingConnection> pendingConnections;
-
-    bool connectToServer();
-
-    void sendMessage(int socket, const Json::Value& message) {
-        Json::FastWriter writer;
-        std::string data = writer.write(message);
-        uint32_t length = htonl(data.length());
-        send(socket, &length, 4, 0);
-        send(socket, data.c_str(), data.length(), 0);
-    }
-
-    void sendMessage(const std::string& message) {
-        std::string data = message;
-        uint32_t length = htonl(data.length());
-        send(serverSocket, &length, 4, 0);
-        send(serverSocket, data.c_str(), data.length(), 0);
-    }
-
-    std::string receiveMessage() {
-        uint32_t length;
-        recv(serverSocket, &length, 4, MSG_WAITALL);
-        length = ntohl(length);
-        
-        std::vector<char> buffer(length);
-        recv(serverSocket, buffer.data(), length, MSG_WAITALL);
-        return std::string(buffer.data(), length);
-    }
-
-    void handleServerMessages();
-
-    void setupAsyncListener();
-
-    void startAccept() {
-        auto socket = std::make_shared<boost::asio::ip::tcp::socket>(io_context);
-        
-        acceptor.async_accept(*socket,
-            [this, socket](const boost::system::error_code& error) {
-                if (!error) {
-                    // Set TCP_NODELAY
-                    socket->set_option(boost::asio::ip::tcp::no_delay(true));
-
-                    // Create pending connection
-                    PendingConnection pending(socket->native_handle(), false);
-                    pending.startTime = std::chrono::steady_clock::now();
-                    
-                    {
-                        std::lock_guard<std::mutex> lock(mtx);
-                        pendingConnections[socket->native_handle()] = pending;
-                    }
-
-                    // Start reading
-                    startRead(socket);
-                }
-                
-                // Continue accepting
-                startAccept();
+#include <cstring>
+#include <stdexcept>
+#include <iostream>
+#include <thread>
+#include <boost/asio.hpp>
+
+namespace {
+
+// State transfer pacing
+const size_t STATE_CHUNK = 32 * 1024;       // snapshot bytes per STATE frame
+const size_t STATE_BURST = 64 * 1024;       // bytes queued per pump step
+const size_t STATE_WINDOW = 256 * 1024;     // peer queue depth the pump waits below
+const std::chrono::seconds SYNC_TIMEOUT(5);
+
+// A connection that has not finished HELLO/WELCOME/AUTH by then is dropped
+const std::chrono::seconds HANDSHAKE_TIMEOUT(5);
+const size_t NONCE_BYTES = 16;
+
+std::string freshNonce() {
+    SecureRandom random;
+    std::string nonce(NONCE_BYTES, '\0');
+    for (size_t i = 0; i < NONCE_BYTES; i += 8) {
+        uint64_t v = random.next();
+        std::memcpy(&nonce[i], &v, 8);
+    }
+    return nonce;
+}
+
+// What a side signs to prove it holds its key: its role, both node ids and
+// both nonces, the initiator's first. The role keeps a WELCOME signature
+// from passing as an AUTH, the ids keep it from being replayed to a third
+// node, and the peer's fresh nonce keeps it from being replayed at all.
+std::string handshakeBytes(const char* role, int signer, int peer,
+                           const std::string& initiatorNonce, const std::string& responderNonce) {
+    return std::string("MPV1/") + role + "/" + std::to_string(signer) + "/" +
+           std::to_string(peer) + "/" + ConsensusMessage::toHex(initiatorNonce) + "/" +
+           ConsensusMessage::toHex(responderNonce);
+}
+
+} // namespace
+
+NetworkManager::NetworkManager(MembershipList& list,
+                               const std::string& id,
+                               const std::string& host,
+                               int port,
+                               int nid)
+    : clientId(id),
+      serverHost(host),
+      serverPort(port),
+      serverSocket(-1),
+      connected(false),
+      nodeId(nid),
+      peerPort(PEER_PORT),
+      wireFormat(wire::Format::BINARY),
+      sendHighWaterMark(SendQueue::DEFAULT_HIGH_WATER),
+      congestedPeers(0),
+      metricsInterval(0),
+      metricsJson(false),
+      ioPool(),
+      timers(ioPool.context()),
+      acceptor(ioPool.context()),
+      signingKey(new Ed25519PrivateKey()),
+      workers(nullptr),
+      failureDetector(nid,
+                      [this](int peer, bool alive) { onMemberState(peer, alive); },
+                      [this](int peer, const Probe& probe) { sendProbe(peer, probe); },
+                      [this](std::chrono::milliseconds delay, std::function<void()> fn) {
+                          scheduleAfter(delay, std::move(fn));
+                      }),
+      started(false) {
+    addTable(DEFAULT_TABLE, "room1", list);
+}
+
+NetworkManager::Table::Table(NetworkManager& host, uint32_t tableId, const std::string& room,
+                             MembershipList& list)
+    : id(tableId),
+      roomId(room),
+      membershipList(list),
+      consensus(host.nodeId, list,
+                [&host, this](const ConsensusMessage& msg) { host.broadcastConsensus(*this, msg); },
+                Consensus::CommitFn(),
+                [&host](std::chrono::milliseconds delay, std::function<void()> fn) {
+                    host.scheduleAfter(delay, std::move(fn));
+                }),
+      syncPeer(-1) {
+    consensus.setSigner([&host](const std::string& bytes) { return host.signingKey->sign(bytes); });
+    consensus.setSendTo([&host, this](int peer, const ConsensusMessage& msg) {
+        host.sendConsensusTo(*this, peer, msg);
+    });
+    consensus.setDecidedHandler(
+        [&host, this](const ConsensusMessage& decided) { host.onCommitted(*this, decided); });
+}
+
+NetworkManager::~NetworkManager() {
+    timers.stop();
+    ioPool.stop();
+    // No more submissions once the io threads are gone; let the last batch land
+    verifier.reset();
+    if (serverSocket >= 0) {
+        // Unblocks the server reader before it is joined
+        connected = false;
+        shutdown(serverSocket, SHUT_RDWR);
+    }
+    if (serverThread.joinable()) {
+        serverThread.join();
+    }
+    if (serverSocket >= 0) {
+        close(serverSocket);
+    }
+}
+
+void NetworkManager::start() {
+    started = true;
+    for (auto& entry : tables) {
+        if (!entry.second->gameLogDir.empty()) {
+            recoverFromLog(*entry.second);
+        }
+    }
+    if (!workers) {
+        ownedWorkers.reset(new WorkerPool());
+        workers = ownedWorkers.get();
+    }
+    verifier.reset(new VoteVerifier(*workers, [this](uint32_t id,
+                                                     const std::vector<ConsensusMessage>& batch) {
+        Table* t = findTable(id);
+        if (t) {
+            t->consensus.onMessages(batch);
+        }
+    }));
+    setupAsyncListener();
+    ioPool.start();
+    for (auto& entry : tables) {
+        entry.second->consensus.start();
+    }
+    failureDetector.start();
+    if (metricsInterval.count() > 0) {
+        scheduleMetricsLog();
+    }
+
+    if (!connectToServer()) {
+        std::cerr << "Failed to connect to server" << std::endl;
+        return;
+    }
+
+    // The server answers in order, so each reply belongs to the oldest
+    // JOIN still waiting
+    for (auto& entry : tables) {
+        Json::Value joinMsg;
+        joinMsg["command"] = "JOIN";
+        joinMsg["room_id"] = entry.second->roomId;
+        joinMsg["client_id"] = clientId;
+
+        pendingJoins.push_back(entry.first);
+        if (!sendMessage(joinMsg.toStyledString())) {
+            std::cerr << "Lost connection to server" << std::endl;
+            break;
+        }
+    }
+
+    serverThread = std::thread(&NetworkManager::handleServerMessages, this);
+}
+
+void NetworkManager::addTable(uint32_t tableId, const std::string& roomId, MembershipList& list) {
+    if (started) {
+        throw std::logic_error("tables are added before start()");
+    }
+    if (tables.count(tableId) != 0) {
+        throw std::invalid_argument("table " + std::to_string(tableId) + " is already hosted");
+    }
+    tables[tableId].reset(new Table(*this, tableId, roomId, list));
+}
+
+NetworkManager::Table& NetworkManager::table(uint32_t id) const {
+    Table* t = findTable(id);
+    if (!t) {
+        throw std::out_of_range("table " + std::to_string(id) + " is not hosted here");
+    }
+    return *t;
+}
+
+NetworkManager::Table* NetworkManager::findTable(uint32_t id) const {
+    auto it = tables.find(id);
+    return it == tables.end() ? nullptr : it->second.get();
+}
+
+void NetworkManager::submitAction(const CommitEntry& entry, uint32_t tableId) {
+    table(tableId).consensus.submit(entry);
+}
+
+void NetworkManager::setCommitHandler(Consensus::CommitFn handler, uint32_t tableId) {
+    table(tableId).commitHandler = std::move(handler);
+}
+
+void NetworkManager::setWireFormat(wire::Format format) {
+    wireFormat = format;
+}
+
+void NetworkManager::setSendHighWaterMark(size_t bytes) {
+    sendHighWaterMark = bytes;
+}
+
+void NetworkManager::setIoThreads(size_t threads) {
+    ioPool.setThreads(threads);
+}
+
+void NetworkManager::setWorkerPool(WorkerPool& pool) {
+    workers = &pool;
+}
+
+void NetworkManager::setSigningKey(const std::string& seed) {
+    if (started) {
+        throw std::logic_error("the signing key is set before start()");
+    }
+    signingKey.reset(new Ed25519PrivateKey(seed));
+}
+
+void NetworkManager::setPeerKeys(std::map<int, std::string> keys) {
+    if (started) {
+        throw std::logic_error("peer keys are set before start()");
+    }
+    peerKeys = std::move(keys);
+}
+
+void NetworkManager::setPeerPort(int port) {
+    peerPort = port;
+}
+
+void NetworkManager::setMetricsLog(std::chrono::seconds interval, bool json) {
+    metricsInterval = interval;
+    metricsJson = json;
+}
+
+void NetworkManager::setGameLog(const std::string& dir, uint32_t tableId) {
+    table(tableId).gameLogDir = dir;
+}
+
+void NetworkManager::publishDeck(uint64_t handId, uint16_t cardBytes, std::string deck,
+                                 uint32_t tableId) {
+    Table& t = table(tableId);
+    t.tableState.setDeck(handId, cardBytes, std::move(deck));
+    checkpointLog(t);
+}
+
+void NetworkManager::setStateHandler(std::function<void(const TableSnapshot&)> handler,
+                                     uint32_t tableId) {
+    table(tableId).stateHandler = std::move(handler);
+}
+
+TableSnapshot NetworkManager::tableSnapshot(uint32_t tableId) const {
+    return table(tableId).tableState.current();
+}
+
+std::vector<int> NetworkManager::validators(uint32_t tableId) const {
+    return table(tableId).consensus.validatorSet();
+}
+
+// Table checkpoints double as game log snapshots
+void NetworkManager::checkpointLog(Table& t) {
+    if (!t.gameLog) {
+        return;
+    }
+    uint64_t height;
+    TableState::Bytes bytes = t.tableState.checkpoint(height);
+    if (height == 0) {
+        return;
+    }
+    try {
+        t.gameLog->compact(height - 1, *bytes);
+    } catch (const std::exception& e) {
+        std::cerr << "Game log compaction failed: " << e.what() << std::endl;
+    }
+}
+
+// Replays the game log through the commit handler before any peer traffic,
+// so the table resumes at the height it stopped at. Heights logged without
+// their certificate cannot be handed on as deltas, so if there were any the
+// replayed heights are folded into a checkpoint: peers syncing from here get
+// them as a snapshot.
+void NetworkManager::recoverFromLog(Table& t) {
+    t.gameLog.reset(new GameLog(t.gameLogDir));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool uncertified = false;
+    GameLog::Recovery rec = t.gameLog->open(
+        [&t](const GameLog::Snapshot& snap) {
+            TableSnapshot table;
+            if (TableSnapshot::decode(snap.state.data(), snap.state.size(), table)) {
+                t.tableState.install(table);
             }
-        );
-    }
-
-    void startRead(std::shared_ptr<boost::asio::ip::tcp::socket> socket) {
-        auto buffer = std::make_shared<std::vector<char>>(1024);
-        
-        socket->async_read_some(
-            boost::asio::buffer(*buffer),
-            [this, socket, buffer](
-                const boost::system::error_code& error,
-                std::size_t bytes_transferred
-            ) {
-                if (!error) {
-                    handlePeerEvent(socket->native_handle());
-                    startRead(socket);
-                }
+        },
+        [&t, &uncertified](uint64_t height, const wire::FrameView& frame) {
+            ConsensusMessage msg;
+            if (!frame.toConsensusMessage(msg)) {
+                return;
             }
-        );
-    }
-
-    void handlePeerEvent(int sock) {
-        auto it = pendingConnections.find(sock);
-        if (it != pendingConnections.end()) {
-            handlePendingConnection(it->second);
-        }
-    }
-
-    void handlePendingConnection(PendingConnection& pending) {
-        try {
-            std::string msg = receivePeerMessage(pending.socket);
-            Json::Value root;
-            Json::Reader reader;
-            
-            if (reader.parse(msg, root)) {
-                std::string type = root["type"].asString();
-                
-                switch (pending.state) {
-                    case HandshakeState::WAIT_HELLO:
-                        if (type == "HELLO") {
-                            int peerId = root["node_id"].asInt();
-                            handleHello(pending, peerId);
-                        }
-                        break;
-                        
-                    case HandshakeState::WAIT_WELCOME:
-                        if (type == "WELCOME") {
-                            handleWelcome(pending);
-                        }
-                        break;
-                        
-                    default:
-                        processPeerMessage(pending.socket, msg);
-                        break;
+            uncertified |= msg.certificate.empty();
+            t.tableState.apply(msg);
+            if (t.commitHandler) {
+                t.commitHandler(height, msg.entries);
+            }
+        });
+    TableSnapshot state = t.tableState.current();
+    t.consensus.restore(rec.nextHeight, rec.lastValueId, state.committed, state.validators);
+    if (uncertified) {
+        t.tableState.checkpointNow();
+        checkpointLog(t);
+    }
+    std::cout << "Game log: resumed " << t.roomId << " at height " << rec.nextHeight << " ("
+              << (rec.hasSnapshot ? "snapshot + " : "") << rec.records << " records"
+              << (rec.tornTail ? ", torn tail dropped" : "") << ") in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start).count()
+              << " us" << std::endl;
+}
+
+int NetworkManager::listenPort() const {
+    boost::system::error_code ignored;
+    return acceptor.local_endpoint(ignored).port();
+}
+
+SendStats NetworkManager::sendStats() {
+    SendStats total;
+    for (const auto& conn : connections.snapshot()) {
+        if (conn->sendQueue) {
+            total += conn->sendQueue->stats();
+        }
+    }
+    return total;
+}
+
+bool NetworkManager::connectToServer() {
+    struct addrinfo hints;
+    struct addrinfo* result = nullptr;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    std::string port = std::to_string(serverPort);
+    if (getaddrinfo(serverHost.c_str(), port.c_str(), &hints, &result) != 0) {
+        return false;
+    }
+
+    for (struct addrinfo* ai = result; ai != nullptr; ai = ai->ai_next) {
+        serverSocket = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (serverSocket < 0) {
+            continue;
+        }
+        if (connect(serverSocket, ai->ai_addr, ai->ai_addrlen) == 0) {
+            connected = true;
+            break;
+        }
+        close(serverSocket);
+        serverSocket = -1;
+    }
+    freeaddrinfo(result);
+    return connected;
+}
+
+void NetworkManager::handleServerMessages() {
+    while (connected) {
+        std::string msg = receiveMessage();
+        if (msg.empty()) {
+            if (connected) {
+                std::cerr << "Lost connection to server" << std::endl;
+            }
+            break;
+        }
+
+        if (pendingJoins.empty()) {
+            continue;
+        }
+        uint32_t tableId = pendingJoins.front();
+        pendingJoins.pop_front();
+
+        Json::Value root;
+        Json::Reader reader;
+        if (!reader.parse(msg, root)) {
+            continue;
+        }
+
+        std::string status = root["status"].asString();
+        if (status == "error") {
+            std::cerr << "Server error: " << root["message"].asString() << std::endl;
+            continue;
+        }
+
+        // Existing room members: introduce ourselves at this table. The
+        // first one in the room founds the table; the rest learn who
+        // validates from the state a member sends them.
+        bool alone = true;
+        for (const auto& member : root["members"]) {
+            std::string hostname = member.asString();
+            if (hostname != clientId) {
+                alone = false;
+                connectToPeer(hostname, tableId);
+            }
+        }
+        if (alone) {
+            table(tableId).consensus.found();
+        }
+    }
+}
+
+void NetworkManager::setupAsyncListener() {
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(), peerPort);
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+    acceptor.bind(endpoint);
+    acceptor.listen();
+    startAccept();
+}
+
+// Members are plain hostnames listening on our own peer port, or
+// "host:port" when peers listen on different ports (e.g. one host running
+// several nodes). A member we already dialled for another table is joined
+// over that connection: its HELLO queues behind the first one, so the peer
+// always sees the connection established before the table joins.
+void NetworkManager::connectToPeer(const std::string& hostname, uint32_t tableId) {
+    Table& t = table(tableId);
+    {
+        std::lock_guard<std::mutex> lock(dialMtx);
+        auto it = dialed.find(hostname);
+        if (it != dialed.end() && connections.find(it->second->socket) == it->second) {
+            sendHandshake(*it->second, wire::MessageType::HELLO, t);
+            return;
+        }
+    }
+    try {
+        std::string host = hostname;
+        std::string port = std::to_string(peerPort);
+        size_t colon = hostname.rfind(':');
+        if (colon != std::string::npos) {
+            host = hostname.substr(0, colon);
+            port = hostname.substr(colon + 1);
+        }
+        boost::asio::ip::tcp::resolver resolver(ioPool.context());
+        auto endpoints = resolver.resolve(host, port);
+        auto socket = std::make_shared<boost::asio::ip::tcp::socket>(ioPool.makeStrand());
+        boost::asio::connect(*socket, endpoints);
+        socket->set_option(boost::asio::ip::tcp::no_delay(true));
+
+        ConnectionTable::Ptr conn = registerConnection(socket, true);
+        conn->peerHostname = hostname;
+        {
+            std::lock_guard<std::mutex> lock(dialMtx);
+            dialed[hostname] = conn;
+        }
+        sendHandshake(*conn, wire::MessageType::HELLO, t);
+        startRead(conn);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to connect to peer " << hostname << ": " << e.what() << std::endl;
+    }
+}
+
+void NetworkManager::sendMessage(int socket, const Json::Value& message) {
+    Json::FastWriter writer;
+    sendFrame(socket, writer.write(message));
+}
+
+void NetworkManager::sendFrame(int socket, const std::string& body) {
+    ConnectionTable::Ptr conn = connections.find(socket);
+    if (conn) {
+        conn->sendQueue->enqueue(body);
+    }
+}
+
+ConnectionTable::Ptr NetworkManager::registerConnection(
+        std::shared_ptr<boost::asio::ip::tcp::socket> socket, bool outgoing) {
+    auto conn = std::make_shared<PendingConnection>(socket->native_handle(), outgoing);
+    conn->stream = socket;
+    conn->challenge.nonce = freshNonce();
+    conn->decoder = std::make_shared<FrameDecoder>();
+    // Consensus is held back while any peer sits above the high-water mark;
+    // the connection is shared, so that holds every table back. Counted and
+    // applied under one lock, or a relief racing a new congestion could
+    // leave the tables in the wrong state. Releasing a table sends what it
+    // held back, which can congest a peer again on this thread: hence
+    // recursive, and the count is read afresh for every table.
+    conn->sendQueue = std::make_shared<SendQueue>(socket, sendHighWaterMark, [this](bool congested) {
+        std::lock_guard<std::recursive_mutex> lock(backpressureMtx);
+        congestedPeers += congested ? 1 : -1;
+        for (auto& entry : tables) {
+            entry.second->consensus.setBackpressure(congestedPeers > 0);
+        }
+    });
+    connections.insert(conn);
+    std::weak_ptr<PendingConnection> weak = conn;
+    conn->handshakeTimer = timers.schedule(
+        std::chrono::duration_cast<std::chrono::milliseconds>(HANDSHAKE_TIMEOUT),
+        [this, weak]() { expireHandshake(weak); });
+    return conn;
+}
+
+void NetworkManager::expireHandshake(std::weak_ptr<PendingConnection> weak) {
+    ConnectionTable::Ptr conn = weak.lock();
+    if (!conn) {
+        return;
+    }
+    // On the socket's strand, where the handshake itself runs
+    boost::asio::post(conn->stream->get_executor(), [this, conn]() {
+        auto age = std::chrono::steady_clock::now() - conn->startTime;
+        if (conn->state == HandshakeState::ESTABLISHED || age < HANDSHAKE_TIMEOUT ||
+            connections.find(conn->socket) != conn) {
+            return;
+        }
+        METRIC_COUNT(HANDSHAKES_EXPIRED);
+        std::cerr << "Handshake with "
+                  << (conn->peerHostname.empty() ? "incoming peer" : conn->peerHostname)
+                  << " timed out after "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(age).count()
+                  << " ms" << std::endl;
+        removePendingConnection(conn->socket);
+    });
+}
+
+// Length prefix and body in one sendmsg where the kernel takes it all,
+// resumed after a short write or a signal
+bool NetworkManager::sendMessage(const std::string& message) {
+    uint32_t length = htonl(static_cast<uint32_t>(message.length()));
+    struct iovec iov[2];
+    iov[0].iov_base = &length;
+    iov[0].iov_len = sizeof(length);
+    iov[1].iov_base = const_cast<char*>(message.data());
+    iov[1].iov_len = message.length();
+    struct msghdr hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = iov;
+    hdr.msg_iovlen = 2;
+    while (hdr.msg_iovlen > 0) {
+        ssize_t n = sendmsg(serverSocket, &hdr, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        size_t sent = static_cast<size_t>(n);
+        while (hdr.msg_iovlen > 0 && sent >= hdr.msg_iov->iov_len) {
+            sent -= hdr.msg_iov->iov_len;
+            hdr.msg_iov++;
+            hdr.msg_iovlen--;
+        }
+        if (hdr.msg_iovlen > 0) {
+            hdr.msg_iov->iov_base = static_cast<char*>(hdr.msg_iov->iov_base) + sent;
+            hdr.msg_iov->iov_len -= sent;
+        }
+    }
+    return true;
+}
+
+std::string NetworkManager::receiveMessage() {
+    uint32_t length;
+    if (recv(serverSocket, &length, 4, MSG_WAITALL) != 4) {
+        return "";
+    }
+    length = ntohl(length);
+
+    std::vector<char> buffer(length);
+    if (recv(serverSocket, buffer.data(), length, MSG_WAITALL) != static_cast<ssize_t>(length)) {
+        return "";
+    }
+    return std::string(buffer.data(), length);
+}
+
+// The first HELLO / WELCOME on a connection carries our nonce (and the
+// WELCOME its signature); later ones only join another table.
+void NetworkManager::sendHandshake(PendingConnection& pending, wire::MessageType type, Table& t,
+                                   const std::string& signature) {
+    const std::string& nonce = pending.challenge.nonce;
+    std::string body;
+    if (wireFormat == wire::Format::JSON) {
+        Json::Value msg;
+        msg["type"] = type == wire::MessageType::HELLO ? "HELLO" : "WELCOME";
+        msg["node_id"] = nodeId;
+        msg["height"] = Json::UInt64(t.consensus.committedHeight());
+        msg["round"] = t.consensus.currentRound();
+        msg["public_key"] = ConsensusMessage::toHex(signingKey->publicKey());
+        msg["nonce"] = ConsensusMessage::toHex(nonce);
+        if (!signature.empty()) {
+            msg["signature"] = ConsensusMessage::toHex(signature);
+        }
+        if (t.id != DEFAULT_TABLE) {
+            msg["table"] = t.id;
+        }
+        body = Json::FastWriter().write(msg);
+    } else if (type == wire::MessageType::HELLO) {
+        wire::encodeHello(body, nodeId, t.consensus.committedHeight(), signingKey->publicKey(),
+                          nonce);
+    } else {
+        wire::encodeWelcome(body, nodeId, t.consensus.committedHeight(), t.consensus.currentRound(),
+                            signingKey->publicKey(), nonce, signature);
+    }
+    wire::tagTable(body, t.id);
+    pending.sendQueue->enqueue(std::move(body));
+}
+
+void NetworkManager::sendAuth(PendingConnection& pending, const std::string& signature) {
+    std::string body;
+    if (wireFormat == wire::Format::JSON) {
+        Json::Value msg;
+        msg["type"] = "AUTH";
+        msg["node_id"] = nodeId;
+        msg["signature"] = ConsensusMessage::toHex(signature);
+        body = Json::FastWriter().write(msg);
+    } else {
+        wire::encodeAuth(body, nodeId, signature);
+    }
+    pending.sendQueue->enqueue(std::move(body));
+}
+
+// Binary bodies also carry whatever membership gossip is pending
+std::string NetworkManager::encodeConsensus(const Table& t, const ConsensusMessage& msg) {
+    std::string body;
+    if (wireFormat == wire::Format::JSON) {
+        Json::Value root = msg.toJson();
+        if (t.id != DEFAULT_TABLE) {
+            root["table"] = t.id;
+        }
+        body = Json::FastWriter().write(root);
+    } else {
+        wire::encodeConsensus(body, msg);
+        wire::appendGossip(body, failureDetector.takeUpdates());
+        wire::tagTable(body, t.id);
+    }
+    return body;
+}
+
+void NetworkManager::broadcastConsensus(Table& t, const ConsensusMessage& msg) {
+    // Encode once and share the body between every peer's queue
+    SendQueue::Body shared = std::make_shared<std::string>(encodeConsensus(t, msg));
+    std::lock_guard<std::mutex> lock(t.peersMtx);
+    for (int peer : t.peers) {
+        ConnectionTable::Ptr conn = connections.findPeer(peer);
+        if (conn && conn->state == HandshakeState::ESTABLISHED) {
+            conn->sendQueue->enqueue(shared);
+        }
+    }
+}
+
+void NetworkManager::sendConsensusTo(Table& t, int peerId, const ConsensusMessage& msg) {
+    ConnectionTable::Ptr conn = connections.findPeer(peerId);
+    if (conn) {
+        conn->sendQueue->enqueue(encodeConsensus(t, msg));
+    }
+}
+
+void NetworkManager::sendProbe(int peerId, const Probe& probe) {
+    ConnectionTable::Ptr conn = connections.findPeer(peerId);
+    if (conn) {
+        std::string body;
+        wire::encodeProbe(body, nodeId, probe);
+        conn->sendQueue->enqueue(std::move(body));
+    }
+}
+
+// Signed messages go through the verifier; the rest needs no crypto
+// Traffic from past what this node has decided means it missed heights
+// (e.g. the founding one, decided after the handshake): ask that peer.
+void NetworkManager::deliverConsensus(PendingConnection& pending, Table& t, ConsensusMessage msg) {
+    if (t.consensus.behind(msg.height)) {
+        requestStateIfBehind(t, pending, msg.height);
+    }
+    if (VoteVerifier::needsVerification(msg)) {
+        verifier->submit(t.id, std::move(msg));
+    } else {
+        t.consensus.onMessage(msg);
+    }
+}
+
+void NetworkManager::joinTable(Table& t, int peerId) {
+    {
+        std::lock_guard<std::mutex> lock(t.peersMtx);
+        t.peers.insert(peerId);
+    }
+    t.membershipList.addMember(std::to_string(peerId));
+}
+
+// The failure detector's verdict on a host updates our view at every table
+// it joined; the validator set follows only once a table decides the change
+void NetworkManager::onMemberState(int peerId, bool alive) {
+    for (auto& entry : tables) {
+        Table& t = *entry.second;
+        {
+            std::lock_guard<std::mutex> lock(t.peersMtx);
+            if (t.peers.count(peerId) == 0) {
+                continue;
+            }
+        }
+        if (alive) {
+            t.membershipList.addMember(std::to_string(peerId));
+        } else {
+            t.membershipList.removeMember(std::to_string(peerId));
+        }
+    }
+}
+
+void NetworkManager::startAccept() {
+    // Each accepted socket gets its own strand: its handlers never overlap,
+    // while different peers are served by the whole pool.
+    acceptor.async_accept(ioPool.makeStrand(),
+        [this](const boost::system::error_code& error, boost::asio::ip::tcp::socket peer) {
+            if (!error) {
+                auto socket = std::make_shared<boost::asio::ip::tcp::socket>(std::move(peer));
+
+                // Set TCP_NODELAY
+                socket->set_option(boost::asio::ip::tcp::no_delay(true));
+
+                // Create pending connection and start reading
+                startRead(registerConnection(socket, false));
+            }
+
+            // Continue accepting
+            startAccept();
+        }
+    );
+}
+
+void NetworkManager::startRead(ConnectionTable::Ptr conn) {
+    auto regions = conn->decoder->writable();
+    std::array<boost::asio::mutable_buffer, 2> buffers = {{
+        boost::asio::buffer(regions[0].data, regions[0].size),
+        boost::asio::buffer(regions[1].data, regions[1].size)
+    }};
+
+    conn->stream->async_read_some(
+        buffers,
+        [this, conn](
+            const boost::system::error_code& error,
+            std::size_t bytes_transferred
+        ) {
+            if (error) {
+                if (error != boost::asio::error::operation_aborted) {
+                    removePendingConnection(conn->socket);
                 }
+                return;
+            }
+
+            // Every complete frame from this read; partial ones wait for the next
+            conn->decoder->commit(bytes_transferred);
+            bool ok = conn->decoder->drain([this, &conn](const char* data, size_t len) {
+                handlePendingConnection(*conn, data, len);
+            });
+            if (!ok) {
+                std::cerr << "Oversized frame from peer, dropping connection" << std::endl;
+                removePendingConnection(conn->socket);
+                return;
+            }
+            startRead(conn);
+        }
+    );
+}
+
+void NetworkManager::handlePendingConnection(PendingConnection& pending, const char* data, size_t len) {
+    METRIC_COUNT(FRAMES_IN);
+    try {
+        if (wire::isBinary(data, len)) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            wire::FrameView frame;
+            if (!wire::decode(data, len, frame)) {
+                METRIC_COUNT(FRAMES_MALFORMED);
+                return;
             }
-        } catch (const std::exception& e) {
+            unsigned type = static_cast<unsigned>(frame.type);
+            METRIC_SINCE(metrics::decodeHistogram(type), start);
+            METRIC_TIMER(timer, metrics::handleHistogram(type));
+            handleFrame(pending, frame);
+            return;
+        }
+
+        // JSON compatibility path
+        Json::Value root;
+        Json::Reader reader;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!reader.parse(data, data + len, root)) {
+            METRIC_COUNT(FRAMES_MALFORMED);
+            return;
+        }
+        METRIC_SINCE(metrics::decodeHistogram(0), start);
+        METRIC_TIMER(timer, metrics::handleHistogram(0));
+        if (pending.state == HandshakeState::ESTABLISHED) {
+            processPeerMessage(pending, root);
+            return;
+        }
+        Handshake hs;
+        if (handshakeFromJson(root, hs)) {
+            handleHandshake(pending, hs);
+        }
+    } catch (const std::exception& e) {
+        METRIC_COUNT(HANDLER_ERRORS);
+        std::cerr << "Dropping peer " << pending.peerId.load() << ": " << e.what() << std::endl;
+        removePendingConnection(pending.socket);
+    }
+}
+
+void NetworkManager::handleFrame(PendingConnection& pending, const wire::FrameView& frame) {
+    if (pending.state == HandshakeState::ESTABLISHED) {
+        processPeerFrame(pending, frame);
+    } else if (frame.type == wire::MessageType::HELLO || frame.type == wire::MessageType::WELCOME ||
+               frame.type == wire::MessageType::AUTH) {
+        handleHandshake(pending, handshakeFromFrame(frame));
+    }
+}
+
+bool NetworkManager::handshakeFromJson(const Json::Value& root, Handshake& hs) {
+    std::string type = root["type"].asString();
+    if (type == "HELLO") {
+        hs.type = wire::MessageType::HELLO;
+    } else if (type == "WELCOME") {
+        hs.type = wire::MessageType::WELCOME;
+    } else if (type == "AUTH") {
+        hs.type = wire::MessageType::AUTH;
+    } else {
+        return false;
+    }
+    hs.table = root["table"].asUInt();
+    hs.peerId = root["node_id"].asInt();
+    hs.height = root["height"].asUInt64();
+    hs.round = root["round"].asInt();
+    hs.publicKey = ConsensusMessage::fromHex(root["public_key"].asString());
+    hs.nonce = ConsensusMessage::fromHex(root["nonce"].asString());
+    hs.signature = ConsensusMessage::fromHex(root["signature"].asString());
+    return true;
+}
+
+NetworkManager::Handshake NetworkManager::handshakeFromFrame(const wire::FrameView& frame) {
+    Handshake hs;
+    hs.type = frame.type;
+    hs.table = frame.table;
+    hs.peerId = frame.sender;
+    hs.height = frame.height;
+    hs.round = frame.round;
+    hs.publicKey = std::string(frame.publicKey);
+    hs.nonce = std::string(frame.nonce);
+    hs.signature = std::string(frame.signature);
+    return hs;
+}
+
+// Connections are bound to the node id whose key the peer proved it holds:
+// HELLO (nonce A) -> WELCOME (nonce B, responder's signature over both) ->
+// AUTH (initiator's signature over both). Either side drops the connection
+// on a bad signature, and nothing but HELLO / WELCOME / AUTH is read before
+// it completes.
+void NetworkManager::handleHandshake(PendingConnection& pending, const Handshake& hs) {
+    switch (hs.type) {
+        case wire::MessageType::HELLO:
+            if (pending.state == HandshakeState::WAIT_HELLO ||
+                pending.state == HandshakeState::WAIT_AUTH ||
+                pending.state == HandshakeState::ESTABLISHED) {
+                handleHello(pending, hs);
+            }
+            break;
+        case wire::MessageType::WELCOME:
+            if (pending.state == HandshakeState::WAIT_WELCOME ||
+                pending.state == HandshakeState::ESTABLISHED) {
+                handleWelcome(pending, hs);
+            }
+            break;
+        case wire::MessageType::AUTH:
+            if (pending.state == HandshakeState::WAIT_AUTH) {
+                handleAuth(pending, hs);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// A peer must present the key registered for its id, when keys are
+// registered at all, and never our own id.
+bool NetworkManager::acceptsPeerKey(int peerId, const std::string& publicKey) const {
+    if (peerId == nodeId || !Ed25519PublicKey::fromBytes(publicKey)) {
+        return false;
+    }
+    if (peerKeys.empty()) {
+        return true;
+    }
+    auto it = peerKeys.find(peerId);
+    return it != peerKeys.end() && it->second == publicKey;
+}
+
+// Called once the peer proved it holds publicKey. A second connection
+// claiming an id that is bound to another key stays out until the first
+// one closes.
+bool NetworkManager::bindPeerKey(PendingConnection& pending, int peerId,
+                                 const std::string& publicKey) {
+    if (verifier->setKey(peerId, publicKey)) {
+        return true;
+    }
+    std::cerr << "Peer " << peerId << " presented a different signing key" << std::endl;
+    removePendingConnection(pending.socket);
+    return false;
+}
+
+// The first HELLO on a connection starts the challenge; HELLOs for other
+// tables that arrive before AUTH wait for it, and once established a HELLO
+// only joins its table. A table we don't host ends a connection that is
+// not established yet, since the peer has nothing else to use it for.
+void NetworkManager::handleHello(PendingConnection& pending, const Handshake& hs) {
+    Table* t = findTable(hs.table);
+    if (!t) {
+        std::cerr << "Peer " << hs.peerId << " asked for table " << hs.table << ", not hosted here"
+                  << std::endl;
+        if (pending.state != HandshakeState::ESTABLISHED) {
+            removePendingConnection(pending.socket);
+        }
+        return;
+    }
+    if (pending.state == HandshakeState::ESTABLISHED) {
+        if (hs.peerId == pending.peerId) {
+            sendHandshake(pending, wire::MessageType::WELCOME, *t);
+            enterTable(pending, t->id, hs.height);
+        }
+        return;
+    }
+    if (pending.state == HandshakeState::WAIT_AUTH) {
+        if (hs.peerId == pending.challenge.peerId) {
+            pending.challenge.joins.emplace_back(t->id, hs.height);
+        }
+        return;
+    }
+    if (hs.nonce.size() != NONCE_BYTES || !acceptsPeerKey(hs.peerId, hs.publicKey)) {
+        std::cerr << "Peer " << hs.peerId << " did not present an acceptable key" << std::endl;
+        removePendingConnection(pending.socket);
+        return;
+    }
+    pending.challenge.peerId = hs.peerId;
+    pending.challenge.peerKey = hs.publicKey;
+    pending.challenge.peerNonce = hs.nonce;
+    pending.challenge.joins.emplace_back(t->id, hs.height);
+    pending.state = HandshakeState::WAIT_AUTH;
+    sendHandshake(pending, wire::MessageType::WELCOME, *t,
+                  signingKey->sign(handshakeBytes("welcome", nodeId, hs.peerId, hs.nonce,
+                                                  pending.challenge.nonce)));
+}
+
+void NetworkManager::handleWelcome(PendingConnection& pending, const Handshake& hs) {
+    Table* t = findTable(hs.table);
+    if (!t) {
+        if (pending.state != HandshakeState::ESTABLISHED) {
+            removePendingConnection(pending.socket);
+        }
+        return;
+    }
+    if (pending.state != HandshakeState::ESTABLISHED) {
+        std::shared_ptr<const Ed25519PublicKey> key;
+        if (hs.nonce.size() == NONCE_BYTES && acceptsPeerKey(hs.peerId, hs.publicKey)) {
+            key = Ed25519PublicKey::fromBytes(hs.publicKey);
+        }
+        if (!key || !key->verify(handshakeBytes("welcome", hs.peerId, nodeId,
+                                                pending.challenge.nonce, hs.nonce),
+                                 hs.signature)) {
+            std::cerr << "Peer " << hs.peerId << " failed to prove its signing key" << std::endl;
             removePendingConnection(pending.socket);
+            return;
+        }
+        if (!bindPeerKey(pending, hs.peerId, hs.publicKey)) {
+            return;
+        }
+        sendAuth(pending, signingKey->sign(handshakeBytes("auth", nodeId, hs.peerId,
+                                                          pending.challenge.nonce, hs.nonce)));
+        markEstablished(pending, hs.peerId);
+    } else if (hs.peerId != pending.peerId) {
+        return;
+    }
+    if (hs.height > t->consensus.committedHeight()) {
+        std::cout << "Peer " << hs.peerId << " is at height " << hs.height << " round "
+                  << hs.round << " of " << t->roomId << std::endl;
+    }
+    enterTable(pending, t->id, hs.height);
+}
+
+void NetworkManager::handleAuth(PendingConnection& pending, const Handshake& hs) {
+    PendingConnection::Challenge& c = pending.challenge;
+    std::shared_ptr<const Ed25519PublicKey> key = Ed25519PublicKey::fromBytes(c.peerKey);
+    if (hs.peerId != c.peerId || !key ||
+        !key->verify(handshakeBytes("auth", c.peerId, nodeId, c.peerNonce, c.nonce),
+                     hs.signature)) {
+        std::cerr << "Peer " << c.peerId << " failed to prove its signing key" << std::endl;
+        removePendingConnection(pending.socket);
+        return;
+    }
+    if (!bindPeerKey(pending, c.peerId, c.peerKey)) {
+        return;
+    }
+    markEstablished(pending, c.peerId);
+    // The first table was welcomed with the challenge, the rest only now
+    std::vector<std::pair<uint32_t, uint64_t>> joins;
+    joins.swap(c.joins);
+    for (size_t i = 0; i < joins.size(); ++i) {
+        if (i > 0) {
+            sendHandshake(pending, wire::MessageType::WELCOME, table(joins[i].first));
         }
+        enterTable(pending, joins[i].first, joins[i].second);
     }
+}
+
+void NetworkManager::enterTable(PendingConnection& pending, uint32_t tableId, uint64_t peerHeight) {
+    Table& t = table(tableId);
+    joinTable(t, pending.peerId);
+    requestStateIfBehind(t, pending, peerHeight);
+}
 
-    void startPeerHandshake(int socket, const sockaddr_in& addr) {
-        std::lock_guard<std::mutex> lock(mtx);
-        PendingConnection pending;
-        pending.socket = socket;
-        pending.state = HandshakeState::WAIT_HELLO;
-        pending.addr = addr;
-        pendingConnections[socket] = pending;
+void NetworkManager::markEstablished(PendingConnection& pending, int peerId) {
+    METRIC_SINCE(metrics::HANDSHAKE_NS, pending.startTime);
+    METRIC_COUNT(HANDSHAKES_COMPLETED);
+    timers.cancel(pending.handshakeTimer);
+    pending.peerId = peerId;
+    pending.state = HandshakeState::ESTABLISHED;
+    ConnectionTable::Ptr conn = connections.find(pending.socket);
+    if (conn) {
+        connections.bindPeer(conn);
     }
+    failureDetector.addMember(peerId);
+}
 
-    void handleHello(PendingConnection& pending, int peerId) {
-        // Send WELCOME message
-        Json::Value welcome;
-        welcome["type"] = "WELCOME";
-        welcome["node_id"] = nodeId;
-        sendMessage(pending.socket, welcome);
-        
-        // Update connection state
-        pending.state = HandshakeState::ESTABLISHED;
-        membershipList.addMember(std::to_string(peerId));
+void NetworkManager::removePendingConnection(int socket) {
+    // The asio socket owns the descriptor: shut it down so the pending read
+    // fails and the socket is closed when its last reference goes away.
+    ConnectionTable::Ptr conn = connections.erase(socket);
+    if (conn) {
+        timers.cancel(conn->handshakeTimer);
+        if (conn->state != HandshakeState::ESTABLISHED) {
+            METRIC_COUNT(HANDSHAKES_FAILED);
+        }
+        boost::system::error_code ignored;
+        conn->stream->shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+        conn->sendQueue->close();
+        if (!conn->peerHostname.empty()) {
+            std::lock_guard<std::mutex> lock(dialMtx);
+            auto it = dialed.find(conn->peerHostname);
+            if (it != dialed.end() && it->second == conn) {
+                dialed.erase(it);
+            }
+        }
+        // A peer that comes back (e.g. restarted) may bring a new key
+        int peerId = conn->peerId;
+        if (conn->state == HandshakeState::ESTABLISHED && !connections.findPeer(peerId)) {
+            verifier->removeKey(peerId);
+        }
     }
+}
 
-    void handleWelcome(PendingConnection& pending) {
-        // Connection established
-        pending.state = HandshakeState::ESTABLISHED;
+// Past the handshake a connection only speaks for the peer it authenticated:
+// anything naming another sender is dropped.
+void NetworkManager::processPeerMessage(PendingConnection& pending, const Json::Value& root) {
+    Handshake hs;
+    if (handshakeFromJson(root, hs)) {
+        handleHandshake(pending, hs);
+        return;
+    }
+    std::string type = root["type"].asString();
+    if (ConsensusMessage::isConsensusType(type)) {
+        Table* t = findTable(root["table"].asUInt());
+        ConsensusMessage msg;
+        if (t && ConsensusMessage::fromJson(root, msg) && msg.sender == pending.peerId) {
+            deliverConsensus(pending, *t, std::move(msg));
+        }
     }
+}
 
-    void removePeerConnection(int socket) {
-        close(socket);
-        // Remove from active connections if present
-        for (auto it = pendingConnections.begin(); it != pendingConnections.end();) {
-            if (it->second.socket == socket) {
-                it = pendingConnections.erase(it);
-            } else {
-                ++it;
+void NetworkManager::processPeerFrame(PendingConnection& pending, const wire::FrameView& frame) {
+    if (frame.type == wire::MessageType::HELLO || frame.type == wire::MessageType::WELCOME ||
+        frame.type == wire::MessageType::AUTH) {
+        handleHandshake(pending, handshakeFromFrame(frame));
+        return;
+    }
+    if (frame.sender != pending.peerId) {
+        METRIC_COUNT(FRAMES_MALFORMED);
+        return;
+    }
+    if (frame.isProbe()) {
+        Probe probe;
+        frame.toProbe(probe);
+        failureDetector.onProbe(frame.sender, probe);
+        return;
+    }
+    if (frame.gossipCount > 0) {
+        std::vector<MemberUpdate> updates;
+        frame.memberUpdates(updates);
+        failureDetector.onUpdates(updates);
+    }
+    Table* t = findTable(frame.table);
+    if (!t) {
+        return;
+    }
+    if (frame.isConsensus()) {
+        ConsensusMessage msg;
+        if (frame.toConsensusMessage(msg)) {
+            deliverConsensus(pending, *t, std::move(msg));
+        }
+        return;
+    }
+    switch (frame.type) {
+        case wire::MessageType::SYNC: {
+            ConnectionTable::Ptr conn = connections.find(pending.socket);
+            if (conn) {
+                startStateStream(conn, *t, frame.height);
+            }
+            break;
+        }
+        // State transfer is only taken from the peer it was asked of
+        case wire::MessageType::STATE:
+            if (extendSync(*t, frame.sender)) {
+                receiveStateChunk(pending, *t, frame);
+            }
+            break;
+        // Behind a snapshot still being checked, so only the stale are dropped here
+        case wire::MessageType::DECIDED: {
+            ConsensusMessage msg;
+            if (extendSync(*t, frame.sender) && frame.toConsensusMessage(msg) &&
+                msg.height >= t->consensus.committedHeight()) {
+                verifier->submitCertificate(std::move(msg), [t](ConsensusMessage& checked) {
+                    t->consensus.adoptDecided(checked);
+                });
             }
+            break;
         }
+        default:
+            break;
     }
+}
+
+void NetworkManager::scheduleAfter(std::chrono::milliseconds delay, std::function<void()> fn) {
+    timers.schedule(delay, std::move(fn));
+}
 
-    void removePendingConnection(int socket) {
-        close(socket);
-        pendingConnections.erase(socket);
+void NetworkManager::onCommitted(Table& t, const ConsensusMessage& decided) {
+    uint64_t height = decided.height;
+    const std::vector<CommitEntry>& entries = decided.entries;
+    if (t.id == DEFAULT_TABLE) {
+        std::cout << "Committed height " << height << " (" << entries.size() << " actions)" << std::endl;
+    } else {
+        std::cout << "Committed height " << height << " (" << entries.size() << " actions) in "
+                  << t.roomId << std::endl;
+    }
+    // The flusher makes this durable in the background; peers hold the same
+    // decision, so a crash inside that window loses nothing the table needs
+    if (t.gameLog) {
+        t.gameLog->append(decided);
+    }
+    if (t.tableState.apply(decided)) {
+        checkpointLog(t);
+    }
+    if (t.commitHandler) {
+        t.commitHandler(height, entries);
     }
+}
 
-public:
-    NetworkManager::NetworkManager(MembershipList& list, 
-                             const std::string& id,
-                             const std::string& host, 
-                             int port,
-                             int nid)
-    : membershipList(list),
-      clientId(id),
-      serverHost(host),
-      serverPort(port),
-      serverSocket(-1),
-      connected(false),
-      nodeId(nid),
-      io_context(),
-      acceptor(io_context) {
-    setupAsyncListener();
+// Asks one peer at a time for the heights this node is missing; another
+// peer is tried only once that transfer has gone quiet.
+void NetworkManager::requestStateIfBehind(Table& t, PendingConnection& pending, uint64_t peerHeight) {
+    uint64_t have = t.consensus.committedHeight();
+    if (peerHeight <= have) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(t.syncMtx);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (t.syncPeer >= 0 && now < t.syncDeadline) {
+            return;
+        }
+        t.syncPeer = pending.peerId;
+        t.syncDeadline = now + SYNC_TIMEOUT;
+    }
+    std::cout << "Requesting state of " << t.roomId << " from peer " << pending.peerId.load()
+              << " (heights " << have << ".." << peerHeight - 1 << ")" << std::endl;
+    std::string body;
+    wire::encodeSync(body, nodeId, have);
+    wire::tagTable(body, t.id);
+    pending.sendQueue->enqueue(std::move(body));
 }
 
-NetworkManager::~NetworkManager() {
-    if (connected) {
-        close(serverSocket);
+bool NetworkManager::extendSync(Table& t, int peerId) {
+    std::lock_guard<std::mutex> lock(t.syncMtx);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (t.syncPeer != peerId || now >= t.syncDeadline) {
+        return false;
     }
+    t.syncDeadline = now + SYNC_TIMEOUT;
+    return true;
 }
 
-void NetworkManager::start() {
-    if (!connectToServer()) {
-        std::cerr << "Failed to connect to server" << std::endl;
+void NetworkManager::startStateStream(ConnectionTable::Ptr conn, Table& t, uint64_t from) {
+    auto stream = std::make_shared<StateStream>();
+    stream->next = from;
+    uint64_t height;
+    TableState::Bytes snapshot = t.tableState.checkpoint(height);
+    if (from < height) {
+        stream->snapshot = std::move(snapshot);
+        stream->snapshotHeight = height;
+        stream->next = height;
+    }
+    pumpState(conn, t, stream);
+}
+
+// Sends at most STATE_BURST bytes per call and re-posts itself, so a large
+// snapshot never holds the strand (or an io thread) for long, and waits
+// while the peer's queue holds more than STATE_WINDOW.
+void NetworkManager::pumpState(ConnectionTable::Ptr conn, Table& t, std::shared_ptr<StateStream> stream) {
+    if (connections.find(conn->socket) != conn) {
+        return;
+    }
+    Table* tp = &t;
+    if (conn->sendQueue->queuedBytes() > STATE_WINDOW) {
+        scheduleAfter(std::chrono::milliseconds(1), [this, conn, tp, stream]() {
+            boost::asio::post(conn->stream->get_executor(),
+                              [this, conn, tp, stream]() { pumpState(conn, *tp, stream); });
+        });
+        return;
+    }
+
+    size_t sent = 0;
+    while (sent < STATE_BURST) {
+        std::string body;
+        if (stream->snapshot) {
+            const std::string& bytes = *stream->snapshot;
+            wire::StateChunkView chunk;
+            chunk.offset = static_cast<uint32_t>(stream->offset);
+            chunk.total = static_cast<uint32_t>(bytes.size());
+            chunk.data = std::string_view(bytes).substr(stream->offset, STATE_CHUNK);
+            wire::encodeState(body, nodeId, stream->snapshotHeight, chunk);
+            wire::tagTable(body, t.id);
+            stream->offset += chunk.data.size();
+            if (stream->offset == bytes.size()) {
+                stream->snapshot.reset();
+            }
+        } else {
+            std::vector<TableState::Delta> batch;
+            if (!t.tableState.deltasFrom(stream->next, STATE_BURST - sent, batch)) {
+                // A checkpoint was taken past this peer: send that instead
+                stream->snapshot = t.tableState.checkpoint(stream->snapshotHeight);
+                stream->offset = 0;
+                stream->next = stream->snapshotHeight;
+                continue;
+            }
+            if (batch.empty()) {
+                return;   // caught up; live consensus takes over
+            }
+            for (const auto& delta : batch) {
+                ConsensusMessage msg;
+                msg.type = ConsensusMessageType::COMMIT;
+                msg.height = delta.height;
+                msg.round = delta.round;
+                msg.validRound = delta.validRound;
+                msg.valueId = delta.valueId;
+                msg.parentId = delta.parentId;
+                msg.entries = delta.entries;
+                msg.certificate = delta.certificate;
+                wire::encodeDecided(body, nodeId, msg);
+                wire::tagTable(body, t.id);
+                stream->next = delta.height + 1;
+                sent += body.size();
+                conn->sendQueue->enqueue(std::move(body));
+                body.clear();
+            }
+            continue;
+        }
+        sent += body.size();
+        conn->sendQueue->enqueue(std::move(body));
+    }
+    boost::asio::post(conn->stream->get_executor(),
+                      [this, conn, tp, stream]() { pumpState(conn, *tp, stream); });
+}
+
+void NetworkManager::receiveStateChunk(PendingConnection& pending, Table& t, const wire::FrameView& frame) {
+    if (frame.state.total > TableSnapshot::MAX_ENCODED) {
+        METRIC_COUNT(FRAMES_MALFORMED);
+        pending.incomingState.erase(t.id);
+        return;
+    }
+    PendingConnection::IncomingState& in = pending.incomingState[t.id];
+    if (frame.state.offset == 0) {
+        in.buffer.clear();
+        in.height = frame.height;
+        in.total = frame.state.total;
+    }
+    if (frame.height != in.height || frame.state.total != in.total ||
+        frame.state.offset != in.buffer.size()) {
+        in.buffer.clear();   // out of sequence: wait for a fresh snapshot
+        return;
+    }
+    in.buffer.append(frame.state.data.data(), frame.state.data.size());
+    if (in.buffer.size() < frame.state.total) {
+        return;
+    }
+
+    auto snapshot = std::make_shared<TableSnapshot>();
+    bool ok = TableSnapshot::decode(in.buffer.data(), in.buffer.size(), *snapshot);
+    pending.incomingState.erase(t.id);
+    if (!ok || snapshot->nextHeight != frame.height || snapshot->nextHeight == 0) {
+        std::cerr << "Malformed table snapshot from peer " << frame.sender << std::endl;
         return;
     }
 
-    Json::Value joinMsg;
-    joinMsg["command"] = "JOIN";
-    joinMsg["room_id"] = "room1";
-    joinMsg["client_id"] = clientId;
-    
-    sendMessage(joinMsg.toStyledString());
-    
-    std::thread msgThread(&NetworkManager::handleServerMessages, this);
-    msgThread.detach();
+    // Installed once its certificate checks out, ahead of the heights the
+    // peer sends after it
+    ConsensusMessage cert;
+    cert.type = ConsensusMessageType::COMMIT;
+    cert.height = snapshot->nextHeight - 1;
+    cert.round = snapshot->round;
+    cert.valueId = snapshot->lastValueId;
+    cert.certificate = snapshot->certificate;
+    Table* tp = &t;
+    int peerId = frame.sender;
+    verifier->submitCertificate(std::move(cert), [this, tp, peerId, snapshot](ConsensusMessage& checked) {
+        if (!tp->consensus.certifiesSnapshot(checked, snapshot->validators)) {
+            std::cerr << "Table snapshot from peer " << peerId << " at height "
+                      << snapshot->nextHeight << " is not certified" << std::endl;
+            abandonSync(*tp, peerId);
+            return;
+        }
+        installSnapshot(*tp, *snapshot);
+    });
 }
 
-    std::string receivePeerMessage(int socket) {
-        uint32_t length;
-        recv(socket, &length, 4, MSG_WAITALL);
-        length = ntohl(length);
-        
-        std::vector<char> buffer(length);
-        recv(socket, buffer.data(), length, MSG_WAITALL);
-        return std::string(buffer.data(), length);
+// Lets the next peer ahead of this node be asked for state straight away
+void NetworkManager::abandonSync(Table& t, int peerId) {
+    std::lock_guard<std::mutex> lock(t.syncMtx);
+    if (t.syncPeer == peerId) {
+        t.syncPeer = -1;
     }
+}
 
-    void processPeerMessage(int socket, const std::string& msg) {
-        // Add message processing logic
+void NetworkManager::installSnapshot(Table& t, const TableSnapshot& snapshot) {
+    if (snapshot.nextHeight <= t.consensus.committedHeight()) {
+        return;
+    }
+    t.tableState.install(snapshot);
+    if (t.gameLog) {
+        GameLog::Snapshot logSnapshot;
+        logSnapshot.height = snapshot.nextHeight - 1;
+        logSnapshot.lastValueId = snapshot.lastValueId;
+        snapshot.encode(logSnapshot.state);
+        t.gameLog->installSnapshot(logSnapshot);
     }
-};
\ No newline at end of file
+    t.consensus.restore(snapshot.nextHeight, snapshot.lastValueId, snapshot.committed,
+                        snapshot.validators);
+    std::cout << "Installed table snapshot at height " << snapshot.nextHeight << " ("
+              << snapshot.seats.size() << " seats, " << snapshot.deck.size() << " deck bytes)"
+              << std::endl;
+    if (t.stateHandler) {
+        t.stateHandler(snapshot);
+    }
+}
+
+void NetworkManager::scheduleMetricsLog() {
+    scheduleAfter(metricsInterval, [this]() {
+        if (metricsJson) {
+            std::cout << Json::FastWriter().write(metrics::toJson()) << std::flush;
+        } else {
+            std::cout << "-- metrics" << std::endl;
+            metrics::dumpText(std::cout);
+            std::cout << std::flush;
+        }
+        scheduleMetricsLog();
+    });
+}
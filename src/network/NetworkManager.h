@@ -1,25 +1,233 @@
 #pragma once
 #include "MembershipList.h"
+#include "Consensus.h"
+#include "WireCodec.h"
+#include "FrameDecoder.h"
+#include "SendQueue.h"
+#include "ConnectionTable.h"
+#include "IoPool.h"
+#include "TimerWheel.h"
+#include "GameLog.h"
+#include "TableState.h"
+#include "VoteVerifier.h"
+#include "FailureDetector.h"
+#include "Ed25519.h"
+#include "WorkerPool.h"
 #include <boost/asio.hpp>
+#include <json/json.h>
+#include <netinet/in.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 
+// Peer networking for every table this process hosts. The io pool, timers,
+// peer connections (one per remote host, whatever the number of tables two
+// hosts share), vote verifier and failure detector are shared; each table
+// keeps its own consensus, membership and decided state, and its frames
+// are tagged with its table id. A table is joined over a connection with a
+// HELLO / WELCOME of its own, the first of which also opens the connection.
 class NetworkManager {
+public:
+    static const uint32_t DEFAULT_TABLE = wire::DEFAULT_TABLE;
+
 private:
-    MembershipList& membershipList;
+    struct Table {
+        uint32_t id;
+        std::string roomId;
+        MembershipList& membershipList;
+        Consensus consensus;
+        Consensus::CommitFn commitHandler;
+        std::string gameLogDir;
+        std::unique_ptr<GameLog> gameLog;
+        TableState tableState;
+        std::function<void(const TableSnapshot&)> stateHandler;
+        std::mutex peersMtx;
+        std::set<int> peers;                          // hosts that joined this table
+        std::mutex syncMtx;
+        int syncPeer;                                 // peer we asked for state
+        std::chrono::steady_clock::time_point syncDeadline;
+
+        Table(NetworkManager& host, uint32_t id, const std::string& roomId, MembershipList& list);
+    };
+    using TableMap = std::map<uint32_t, std::unique_ptr<Table>>;
+
     std::string clientId;
     std::string serverHost;
     int serverPort;
+    int serverSocket;
+    std::atomic<bool> connected;
     int nodeId;
-    bool connected;
-    boost::asio::io_context io_context;
+    int peerPort;
+    wire::Format wireFormat;
+    size_t sendHighWaterMark;
+    std::recursive_mutex backpressureMtx;             // count and setBackpressure together
+    int congestedPeers;
+    std::chrono::seconds metricsInterval;
+    bool metricsJson;
+    IoPool ioPool;
+    TimerWheel timers;
     boost::asio::ip::tcp::acceptor acceptor;
+    ConnectionTable connections;
+    std::unique_ptr<Ed25519PrivateKey> signingKey;
+    std::map<int, std::string> peerKeys;              // known keys by node id; empty = any key
+    std::unique_ptr<WorkerPool> ownedWorkers;
+    WorkerPool* workers;                              // vote verification
+    FailureDetector failureDetector;
+    std::unique_ptr<VoteVerifier> verifier;           // built in start()
+    TableMap tables;                                  // fixed once start() runs
+    bool started;
+    std::deque<uint32_t> pendingJoins;                // tables whose JOIN awaits an answer
+    std::mutex dialMtx;
+    std::map<std::string, ConnectionTable::Ptr> dialed;   // outgoing connection per member address
+    std::thread serverThread;
+
+    // Outgoing state transfer to one peer: the checkpoint (if the peer is
+    // older than it), then every decided height from `next` on
+    struct StateStream {
+        TableState::Bytes snapshot;
+        uint64_t snapshotHeight = 0;
+        size_t offset = 0;
+        uint64_t next = 0;
+    };
+
+    bool connectToServer();
+    void handleServerMessages();
+    void setupAsyncListener();
+    void connectToPeer(const std::string& hostname, uint32_t table);
+
+    void sendMessage(int socket, const Json::Value& message);
+    // To the room server; false once the connection is gone
+    bool sendMessage(const std::string& message);
+    void sendFrame(int socket, const std::string& body);
+    std::string receiveMessage();
+    void sendHandshake(PendingConnection& pending, wire::MessageType type, Table& table,
+                       const std::string& signature = std::string());
+    void sendAuth(PendingConnection& pending, const std::string& signature);
+    std::string encodeConsensus(const Table& table, const ConsensusMessage& msg);
+    void broadcastConsensus(Table& table, const ConsensusMessage& msg);
+    void sendConsensusTo(Table& table, int peerId, const ConsensusMessage& msg);
+    void deliverConsensus(PendingConnection& pending, Table& table, ConsensusMessage msg);
+    void sendProbe(int peerId, const Probe& probe);
+
+    Table& table(uint32_t id) const;
+    Table* findTable(uint32_t id) const;
+    void joinTable(Table& table, int peerId);
+    void onMemberState(int peerId, bool alive);
+
+    ConnectionTable::Ptr registerConnection(std::shared_ptr<boost::asio::ip::tcp::socket> socket,
+                                            bool outgoing);
+    void startAccept();
+    void startRead(ConnectionTable::Ptr conn);
+    void handlePendingConnection(PendingConnection& pending, const char* data, size_t len);
+    void handleFrame(PendingConnection& pending, const wire::FrameView& frame);
+    // HELLO / WELCOME / AUTH, decoded from either format
+    struct Handshake {
+        wire::MessageType type;
+        uint32_t table = DEFAULT_TABLE;
+        int peerId = -1;
+        uint64_t height = 0;
+        int round = 0;
+        std::string publicKey;
+        std::string nonce;
+        std::string signature;
+    };
+
+    static bool handshakeFromJson(const Json::Value& root, Handshake& hs);
+    // Copies out of the frame; a handshake comes once per connection and table
+    static Handshake handshakeFromFrame(const wire::FrameView& frame);
+    bool acceptsPeerKey(int peerId, const std::string& publicKey) const;
+    bool bindPeerKey(PendingConnection& pending, int peerId, const std::string& publicKey);
+    void handleHandshake(PendingConnection& pending, const Handshake& hs);
+    void handleHello(PendingConnection& pending, const Handshake& hs);
+    void handleWelcome(PendingConnection& pending, const Handshake& hs);
+    void handleAuth(PendingConnection& pending, const Handshake& hs);
+    void enterTable(PendingConnection& pending, uint32_t tableId, uint64_t peerHeight);
+    void markEstablished(PendingConnection& pending, int peerId);
+    void expireHandshake(std::weak_ptr<PendingConnection> weak);
+    void removePendingConnection(int socket);
+    void processPeerMessage(PendingConnection& pending, const Json::Value& root);
+    void processPeerFrame(PendingConnection& pending, const wire::FrameView& frame);
+
+    void scheduleAfter(std::chrono::milliseconds delay, std::function<void()> fn);
+    void onCommitted(Table& table, const ConsensusMessage& decided);
+    void scheduleMetricsLog();
+    void recoverFromLog(Table& table);
+    void checkpointLog(Table& table);
+
+    void requestStateIfBehind(Table& table, PendingConnection& pending, uint64_t peerHeight);
+    // Whether peerId is the peer this table is syncing from and the
+    // transfer has not gone quiet; if so, gives it another SYNC_TIMEOUT
+    bool extendSync(Table& table, int peerId);
+    void abandonSync(Table& table, int peerId);
+    void startStateStream(ConnectionTable::Ptr conn, Table& table, uint64_t from);
+    void pumpState(ConnectionTable::Ptr conn, Table& table, std::shared_ptr<StateStream> stream);
+    void receiveStateChunk(PendingConnection& pending, Table& table, const wire::FrameView& frame);
+    void installSnapshot(Table& table, const TableSnapshot& snapshot);
 
 public:
-    NetworkManager(MembershipList& list, 
+    static const int PEER_PORT = 9000;
+
+    NetworkManager(MembershipList& list,
                   const std::string& id,
-                  const std::string& host, 
+                  const std::string& host,
                   int port = 8080,
                   int nid = 0);
     ~NetworkManager();
     void start();
-};
\ No newline at end of file
+
+    // Hosts another table on the same connections, io threads and workers;
+    // the constructor's list is DEFAULT_TABLE, playing in "room1". Tables
+    // are added before start(). The per-table calls below take the table
+    // id last and throw std::out_of_range for a table not hosted here.
+    void addTable(uint32_t tableId, const std::string& roomId, MembershipList& list);
+
+    // Hand a player action to the table; it is applied once decided.
+    void submitAction(const CommitEntry& entry, uint32_t table = DEFAULT_TABLE);
+    void setCommitHandler(Consensus::CommitFn handler, uint32_t table = DEFAULT_TABLE);
+    // Outgoing encoding; incoming frames are accepted in either format.
+    void setWireFormat(wire::Format format);
+    // Per-peer queued bytes at which new consensus proposals are held back.
+    void setSendHighWaterMark(size_t bytes);
+    // Number of io threads serving peer sockets (0 = one per core); set before start().
+    void setIoThreads(size_t threads);
+    // Port peers connect to (0 = any free port); set before start().
+    void setPeerPort(int port);
+    int listenPort() const;
+    // Identity: the 32-byte seed of this node's signing key (default: a
+    // fresh key per run), and the keys peers must prove they hold, by node
+    // id. With no peer keys any key is accepted, but still only from the
+    // peer that holds it. Set before start().
+    void setSigningKey(const std::string& seed);
+    void setPeerKeys(std::map<int, std::string> keys);
+    const std::string& publicKey() const { return signingKey->publicKey(); }
+    // Pool that checks vote signatures (default: one of our own, sized to the
+    // machine); set before start().
+    void setWorkerPool(WorkerPool& pool);
+    // Print the metrics dump every interval (0 = never); set before start().
+    void setMetricsLog(std::chrono::seconds interval, bool json = false);
+    // Record decided heights under dir and replay them on the next start();
+    // set before start(), with a directory of its own for every table.
+    void setGameLog(const std::string& dir, uint32_t table = DEFAULT_TABLE);
+    // Encrypted deck of the hand in progress, handed to nodes that join
+    // mid-hand.
+    void publishDeck(uint64_t handId, uint16_t cardBytes, std::string deck,
+                     uint32_t table = DEFAULT_TABLE);
+    // Called after a snapshot from a peer replaced the table state; later
+    // heights arrive through the commit handler as usual.
+    void setStateHandler(std::function<void(const TableSnapshot&)> handler,
+                         uint32_t table = DEFAULT_TABLE);
+    TableSnapshot tableSnapshot(uint32_t table = DEFAULT_TABLE) const;
+    // Who validates the table's next height. Connecting to a peer or losing
+    // one changes it only once the table has decided so and the change has
+    // taken effect.
+    std::vector<int> validators(uint32_t table = DEFAULT_TABLE) const;
+    SendStats sendStats();
+    size_t connectionCount() const { return connections.size(); }
+};
@@ -0,0 +1,169 @@
+// src/network/SendQueue.cpp
+#include "SendQueue.h"
+#include "Metrics.h"
+#include <arpa/inet.h>
+#include <algorithm>
+
+SendQueue::SendQueue(std::shared_ptr<boost::asio::ip::tcp::socket> sock,
+                     size_t highWaterMark,
+                     WatermarkFn watermarkFn)
+    : socket(std::move(sock)),
+      highWater(highWaterMark),
+      onWatermark(std::move(watermarkFn)),
+      queued(0),
+      writing(false),
+      closed(false),
+      isCongested(false),
+      inflightBytes(0),
+      statBytes(0),
+      statFrames(0),
+      statSyscalls(0),
+      statFlushes(0) {}
+
+void SendQueue::enqueue(Body body) {
+    bool startWrite = false;
+    bool crossed = false;
+    size_t depth;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (closed) {
+            return;
+        }
+        Frame frame;
+        frame.lengthPrefix = htonl(static_cast<uint32_t>(body->size()));
+        queued += 4 + body->size();
+        frame.body = std::move(body);
+        pending.push_back(std::move(frame));
+        depth = queued;
+
+        if (!isCongested && queued >= highWater) {
+            isCongested = true;
+            crossed = true;
+        }
+        if (!writing) {
+            writing = true;
+            startWrite = true;
+        }
+    }
+    METRIC_RECORD(metrics::SEND_QUEUE_BYTES, depth);
+    if (crossed && onWatermark) {
+        onWatermark(true);
+    }
+    if (startWrite) {
+        auto self = shared_from_this();
+        boost::asio::post(socket->get_executor(), [self]() { self->flush(); });
+    }
+}
+
+void SendQueue::close() {
+    bool wasCongested;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        pending.clear();
+        queued = 0;
+        wasCongested = isCongested;
+        isCongested = false;
+    }
+    if (wasCongested && onWatermark) {
+        onWatermark(false);
+    }
+}
+
+size_t SendQueue::queuedBytes() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return queued;
+}
+
+bool SendQueue::congested() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return isCongested;
+}
+
+SendStats SendQueue::stats() const {
+    SendStats s;
+    s.bytes = statBytes.load(std::memory_order_relaxed);
+    s.frames = statFrames.load(std::memory_order_relaxed);
+    s.syscalls = statSyscalls.load(std::memory_order_relaxed);
+    s.flushes = statFlushes.load(std::memory_order_relaxed);
+    return s;
+}
+
+// Takes everything queued so far (up to MAX_BATCH_FRAMES) as one batch.
+void SendQueue::flush() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (closed) {
+            writing = false;
+            return;
+        }
+        while (!pending.empty() && inflight.size() < MAX_BATCH_FRAMES) {
+            inflight.push_back(std::move(pending.front()));
+            pending.pop_front();
+        }
+        if (inflight.empty()) {
+            writing = false;
+            return;
+        }
+    }
+
+    buffers.clear();
+    inflightBytes = 0;
+    for (const auto& frame : inflight) {
+        buffers.push_back(boost::asio::buffer(&frame.lengthPrefix, 4));
+        buffers.push_back(boost::asio::buffer(*frame.body));
+        inflightBytes += 4 + frame.body->size();
+    }
+    statFlushes.fetch_add(1, std::memory_order_relaxed);
+    writeSome();
+}
+
+void SendQueue::writeSome() {
+    auto self = shared_from_this();
+    socket->async_write_some(buffers,
+        [self](const boost::system::error_code& error, size_t bytes) {
+            self->onWritten(error, bytes);
+        });
+}
+
+void SendQueue::onWritten(const boost::system::error_code& error, size_t bytes) {
+    if (error) {
+        inflight.clear();
+        buffers.clear();
+        close();
+        std::lock_guard<std::mutex> lock(mtx);
+        writing = false;
+        return;
+    }
+    statSyscalls.fetch_add(1, std::memory_order_relaxed);
+    statBytes.fetch_add(bytes, std::memory_order_relaxed);
+
+    // Short write: drop what went out and send the rest of the batch
+    size_t consumed = 0;
+    while (consumed < buffers.size() && bytes >= buffers[consumed].size()) {
+        bytes -= buffers[consumed].size();
+        consumed++;
+    }
+    if (consumed < buffers.size()) {
+        buffers.erase(buffers.begin(), buffers.begin() + consumed);
+        buffers[0] += bytes;
+        writeSome();
+        return;
+    }
+
+    statFrames.fetch_add(inflight.size(), std::memory_order_relaxed);
+    inflight.clear();
+    bool relieved = false;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        queued -= std::min(queued, inflightBytes);
+        if (isCongested && queued <= highWater / 2) {
+            isCongested = false;
+            relieved = true;
+        }
+    }
+    if (relieved && onWatermark) {
+        onWatermark(false);
+    }
+    flush();
+}
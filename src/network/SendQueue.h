@@ -0,0 +1,86 @@
+// src/network/SendQueue.h
+#pragma once
+#include <boost/asio.hpp>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct SendStats {
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    uint64_t syscalls = 0;   // completed write_some calls
+    uint64_t flushes = 0;    // coalesced batches handed to the socket
+
+    SendStats& operator+=(const SendStats& other) {
+        bytes += other.bytes;
+        frames += other.frames;
+        syscalls += other.syscalls;
+        flushes += other.flushes;
+        return *this;
+    }
+};
+
+// Outbound frames for one peer. Callers on any thread enqueue finished frame
+// bodies; the writes themselves run on the socket's executor, one batch at a
+// time, with every queued length prefix and body gathered into a single
+// write_some (writev). Bodies are shared so a broadcast encodes once for all
+// peers.
+class SendQueue : public std::enable_shared_from_this<SendQueue> {
+public:
+    using Body = std::shared_ptr<const std::string>;
+    // Called with true when queued bytes reach the high-water mark and with
+    // false once they fall back to half of it.
+    using WatermarkFn = std::function<void(bool congested)>;
+
+    static const size_t DEFAULT_HIGH_WATER = 1024 * 1024;
+    static const size_t MAX_BATCH_FRAMES = 64;
+
+    SendQueue(std::shared_ptr<boost::asio::ip::tcp::socket> socket,
+              size_t highWaterMark = DEFAULT_HIGH_WATER,
+              WatermarkFn onWatermark = WatermarkFn());
+
+    void enqueue(Body body);
+    void enqueue(std::string body) { enqueue(std::make_shared<const std::string>(std::move(body))); }
+    void close();
+
+    size_t queuedBytes() const;
+    bool congested() const;
+    SendStats stats() const;
+
+private:
+    struct Frame {
+        uint32_t lengthPrefix;   // network byte order
+        Body body;
+    };
+
+    void flush();
+    void writeSome();
+    void onWritten(const boost::system::error_code& error, size_t bytes);
+    void setCongested(bool value);
+
+    std::shared_ptr<boost::asio::ip::tcp::socket> socket;
+    size_t highWater;
+    WatermarkFn onWatermark;
+
+    mutable std::mutex mtx;
+    std::deque<Frame> pending;
+    size_t queued;
+    bool writing;
+    bool closed;
+    bool isCongested;
+
+    // Owned by the batch in flight; only touched from the write handlers
+    std::vector<Frame> inflight;
+    std::vector<boost::asio::const_buffer> buffers;
+    size_t inflightBytes;
+
+    std::atomic<uint64_t> statBytes;
+    std::atomic<uint64_t> statFrames;
+    std::atomic<uint64_t> statSyscalls;
+    std::atomic<uint64_t> statFlushes;
+};
@@ -0,0 +1,308 @@
+// src/network/TableState.cpp
+#include "TableState.h"
+#include "WireCodec.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+
+// 1: no validator schedule, 2: no committed keys, 3: every committed key,
+// 4: no certificate
+const uint8_t SNAPSHOT_VERSION = 5;
+
+void encodeSeqs(wire::Writer& w, const std::map<int, uint64_t>& highest,
+                const CommittedEntries::Changes& changes) {
+    if (highest.size() > UINT16_MAX || changes.size() > UINT16_MAX) {
+        throw std::length_error("too many committed entries for a snapshot");
+    }
+    w.u16(static_cast<uint16_t>(highest.size()));
+    for (const auto& player : highest) {
+        w.i32(player.first);
+        w.u64(player.second);
+    }
+    w.u16(static_cast<uint16_t>(changes.size()));
+    for (const auto& change : changes) {
+        w.i32(change.first);
+        w.u64(change.second);
+    }
+}
+
+void decodeSeqs(wire::Reader& r, uint8_t version, CommittedEntries& out) {
+    if (version == 3) {
+        // "playerId:seq" strings
+        uint32_t keys = r.u32();
+        for (uint32_t i = 0; i < keys && r.ok(); i++) {
+            std::string key(r.bytes());
+            size_t colon = key.find(':');
+            if (colon != std::string::npos) {
+                out.add(std::atoi(key.c_str()), std::strtoull(key.c_str() + colon + 1, nullptr, 10));
+            }
+        }
+        return;
+    }
+    for (int pass = 0; pass < 2 && r.ok(); pass++) {
+        uint16_t n = r.u16();
+        for (uint16_t i = 0; i < n && r.ok(); i++) {
+            int playerId = r.i32();
+            out.add(playerId, r.u64());
+        }
+    }
+}
+
+size_t deltaSize(const TableState::Delta& delta) {
+    size_t n = 64 + delta.parentId.size() + delta.valueId.size();
+    for (const auto& entry : delta.entries) {
+        n += 24 + entry.action.size() + entry.phase.size();
+    }
+    for (const auto& vote : delta.certificate) {
+        n += 6 + vote.signature.size();
+    }
+    return n;
+}
+
+} // namespace
+
+// u8 version | u64 nextHeight | bytes lastValueId | u16 seats
+// (i32 playerId, u64 stack)* | u64 pot | u64 handId | u16 cardBytes |
+// u32 deck length | deck | u16 sets (u64 height, u16 count, i32 id*)* |
+// u16 players (i32 playerId, u64 highest seq)* |
+// u16 changes (i32 submitter, u64 seq)* | i32 round |
+// u16 votes (i32 sender, bytes signature)*
+void TableSnapshot::encode(std::string& out) const {
+    if (seats.size() > UINT16_MAX || validators.size() > UINT16_MAX) {
+        throw std::length_error("too many seats for a snapshot");
+    }
+    size_t start = out.size();
+    wire::Writer w(out);
+    w.u8(SNAPSHOT_VERSION);
+    w.u64(nextHeight);
+    w.bytes(lastValueId);
+    w.u16(static_cast<uint16_t>(seats.size()));
+    for (const auto& s : seats) {
+        w.i32(s.playerId);
+        w.u64(static_cast<uint64_t>(s.stack));
+    }
+    w.u64(static_cast<uint64_t>(pot));
+    w.u64(handId);
+    w.u16(cardBytes);
+    w.u32(static_cast<uint32_t>(deck.size()));
+    out.append(deck);
+    w.u16(static_cast<uint16_t>(validators.size()));
+    for (const auto& set : validators) {
+        if (set.second.size() > UINT16_MAX) {
+            throw std::length_error("too many validators for a snapshot");
+        }
+        w.u64(set.first);
+        w.u16(static_cast<uint16_t>(set.second.size()));
+        for (int id : set.second) {
+            w.i32(id);
+        }
+    }
+    encodeSeqs(w, committed.highest(), committed.changes());
+    if (certificate.size() > UINT16_MAX) {
+        throw std::length_error("too many signatures for a snapshot");
+    }
+    w.i32(round);
+    w.u16(static_cast<uint16_t>(certificate.size()));
+    for (const auto& vote : certificate) {
+        w.i32(vote.sender);
+        w.bytes(vote.signature);
+    }
+    if (out.size() - start > MAX_ENCODED) {
+        throw std::length_error("table snapshot over MAX_ENCODED");
+    }
+}
+
+bool TableSnapshot::decode(const char* data, size_t len, TableSnapshot& out) {
+    if (len > MAX_ENCODED) {
+        return false;
+    }
+    wire::Reader r(data, len);
+    uint8_t version = r.u8();
+    if (version == 0 || version > SNAPSHOT_VERSION) {
+        return false;
+    }
+    out.nextHeight = r.u64();
+    std::string_view id = r.bytes();
+    out.lastValueId.assign(id.data(), id.size());
+    uint16_t count = r.u16();
+    out.seats.clear();
+    for (uint16_t i = 0; i < count && r.ok(); i++) {
+        Seat s;
+        s.playerId = r.i32();
+        s.stack = static_cast<int64_t>(r.u64());
+        out.seats.push_back(s);
+    }
+    out.pot = static_cast<int64_t>(r.u64());
+    out.handId = r.u64();
+    out.cardBytes = r.u16();
+    std::string_view deck = r.raw(r.u32());
+    out.deck.assign(deck.data(), deck.size());
+    out.validators.clear();
+    uint16_t sets = version >= 2 ? r.u16() : 0;
+    for (uint16_t i = 0; i < sets && r.ok(); i++) {
+        std::vector<int>& ids = out.validators[r.u64()];
+        uint16_t n = r.u16();
+        for (uint16_t j = 0; j < n && r.ok(); j++) {
+            ids.push_back(r.i32());
+        }
+    }
+    out.committed = CommittedEntries();
+    if (version >= 3) {
+        decodeSeqs(r, version, out.committed);
+    }
+    out.committed.advance(out.nextHeight);
+    out.round = 0;
+    out.certificate.clear();
+    if (version >= 5) {
+        out.round = r.i32();
+        uint16_t votes = r.u16();
+        for (uint16_t i = 0; i < votes && r.ok(); i++) {
+            VoteSignature vote;
+            vote.sender = r.i32();
+            vote.signature = std::string(r.bytes());
+            out.certificate.push_back(std::move(vote));
+        }
+    }
+    return r.ok() && r.atEnd() && (out.cardBytes == 0 || out.deck.size() % out.cardBytes == 0);
+}
+
+TableState::TableState(int64_t stack) : startingStack(stack), checkpointHeight(0) {
+    takeCheckpoint();
+}
+
+Seat& TableState::seat(int32_t playerId) {
+    auto it = std::lower_bound(state.seats.begin(), state.seats.end(), playerId,
+                               [](const Seat& s, int32_t id) { return s.playerId < id; });
+    if (it == state.seats.end() || it->playerId != playerId) {
+        Seat s;
+        s.playerId = playerId;
+        s.stack = startingStack;
+        it = state.seats.insert(it, s);
+    }
+    return *it;
+}
+
+bool TableState::apply(uint64_t height, const std::vector<CommitEntry>& entries) {
+    ConsensusMessage decided;
+    decided.type = ConsensusMessageType::COMMIT;
+    decided.height = height;
+    decided.entries = entries;
+    return apply(decided);
+}
+
+bool TableState::apply(const ConsensusMessage& decided) {
+    std::lock_guard<std::mutex> lock(mtx);
+    uint64_t height = decided.height;
+    const std::vector<CommitEntry>& entries = decided.entries;
+    if (height != state.nextHeight) {
+        return false;
+    }
+    Delta delta;
+    delta.height = height;
+    delta.parentId = state.lastValueId;
+    delta.valueId = Consensus::computeValueId(state.lastValueId, entries);
+    delta.validRound = decided.validRound;
+    delta.entries = entries;
+    delta.round = decided.round;
+    delta.certificate = decided.certificate;
+
+    bool handOver = false;
+    bool changes = false;
+    for (const auto& entry : entries) {
+        state.committed.add(entry);
+        if (ValidatorSchedule::isChange(entry)) {
+            changes = true;
+            continue;
+        }
+        Seat& s = seat(entry.playerId);
+        if (entry.action == "WIN") {
+            s.stack += state.pot;
+            state.pot = 0;
+            handOver = true;
+        } else {
+            s.stack -= entry.amount;
+            state.pot += entry.amount;
+        }
+    }
+    if (changes) {
+        ValidatorSchedule schedule(std::move(state.validators));
+        schedule.apply(height, entries);
+        schedule.prune(height);
+        state.validators = schedule.sets();
+    }
+    state.lastValueId = delta.valueId;
+    state.nextHeight++;
+    state.committed.advance(state.nextHeight);
+    state.round = decided.round;
+    state.certificate = decided.certificate;
+    deltas.push_back(std::move(delta));
+
+    if (handOver || state.nextHeight - checkpointHeight >= CHECKPOINT_INTERVAL) {
+        takeCheckpoint();
+        return true;
+    }
+    return false;
+}
+
+void TableState::setDeck(uint64_t handId, uint16_t cardBytes, std::string deck) {
+    std::lock_guard<std::mutex> lock(mtx);
+    state.handId = handId;
+    state.cardBytes = cardBytes;
+    state.deck = std::move(deck);
+    takeCheckpoint();
+}
+
+void TableState::install(const TableSnapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(mtx);
+    state = snapshot;
+    takeCheckpoint();
+}
+
+void TableState::checkpointNow() {
+    std::lock_guard<std::mutex> lock(mtx);
+    takeCheckpoint();
+}
+
+// Caller holds mtx
+void TableState::takeCheckpoint() {
+    auto bytes = std::make_shared<std::string>();
+    state.encode(*bytes);
+    checkpointBytes = std::move(bytes);
+    checkpointHeight = state.nextHeight;
+    deltas.clear();
+}
+
+TableSnapshot TableState::current() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return state;
+}
+
+uint64_t TableState::nextHeight() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return state.nextHeight;
+}
+
+TableState::Bytes TableState::checkpoint(uint64_t& height) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    height = checkpointHeight;
+    return checkpointBytes;
+}
+
+bool TableState::deltasFrom(uint64_t from, size_t maxBytes, std::vector<Delta>& out) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (from < checkpointHeight) {
+        return false;
+    }
+    size_t bytes = 0;
+    for (uint64_t h = from; h < state.nextHeight; h++) {
+        const Delta& delta = deltas[h - checkpointHeight];
+        if (!out.empty() && bytes + deltaSize(delta) > maxBytes) {
+            break;
+        }
+        bytes += deltaSize(delta);
+        out.push_back(delta);
+    }
+    return true;
+}
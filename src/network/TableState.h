@@ -0,0 +1,108 @@
+// src/network/TableState.h
+#pragma once
+#include "Consensus.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct Seat {
+    int32_t playerId = -1;
+    int64_t stack = 0;
+};
+
+// Everything a node needs to sit down at the table at nextHeight without
+// replaying the heights before it, and the precommits that decided
+// lastValueId at nextHeight - 1, so a receiver need not take the sender's
+// word for where the table stands.
+struct TableSnapshot {
+    // Encoded size limit, so a receiver can refuse a stream before buffering
+    // it. A real table (a few dozen seats, a 52-card deck of 256-byte cards,
+    // a handful of validator sets) needs well under 64 KiB.
+    static const size_t MAX_ENCODED = 4 * 1024 * 1024;
+
+    uint64_t nextHeight = 0;                      // first height not folded in
+    std::string lastValueId = Consensus::GENESIS_ID;
+    std::vector<Seat> seats;                      // by player id
+    int64_t pot = 0;
+    uint64_t handId = 0;
+    uint16_t cardBytes = 0;
+    std::string deck;                             // encrypted, cardBytes per card
+    ValidatorSchedule::Sets validators;           // from nextHeight - 1 on
+    CommittedEntries committed;                   // for the duplicate check
+    int32_t round = 0;                            // lastValueId was decided in
+    std::vector<VoteSignature> certificate;       // empty when not known
+
+    void encode(std::string& out) const;
+    static bool decode(const char* data, size_t len, TableSnapshot& out);
+};
+
+// Table state as folded from decided heights, kept in the form state
+// transfer sends it: a checkpoint snapshot plus the heights decided since,
+// each with the precommits that decided it.
+//
+// A committed entry moves `amount` chips from the player's stack into the
+// pot; a WIN entry hands the pot to its player and ends the hand. A player
+// is seated with the starting stack on their first entry. Membership
+// entries move no chips; they fold into the validator schedule.
+//
+// The checkpoint is re-taken at the end of every hand, whenever the deck
+// changes and every CHECKPOINT_INTERVAL heights, so a joiner never needs
+// more than one snapshot and that many deltas.
+class TableState {
+public:
+    static const int64_t DEFAULT_STACK = 1000;
+    static const uint64_t CHECKPOINT_INTERVAL = 64;
+
+    struct Delta {
+        uint64_t height;
+        std::string parentId;
+        std::string valueId;
+        int validRound = -1;
+        std::vector<CommitEntry> entries;
+        int round = 0;
+        std::vector<VoteSignature> certificate;
+    };
+
+    using Bytes = std::shared_ptr<const std::string>;
+
+    explicit TableState(int64_t startingStack = DEFAULT_STACK);
+
+    // Folds in the next decided height, a COMMIT as the consensus delivers
+    // it. Returns true when that took a new checkpoint.
+    bool apply(const ConsensusMessage& decided);
+    // As above for a height with no certificate to hand on (an old game log
+    // record); take a checkpoint before serving state past it.
+    bool apply(uint64_t height, const std::vector<CommitEntry>& entries);
+    // Deck for the hand in progress; takes a checkpoint.
+    void setDeck(uint64_t handId, uint16_t cardBytes, std::string deck);
+    // Replaces everything with a transferred or recovered snapshot.
+    void install(const TableSnapshot& snapshot);
+    // Folds the deltas so far into a new checkpoint
+    void checkpointNow();
+
+    TableSnapshot current() const;
+    uint64_t nextHeight() const;
+
+    // Encoded checkpoint and the height it stops before
+    Bytes checkpoint(uint64_t& height) const;
+    // Up to maxBytes (at least one) of deltas starting at `from`. Returns
+    // false when `from` is older than the checkpoint and a snapshot is
+    // needed first.
+    bool deltasFrom(uint64_t from, size_t maxBytes, std::vector<Delta>& out) const;
+
+private:
+    Seat& seat(int32_t playerId);
+    void takeCheckpoint();
+
+    int64_t startingStack;
+
+    mutable std::mutex mtx;
+    TableSnapshot state;
+    Bytes checkpointBytes;
+    uint64_t checkpointHeight;
+    std::deque<Delta> deltas;   // checkpointHeight .. state.nextHeight - 1
+};
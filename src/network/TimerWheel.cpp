@@ -0,0 +1,276 @@
+// src/network/TimerWheel.cpp
+#include "TimerWheel.h"
+#include <algorithm>
+
+namespace {
+
+const uint64_t SLOT_MASK = TimerWheel::SLOTS - 1;
+const uint64_t IDLE = UINT64_MAX;
+
+int lowestBit(uint64_t word) {
+    return __builtin_ctzll(word);
+}
+
+} // namespace
+
+TimerWheel::TimerWheel(boost::asio::io_context& context, std::chrono::milliseconds tick)
+    : io(context),
+      tickLength(std::chrono::duration_cast<std::chrono::steady_clock::duration>(tick)),
+      origin(std::chrono::steady_clock::now()),
+      driver(context),
+      armedTick(IDLE),
+      current(0),
+      freeList(NIL),
+      count(0),
+      stopped(false) {
+    for (auto& level : heads) {
+        level.fill(NIL);
+    }
+    for (auto& bits : occupied) {
+        bits.fill(0);
+    }
+}
+
+TimerWheel::~TimerWheel() {
+    stop();
+}
+
+TimerWheel::Handle TimerWheel::schedule(std::chrono::milliseconds delay, Callback fn) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Handle handle;
+    if (stopped) {
+        return handle;
+    }
+    // First tick boundary at or after now + delay
+    auto due = std::chrono::steady_clock::now() - origin +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay);
+    uint64_t expiry = static_cast<uint64_t>((due.count() + tickLength.count() - 1) / tickLength.count());
+
+    if (count == 0) {
+        // Nothing can be skipped over: bring an idle wheel up to date
+        current = std::max(current, nowTick());
+    }
+    expiry = std::max(expiry, current + 1);
+
+    uint32_t index = allocate();
+    Node& node = nodes[index];
+    node.expiry = expiry;
+    node.fn = std::move(fn);
+    node.live = true;
+    place(index);
+    count++;
+
+    handle.index = index;
+    handle.generation = node.generation;
+    if (nextWake() < armedTick) {
+        arm();
+    }
+    return handle;
+}
+
+bool TimerWheel::cancel(Handle handle) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (handle.index >= nodes.size()) {
+        return false;
+    }
+    Node& node = nodes[handle.index];
+    if (!node.live || node.generation != handle.generation) {
+        return false;
+    }
+    unlink(handle.index);
+    release(handle.index);
+    count--;
+    // The driver may now wake for nothing; it simply re-arms
+    return true;
+}
+
+size_t TimerWheel::pending() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return count;
+}
+
+void TimerWheel::stop() {
+    std::lock_guard<std::mutex> lock(mtx);
+    stopped = true;
+    boost::system::error_code ignored;
+    driver.cancel(ignored);
+    armedTick = IDLE;
+    nodes.clear();
+    freeList = NIL;
+    count = 0;
+    for (auto& level : heads) {
+        level.fill(NIL);
+    }
+    for (auto& bits : occupied) {
+        bits.fill(0);
+    }
+}
+
+uint64_t TimerWheel::nowTick() const {
+    return static_cast<uint64_t>((std::chrono::steady_clock::now() - origin) / tickLength);
+}
+
+uint32_t TimerWheel::allocate() {
+    if (freeList != NIL) {
+        uint32_t index = freeList;
+        freeList = nodes[index].next;
+        return index;
+    }
+    nodes.emplace_back();
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void TimerWheel::release(uint32_t index) {
+    Node& node = nodes[index];
+    node.live = false;
+    node.generation++;
+    node.fn = nullptr;
+    node.prev = NIL;
+    node.next = freeList;
+    freeList = index;
+}
+
+// The coarsest level whose slot span still separates expiry from now
+void TimerWheel::place(uint32_t index) {
+    Node& node = nodes[index];
+    uint64_t delta = node.expiry > current ? node.expiry - current : 0;
+    size_t level = 0;
+    while (level + 1 < LEVELS && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    size_t slot = (node.expiry >> (SLOT_BITS * level)) & SLOT_MASK;
+    node.level = static_cast<uint16_t>(level);
+    node.slot = static_cast<uint16_t>(slot);
+    node.prev = NIL;
+    node.next = heads[level][slot];
+    if (node.next != NIL) {
+        nodes[node.next].prev = index;
+    }
+    heads[level][slot] = index;
+    occupied[level][slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+void TimerWheel::unlink(uint32_t index) {
+    Node& node = nodes[index];
+    if (node.prev != NIL) {
+        nodes[node.prev].next = node.next;
+    } else {
+        heads[node.level][node.slot] = node.next;
+    }
+    if (node.next != NIL) {
+        nodes[node.next].prev = node.prev;
+    }
+    if (heads[node.level][node.slot] == NIL) {
+        occupied[node.level][node.slot / 64] &= ~(uint64_t(1) << (node.slot % 64));
+    }
+}
+
+// Re-files the slot of `level` that the wheel below just wrapped into
+void TimerWheel::cascade(size_t level) {
+    size_t slot = (current >> (SLOT_BITS * level)) & SLOT_MASK;
+    uint32_t index = heads[level][slot];
+    heads[level][slot] = NIL;
+    occupied[level][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    while (index != NIL) {
+        uint32_t next = nodes[index].next;
+        place(index);
+        index = next;
+    }
+}
+
+void TimerWheel::advance(uint64_t target, std::vector<Callback>& due) {
+    while (current < target) {
+        uint64_t next = current + 1;
+        if ((next & SLOT_MASK) != 0) {
+            // Jump over empty level-0 slots, but never past a wrap
+            int slot = nextOccupied(0, next & SLOT_MASK);
+            uint64_t stop = slot < 0 ? (current | SLOT_MASK) + 1 : (next & ~SLOT_MASK) + slot;
+            if (stop > target) {
+                current = target;
+                return;
+            }
+            next = stop;
+        }
+        current = next;
+        if ((current & SLOT_MASK) == 0) {
+            // Coarsest first, so timers land directly in the level they need
+            for (size_t level = LEVELS - 1; level >= 1; level--) {
+                if ((current & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) == 0) {
+                    cascade(level);
+                }
+            }
+        }
+        size_t slot = current & SLOT_MASK;
+        uint32_t index = heads[0][slot];
+        heads[0][slot] = NIL;
+        occupied[0][slot / 64] &= ~(uint64_t(1) << (slot % 64));
+        while (index != NIL) {
+            uint32_t following = nodes[index].next;
+            due.push_back(std::move(nodes[index].fn));
+            release(index);
+            count--;
+            index = following;
+        }
+    }
+}
+
+// First occupied slot of `level` at or after `from`, or -1
+int TimerWheel::nextOccupied(size_t level, size_t from) const {
+    const Bitmap& bits = occupied[level];
+    for (size_t word = from / 64; word < bits.size(); word++) {
+        uint64_t w = bits[word];
+        if (word == from / 64) {
+            w &= ~uint64_t(0) << (from % 64);
+        }
+        if (w != 0) {
+            return static_cast<int>(word * 64 + lowestBit(w));
+        }
+    }
+    return -1;
+}
+
+// Next tick with work: an occupied level-0 slot, else the next wrap (where
+// a higher level may cascade)
+uint64_t TimerWheel::nextWake() const {
+    if (count == 0) {
+        return IDLE;
+    }
+    uint64_t next = current + 1;
+    if ((next & SLOT_MASK) == 0) {
+        return next;
+    }
+    int slot = nextOccupied(0, next & SLOT_MASK);
+    return slot < 0 ? (current | SLOT_MASK) + 1 : (next & ~SLOT_MASK) + slot;
+}
+
+// Caller holds mtx
+void TimerWheel::arm() {
+    uint64_t wake = nextWake();
+    armedTick = wake;
+    if (wake == IDLE) {
+        boost::system::error_code ignored;
+        driver.cancel(ignored);
+        return;
+    }
+    driver.expires_at(origin + tickLength * static_cast<std::chrono::steady_clock::rep>(wake));
+    driver.async_wait([this](const boost::system::error_code& error) { onDriver(error); });
+}
+
+void TimerWheel::onDriver(const boost::system::error_code& error) {
+    if (error == boost::asio::error::operation_aborted) {
+        // Re-armed or stopped by whoever cancelled us
+        return;
+    }
+    std::vector<Callback> due;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopped) {
+            return;
+        }
+        advance(nowTick(), due);
+        arm();
+    }
+    for (auto& fn : due) {
+        boost::asio::post(io, std::move(fn));
+    }
+}
@@ -0,0 +1,96 @@
+// src/network/TimerWheel.h
+#pragma once
+#include <boost/asio.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Hierarchical timing wheel (Varghese & Lauck) for the protocol's many
+// short-lived timeouts: LEVELS wheels of SLOTS slots, each slot of level L
+// spanning SLOTS^L ticks, so with 1 ms ticks the wheels cover ~50 days.
+// A timer sits in the slot of the coarsest level its remaining time still
+// needs and drops a level each time the wheel below wraps.
+//
+// schedule() and cancel() are O(1): slots are intrusive lists over one node
+// pool, and a Handle names a node plus its generation, so cancelling a timer
+// that already fired (and whose node was reused) is a harmless no-op.
+//
+// One steady_timer on the io_context drives the wheel. It is armed for the
+// next occupied level-0 slot or the next wrap, never left ticking through
+// empty time, and catches up on every tick it slept through when it fires.
+// Expired callbacks are posted to the io_context, outside the wheel's lock.
+class TimerWheel {
+public:
+    using Callback = std::function<void()>;
+
+    static const size_t SLOT_BITS = 8;
+    static const size_t SLOTS = size_t(1) << SLOT_BITS;
+    static const size_t LEVELS = 4;
+
+    struct Handle {
+        uint32_t index = UINT32_MAX;
+        uint32_t generation = 0;
+        bool valid() const { return index != UINT32_MAX; }
+    };
+
+    explicit TimerWheel(boost::asio::io_context& io,
+                        std::chrono::milliseconds tick = std::chrono::milliseconds(1));
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // Runs fn no earlier than delay from now (rounded up to whole ticks)
+    Handle schedule(std::chrono::milliseconds delay, Callback fn);
+    // Returns false if the timer already fired or was cancelled
+    bool cancel(Handle handle);
+    size_t pending() const;
+    // Drops every pending timer and disarms the driver
+    void stop();
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+    using Bitmap = std::array<uint64_t, SLOTS / 64>;
+
+    struct Node {
+        uint64_t expiry = 0;       // absolute tick
+        uint32_t prev = NIL;
+        uint32_t next = NIL;
+        uint32_t generation = 0;
+        uint16_t level = 0;
+        uint16_t slot = 0;
+        bool live = false;
+        Callback fn;
+    };
+
+    uint64_t nowTick() const;
+    uint32_t allocate();
+    void release(uint32_t index);
+    void place(uint32_t index);
+    void unlink(uint32_t index);
+    void cascade(size_t level);
+    void advance(uint64_t target, std::vector<Callback>& due);
+    int nextOccupied(size_t level, size_t from) const;
+    uint64_t nextWake() const;
+    void arm();
+    void onDriver(const boost::system::error_code& error);
+
+    boost::asio::io_context& io;
+    std::chrono::steady_clock::duration tickLength;
+    std::chrono::steady_clock::time_point origin;
+
+    mutable std::mutex mtx;
+    boost::asio::steady_timer driver;
+    uint64_t armedTick;           // UINT64_MAX while idle
+    uint64_t current;             // last tick processed
+    std::vector<Node> nodes;
+    uint32_t freeList;
+    size_t count;
+    bool stopped;
+    std::array<std::array<uint32_t, SLOTS>, LEVELS> heads;
+    std::array<Bitmap, LEVELS> occupied;
+};
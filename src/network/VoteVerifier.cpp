@@ -0,0 +1,242 @@
+// src/network/VoteVerifier.cpp
+#include "VoteVerifier.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <chrono>
+
+VoteVerifier::VoteVerifier(WorkerPool& p, DeliverFn fn)
+    : pool(p),
+      deliver(std::move(fn)),
+      keys(std::make_shared<const KeyMap>()),
+      draining(false),
+      stopping(false) {}
+
+VoteVerifier::~VoteVerifier() {
+    std::unique_lock<std::mutex> lock(mtx);
+    stopping = true;
+    queue.clear();
+    queueTables.clear();
+    queueChecked.clear();
+    idle.wait(lock, [this] { return !draining; });
+}
+
+bool VoteVerifier::setKey(int nodeId, const std::string& raw) {
+    std::shared_ptr<const Ed25519PublicKey> key = Ed25519PublicKey::fromBytes(raw);
+    if (!key) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(keyMtx);
+    std::shared_ptr<const KeyMap> current = std::atomic_load(&keys);
+    auto it = current->find(nodeId);
+    if (it != current->end()) {
+        return it->second->bytes() == raw;
+    }
+    auto next = std::make_shared<KeyMap>(*current);
+    (*next)[nodeId] = std::move(key);
+    std::atomic_store(&keys, std::shared_ptr<const KeyMap>(std::move(next)));
+    return true;
+}
+
+void VoteVerifier::removeKey(int nodeId) {
+    std::lock_guard<std::mutex> lock(keyMtx);
+    std::shared_ptr<const KeyMap> current = std::atomic_load(&keys);
+    if (current->count(nodeId) == 0) {
+        return;
+    }
+    auto next = std::make_shared<KeyMap>(*current);
+    next->erase(nodeId);
+    std::atomic_store(&keys, std::shared_ptr<const KeyMap>(std::move(next)));
+}
+
+bool VoteVerifier::needsVerification(const ConsensusMessage& msg) {
+    return msg.isVote() || msg.type == ConsensusMessageType::PROPOSAL ||
+           msg.type == ConsensusMessageType::COMMIT;
+}
+
+void VoteVerifier::submit(uint32_t table, ConsensusMessage msg) {
+    enqueue(table, std::move(msg), CheckedFn());
+}
+
+void VoteVerifier::submitCertificate(ConsensusMessage msg, CheckedFn checked) {
+    enqueue(0, std::move(msg), std::move(checked));
+}
+
+void VoteVerifier::enqueue(uint32_t table, ConsensusMessage msg, CheckedFn checked) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (stopping) {
+        return;
+    }
+    queue.push_back(std::move(msg));
+    queueTables.push_back(table);
+    queueChecked.push_back(std::move(checked));
+    if (!draining) {
+        draining = true;
+        pool.post([this] { drain(); });
+    }
+}
+
+void VoteVerifier::drain() {
+    std::vector<ConsensusMessage> batch;
+    std::vector<uint32_t> tables;
+    std::vector<CheckedFn> callbacks;
+    std::vector<char> valid;
+    std::vector<size_t> checked;
+    std::vector<ConsensusMessage> run;
+    std::vector<uint32_t> runTables;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (queue.empty() || stopping) {
+                draining = false;
+                idle.notify_all();
+                return;
+            }
+            if (queue.size() <= MAX_BATCH) {
+                batch.swap(queue);
+                tables.swap(queueTables);
+                callbacks.swap(queueChecked);
+            } else {
+                batch.assign(std::make_move_iterator(queue.begin()),
+                             std::make_move_iterator(queue.begin() + MAX_BATCH));
+                queue.erase(queue.begin(), queue.begin() + MAX_BATCH);
+                tables.assign(queueTables.begin(), queueTables.begin() + MAX_BATCH);
+                queueTables.erase(queueTables.begin(), queueTables.begin() + MAX_BATCH);
+                callbacks.assign(std::make_move_iterator(queueChecked.begin()),
+                                 std::make_move_iterator(queueChecked.begin() + MAX_BATCH));
+                queueChecked.erase(queueChecked.begin(), queueChecked.begin() + MAX_BATCH);
+            }
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::shared_ptr<const KeyMap> snapshot = std::atomic_load(&keys);
+        valid.assign(batch.size(), 0);
+        checked.assign(batch.size(), 0);
+        auto check = [&](size_t i) {
+            bool ok = false;
+            checked[i] = verify(batch[i], *snapshot, ok);
+            valid[i] = ok;
+        };
+        if (batch.size() >= PARALLEL_MIN && pool.size() > 1) {
+            pool.parallelFor(batch.size(), check);
+        } else {
+            for (size_t i = 0; i < batch.size(); i++) {
+                check(i);
+            }
+        }
+
+        // A certificate with a callback is kept whatever is left of it
+        size_t signatures = 0;
+        size_t kept = 0;
+        bool anyCallback = false;
+        for (size_t i = 0; i < batch.size(); i++) {
+            signatures += checked[i];
+            if (valid[i]) {
+                METRIC_COUNT(VOTES_VERIFIED);
+            } else {
+                METRIC_COUNT(VOTES_REJECTED);
+            }
+            if (valid[i] || callbacks[i]) {
+                if (kept != i) {
+                    batch[kept] = std::move(batch[i]);
+                    tables[kept] = tables[i];
+                    callbacks[kept] = std::move(callbacks[i]);
+                }
+                anyCallback |= static_cast<bool>(callbacks[kept]);
+                kept++;
+            }
+        }
+        batch.resize(kept);
+        tables.resize(kept);
+        callbacks.resize(kept);
+        METRIC_SINCE(metrics::VERIFY_NS, start);
+        METRIC_RECORD(metrics::VERIFY_BATCH, signatures);
+
+        if (!anyCallback) {
+            deliverByTable(batch, tables);
+            callbacks.clear();
+            continue;
+        }
+        // Callbacks cut the batch into runs, so each one comes after
+        // everything queued before it has been delivered
+        size_t from = 0;
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (!callbacks[i]) {
+                continue;
+            }
+            run.assign(std::make_move_iterator(batch.begin() + from),
+                       std::make_move_iterator(batch.begin() + i));
+            runTables.assign(tables.begin() + from, tables.begin() + i);
+            deliverByTable(run, runTables);
+            callbacks[i](batch[i]);
+            from = i + 1;
+        }
+        run.assign(std::make_move_iterator(batch.begin() + from), std::make_move_iterator(batch.end()));
+        runTables.assign(tables.begin() + from, tables.end());
+        deliverByTable(run, runTables);
+        batch.clear();
+        tables.clear();
+        callbacks.clear();
+    }
+}
+
+// One call per table, each in arrival order; almost always just one
+void VoteVerifier::deliverByTable(std::vector<ConsensusMessage>& batch, std::vector<uint32_t>& tables) {
+    while (!batch.empty()) {
+        uint32_t table = tables.front();
+        if (std::all_of(tables.begin(), tables.end(), [table](uint32_t t) { return t == table; })) {
+            deliver(table, batch);
+            break;
+        }
+        std::vector<ConsensusMessage> mine;
+        size_t rest = 0;
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (tables[i] == table) {
+                mine.push_back(std::move(batch[i]));
+            } else {
+                if (rest != i) {
+                    batch[rest] = std::move(batch[i]);
+                    tables[rest] = tables[i];
+                }
+                rest++;
+            }
+        }
+        batch.resize(rest);
+        tables.resize(rest);
+        deliver(table, mine);
+    }
+    batch.clear();
+    tables.clear();
+}
+
+// Keeps only the precommits that are really from their sender
+void VoteVerifier::filterCertificate(ConsensusMessage& msg, const KeyMap& keys) {
+    size_t good = 0;
+    for (size_t i = 0; i < msg.certificate.size(); i++) {
+        const VoteSignature& vote = msg.certificate[i];
+        auto it = keys.find(vote.sender);
+        if (it == keys.end() ||
+            !it->second->verify(ConsensusMessage::voteBytes(ConsensusMessageType::PRECOMMIT,
+                                                            vote.sender, msg.height,
+                                                            msg.round, msg.valueId),
+                                vote.signature)) {
+            continue;
+        }
+        if (good != i) {
+            msg.certificate[good] = vote;
+        }
+        good++;
+    }
+    msg.certificate.resize(good);
+}
+
+size_t VoteVerifier::verify(ConsensusMessage& msg, const KeyMap& keys, bool& valid) const {
+    if (msg.type == ConsensusMessageType::COMMIT) {
+        size_t total = msg.certificate.size();
+        filterCertificate(msg, keys);
+        valid = !msg.certificate.empty();
+        return total;
+    }
+    auto it = keys.find(msg.sender);
+    valid = it != keys.end() && it->second->verify(msg.signedBytes(), msg.signature);
+    return 1;
+}
@@ -0,0 +1,93 @@
+// src/network/VoteVerifier.h
+#pragma once
+#include "Consensus.h"
+#include "Ed25519.h"
+#include "WorkerPool.h"
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Checks proposal and vote signatures off the io threads. Signed messages
+// queue up here and one drain task on the worker pool takes everything
+// queued so far, verifies it (in parallel once the batch is big enough to be
+// worth splitting) and hands the valid messages to each table's Consensus in
+// one call per table. Keys belong to hosts, so every table shares them.
+//
+// A PROPOSAL / PREVOTE / PRECOMMIT with a bad or missing signature is
+// dropped. A COMMIT keeps only the certificate signatures that check out;
+// whether what is left is still a quorum is for Consensus to decide.
+//
+// Certificates that state transfer hands over (decided heights, snapshots)
+// go through the same queue with a callback instead of a table, so they
+// leave the io threads too and are handed back in the order they arrived,
+// behind everything queued before them.
+//
+// Signatures are checked one at a time. Ed25519 batch verification (one
+// multi-scalar multiplication for the whole batch) would roughly halve the
+// cost per signature, but OpenSSL's EVP interface, which Ed25519.h wraps,
+// has no batch call, and a batch only says whether every signature in it is
+// good: one bad signature, which any faulty peer can send at will, forces
+// the whole batch to be checked again one by one. Splitting the batch
+// across the pool gets the speedup without that worst case.
+//
+// Keys come from the handshake, which has already checked that the peer
+// holds the private half; a node id keeps its key until the peer leaves.
+class VoteVerifier {
+public:
+    using DeliverFn = std::function<void(uint32_t table, const std::vector<ConsensusMessage>&)>;
+    using CheckedFn = std::function<void(ConsensusMessage& msg)>;
+
+    static const size_t PARALLEL_MIN = 8;   // smaller batches verify inline
+    static const size_t MAX_BATCH = 256;    // messages taken per drain step
+
+    VoteVerifier(WorkerPool& pool, DeliverFn deliver);
+    // Waits for a drain in progress
+    ~VoteVerifier();
+
+    VoteVerifier(const VoteVerifier&) = delete;
+    VoteVerifier& operator=(const VoteVerifier&) = delete;
+
+    // Returns false when raw is not a key or nodeId is already bound to a
+    // different one.
+    bool setKey(int nodeId, const std::string& raw);
+    void removeKey(int nodeId);
+
+    // Messages that must pass through submit() rather than going straight
+    // to Consensus
+    static bool needsVerification(const ConsensusMessage& msg);
+    void submit(uint32_t table, ConsensusMessage msg);
+    // Drops the certificate signatures of a COMMIT that do not verify and
+    // hands what is left to `checked` on a worker, after everything
+    // submitted before it has been delivered.
+    void submitCertificate(ConsensusMessage msg, CheckedFn checked);
+
+private:
+    using KeyMap = std::map<int, std::shared_ptr<const Ed25519PublicKey>>;
+
+    void enqueue(uint32_t table, ConsensusMessage msg, CheckedFn checked);
+    void drain();
+    // Delivers and clears batch, one call per table, each in arrival order
+    void deliverByTable(std::vector<ConsensusMessage>& batch, std::vector<uint32_t>& tables);
+    // Number of signatures checked
+    size_t verify(ConsensusMessage& msg, const KeyMap& keys, bool& valid) const;
+    static void filterCertificate(ConsensusMessage& msg, const KeyMap& keys);
+
+    WorkerPool& pool;
+    DeliverFn deliver;
+
+    std::mutex keyMtx;                      // serialises writers only
+    std::shared_ptr<const KeyMap> keys;     // read with atomic_load
+
+    std::mutex mtx;
+    std::condition_variable idle;
+    std::vector<ConsensusMessage> queue;
+    std::vector<uint32_t> queueTables;      // table of each queued message
+    std::vector<CheckedFn> queueChecked;    // callback of each, or empty
+    bool draining;
+    bool stopping;
+};
@@ -0,0 +1,539 @@
+// src/network/WireCodec.cpp
+#include "WireCodec.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace wire {
+
+namespace {
+
+void header(Writer& w, MessageType type, int32_t sender) {
+    w.u8(MAGIC);
+    w.u8(VERSION);
+    w.u8(static_cast<uint8_t>(type));
+    w.u8(0);
+    w.i32(sender);
+}
+
+void entry(Writer& w, const CommitEntry& e) {
+    w.i32(e.playerId);
+    w.u64(e.seq);
+    w.i32(e.amount);
+    w.bytes(e.action);
+    w.bytes(e.phase);
+}
+
+void entries(Writer& w, const std::vector<CommitEntry>& list) {
+    if (list.size() > UINT16_MAX) {
+        throw std::length_error("too many entries for one frame");
+    }
+    w.u16(static_cast<uint16_t>(list.size()));
+    for (const auto& e : list) {
+        entry(w, e);
+    }
+}
+
+void proposal(Writer& w, const ConsensusMessage& msg) {
+    w.u64(msg.height);
+    w.i32(msg.round);
+    w.i32(msg.validRound);
+    w.bytes(msg.valueId);
+    w.bytes(msg.parentId);
+    entries(w, msg.entries);
+}
+
+// COMMIT / DECIDED: the precommits after the proposal layout
+void certificate(Writer& w, const ConsensusMessage& msg) {
+    if (msg.certificate.size() > UINT16_MAX) {
+        throw std::length_error("too many signatures for one frame");
+    }
+    w.u16(static_cast<uint16_t>(msg.certificate.size()));
+    for (const auto& vote : msg.certificate) {
+        w.i32(vote.sender);
+        w.bytes(vote.signature);
+    }
+}
+
+// Flags the frame starting at `start` and appends the trailer
+void gossipTrailer(std::string& out, size_t start, const std::vector<MemberUpdate>& updates) {
+    if (updates.empty()) {
+        return;
+    }
+    size_t count = std::min<size_t>(updates.size(), UINT8_MAX);
+    out[start + 3] = static_cast<char>(static_cast<uint8_t>(out[start + 3]) | FLAG_GOSSIP);
+    Writer w(out);
+    w.u8(static_cast<uint8_t>(count));
+    for (size_t i = 0; i < count; i++) {
+        w.i32(updates[i].node);
+        w.u8(static_cast<uint8_t>(updates[i].state));
+        w.u32(updates[i].incarnation);
+    }
+    w.u16(static_cast<uint16_t>(1 + 9 * count));
+}
+
+bool skipEntries(Reader& r, uint16_t count) {
+    for (uint16_t i = 0; i < count && r.ok(); i++) {
+        r.raw(4 + 8 + 4);
+        r.bytes();
+        r.bytes();
+    }
+    return r.ok();
+}
+
+} // namespace
+
+bool isBinary(const char* data, size_t len) {
+    return len > 0 && static_cast<uint8_t>(data[0]) == MAGIC;
+}
+
+void Writer::u16(uint16_t v) {
+    u8(static_cast<uint8_t>(v >> 8));
+    u8(static_cast<uint8_t>(v));
+}
+
+void Writer::u32(uint32_t v) {
+    char b[4] = {
+        static_cast<char>(v >> 24), static_cast<char>(v >> 16),
+        static_cast<char>(v >> 8), static_cast<char>(v)
+    };
+    out.append(b, 4);
+}
+
+void Writer::u64(uint64_t v) {
+    u32(static_cast<uint32_t>(v >> 32));
+    u32(static_cast<uint32_t>(v));
+}
+
+void Writer::bytes(std::string_view v) {
+    if (v.size() > UINT16_MAX) {
+        throw std::length_error("field too long for wire frame");
+    }
+    u16(static_cast<uint16_t>(v.size()));
+    out.append(v.data(), v.size());
+}
+
+bool Reader::need(size_t n) {
+    if (!good || static_cast<size_t>(end - p) < n) {
+        good = false;
+        return false;
+    }
+    return true;
+}
+
+uint8_t Reader::u8() {
+    if (!need(1)) return 0;
+    return *p++;
+}
+
+uint16_t Reader::u16() {
+    if (!need(2)) return 0;
+    uint16_t v = static_cast<uint16_t>((p[0] << 8) | p[1]);
+    p += 2;
+    return v;
+}
+
+uint32_t Reader::u32() {
+    if (!need(4)) return 0;
+    uint32_t v = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                 (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    p += 4;
+    return v;
+}
+
+uint64_t Reader::u64() {
+    uint64_t hi = u32();
+    uint64_t lo = u32();
+    return (hi << 32) | lo;
+}
+
+std::string_view Reader::bytes() {
+    uint16_t len = u16();
+    return raw(len);
+}
+
+std::string_view Reader::raw(size_t len) {
+    if (!need(len)) return std::string_view();
+    std::string_view v(reinterpret_cast<const char*>(p), len);
+    p += len;
+    return v;
+}
+
+CommitEntry EntryView::toEntry() const {
+    CommitEntry e;
+    e.playerId = playerId;
+    e.seq = seq;
+    e.amount = amount;
+    e.action.assign(action.data(), action.size());
+    e.phase.assign(phase.data(), phase.size());
+    return e;
+}
+
+bool EntryCursor::next(EntryView& e) {
+    if (left == 0) {
+        return false;
+    }
+    e.playerId = reader.i32();
+    e.seq = reader.u64();
+    e.amount = reader.i32();
+    e.action = reader.bytes();
+    e.phase = reader.bytes();
+    if (!reader.ok()) {
+        left = 0;
+        return false;
+    }
+    left--;
+    return true;
+}
+
+bool FrameView::isProbe() const {
+    return type == MessageType::PING || type == MessageType::ACK || type == MessageType::PING_REQ;
+}
+
+bool FrameView::toProbe(Probe& out) const {
+    switch (type) {
+        case MessageType::PING: out.type = ProbeType::PING; break;
+        case MessageType::ACK: out.type = ProbeType::ACK; break;
+        case MessageType::PING_REQ: out.type = ProbeType::PING_REQ; break;
+        default: return false;
+    }
+    out.seq = probe.seq;
+    out.target = probe.target;
+    out.updates.clear();
+    memberUpdates(out.updates);
+    return true;
+}
+
+void FrameView::memberUpdates(std::vector<MemberUpdate>& out) const {
+    Reader r(gossipData.data(), gossipData.size());
+    r.u8();
+    for (uint8_t i = 0; i < gossipCount; i++) {
+        MemberUpdate update;
+        update.node = r.i32();
+        update.state = static_cast<MemberState>(r.u8());
+        update.incarnation = r.u32();
+        if (update.state <= MemberState::DEAD) {
+            out.push_back(update);
+        }
+    }
+}
+
+bool FrameView::isConsensus() const {
+    return type == MessageType::ACTION || type == MessageType::PROPOSAL ||
+           type == MessageType::PREVOTE || type == MessageType::PRECOMMIT ||
+           type == MessageType::COMMIT;
+}
+
+bool FrameView::toConsensusMessage(ConsensusMessage& out) const {
+    switch (type) {
+        case MessageType::ACTION: out.type = ConsensusMessageType::ACTION; break;
+        case MessageType::PROPOSAL: out.type = ConsensusMessageType::PROPOSAL; break;
+        case MessageType::PREVOTE: out.type = ConsensusMessageType::PREVOTE; break;
+        case MessageType::PRECOMMIT: out.type = ConsensusMessageType::PRECOMMIT; break;
+        case MessageType::COMMIT:
+        case MessageType::DECIDED: out.type = ConsensusMessageType::COMMIT; break;
+        default: return false;
+    }
+    out.sender = sender;
+    out.height = height;
+    out.round = round;
+    out.validRound = validRound;
+    out.valueId.assign(valueId.data(), valueId.size());
+    out.parentId.assign(parentId.data(), parentId.size());
+    out.signature.assign(signature.data(), signature.size());
+    out.entries.clear();
+    out.entries.reserve(entryCount);
+    EntryCursor cursor = entries();
+    EntryView e;
+    while (cursor.next(e)) {
+        out.entries.push_back(e.toEntry());
+    }
+    out.certificate.clear();
+    out.certificate.reserve(signatureCount);
+    Reader r(signatureData.data(), signatureData.size());
+    for (uint16_t i = 0; i < signatureCount; i++) {
+        VoteSignature vote;
+        vote.sender = r.i32();
+        std::string_view sig = r.bytes();
+        vote.signature.assign(sig.data(), sig.size());
+        out.certificate.push_back(std::move(vote));
+    }
+    return true;
+}
+
+bool decode(const char* data, size_t len, FrameView& out) {
+    Reader head(data, len);
+    if (head.u8() != MAGIC || head.u8() != VERSION) {
+        return false;
+    }
+    out.type = static_cast<MessageType>(head.u8());
+    out.flags = head.u8();
+    out.sender = head.i32();
+    if (!head.ok()) {
+        return false;
+    }
+
+    // Peel off the trailers, outermost first, so the payload parses on its own
+    out.table = DEFAULT_TABLE;
+    if (out.flags & FLAG_TABLE) {
+        if (len < HEADER_SIZE + 4) {
+            return false;
+        }
+        len -= 4;
+        Reader tail(data + len, 4);
+        out.table = tail.u32();
+    }
+    out.gossipCount = 0;
+    out.gossipData = std::string_view();
+    if (out.flags & FLAG_GOSSIP) {
+        if (len < HEADER_SIZE + 2) {
+            return false;
+        }
+        Reader tail(data + len - 2, 2);
+        size_t trailer = tail.u16();
+        if (trailer < 1 || trailer + 2 > len - HEADER_SIZE) {
+            return false;
+        }
+        len -= trailer + 2;
+        out.gossipData = std::string_view(data + len, trailer);
+        out.gossipCount = static_cast<uint8_t>(out.gossipData[0]);
+        if (trailer != 1 + 9 * static_cast<size_t>(out.gossipCount)) {
+            return false;
+        }
+    }
+
+    Reader r(data + HEADER_SIZE, len - HEADER_SIZE);
+    out.height = 0;
+    out.round = 0;
+    out.validRound = -1;
+    out.valueId = std::string_view();
+    out.parentId = std::string_view();
+    out.signature = std::string_view();
+    out.signatureCount = 0;
+    out.signatureData = std::string_view();
+    out.publicKey = std::string_view();
+    out.nonce = std::string_view();
+    out.entryCount = 0;
+    out.entryData = std::string_view();
+
+    switch (out.type) {
+        case MessageType::HELLO:
+        case MessageType::WELCOME:
+            if (!r.atEnd()) {
+                out.height = r.u64();
+                out.round = r.i32();
+            }
+            if (!r.atEnd()) {
+                out.publicKey = r.bytes();
+            }
+            if (!r.atEnd()) {
+                out.nonce = r.bytes();
+            }
+            if (out.type == MessageType::WELCOME && !r.atEnd()) {
+                out.signature = r.bytes();
+            }
+            break;
+
+        case MessageType::AUTH:
+            out.signature = r.bytes();
+            break;
+
+        case MessageType::SYNC:
+            out.height = r.u64();
+            break;
+
+        case MessageType::STATE:
+            out.height = r.u64();
+            out.state.offset = r.u32();
+            out.state.total = r.u32();
+            out.state.data = r.bytes();
+            if (r.ok() && (out.state.offset > out.state.total ||
+                           out.state.data.size() > out.state.total - out.state.offset)) {
+                return false;
+            }
+            break;
+
+        case MessageType::PREVOTE:
+        case MessageType::PRECOMMIT:
+            out.height = r.u64();
+            out.round = r.i32();
+            out.valueId = r.bytes();
+            if (!r.atEnd()) {
+                out.signature = r.bytes();
+            }
+            break;
+
+        case MessageType::PROPOSAL:
+        case MessageType::DECIDED:
+        case MessageType::COMMIT:
+            out.height = r.u64();
+            out.round = r.i32();
+            out.validRound = r.i32();
+            out.valueId = r.bytes();
+            out.parentId = r.bytes();
+            [[fallthrough]];
+        case MessageType::ACTION: {
+            out.entryCount = r.u16();
+            const char* start = r.position();
+            if (!skipEntries(r, out.entryCount)) {
+                return false;
+            }
+            out.entryData = std::string_view(start, r.position() - start);
+            if (out.type == MessageType::COMMIT || out.type == MessageType::DECIDED) {
+                out.signatureCount = r.u16();
+                start = r.position();
+                for (uint16_t i = 0; i < out.signatureCount && r.ok(); i++) {
+                    r.i32();
+                    r.bytes();
+                }
+                out.signatureData = std::string_view(start, r.position() - start);
+            } else if (out.type == MessageType::PROPOSAL && !r.atEnd()) {
+                out.signature = r.bytes();
+            }
+            break;
+        }
+
+        case MessageType::PING:
+        case MessageType::ACK:
+        case MessageType::PING_REQ:
+            out.probe.seq = r.u32();
+            out.probe.target = r.i32();
+            break;
+
+        case MessageType::CARDS:
+            out.cards.handId = r.u64();
+            out.cards.stage = r.u8();
+            out.cards.cardBytes = r.u16();
+            out.cards.count = r.u16();
+            out.cards.data = r.raw(static_cast<size_t>(out.cards.cardBytes) * out.cards.count);
+            break;
+
+        default:
+            return false;
+    }
+    // Anything left over means the frame is not what its type says
+    return r.ok() && r.atEnd() && out.round >= 0;
+}
+
+void encodeHello(std::string& out, int32_t nodeId, uint64_t height, std::string_view publicKey,
+                 std::string_view nonce) {
+    Writer w(out);
+    header(w, MessageType::HELLO, nodeId);
+    w.u64(height);
+    w.i32(0);
+    w.bytes(publicKey);
+    w.bytes(nonce);
+}
+
+void encodeWelcome(std::string& out, int32_t nodeId, uint64_t height, int32_t round,
+                   std::string_view publicKey, std::string_view nonce,
+                   std::string_view signature) {
+    Writer w(out);
+    header(w, MessageType::WELCOME, nodeId);
+    w.u64(height);
+    w.i32(round);
+    w.bytes(publicKey);
+    w.bytes(nonce);
+    w.bytes(signature);
+}
+
+void encodeAuth(std::string& out, int32_t nodeId, std::string_view signature) {
+    Writer w(out);
+    header(w, MessageType::AUTH, nodeId);
+    w.bytes(signature);
+}
+
+void encodeConsensus(std::string& out, const ConsensusMessage& msg) {
+    Writer w(out);
+    switch (msg.type) {
+        case ConsensusMessageType::ACTION:
+            header(w, MessageType::ACTION, msg.sender);
+            entries(w, msg.entries);
+            break;
+        case ConsensusMessageType::PROPOSAL:
+            header(w, MessageType::PROPOSAL, msg.sender);
+            proposal(w, msg);
+            w.bytes(msg.signature);
+            break;
+        case ConsensusMessageType::PREVOTE:
+        case ConsensusMessageType::PRECOMMIT:
+            header(w, msg.type == ConsensusMessageType::PREVOTE ? MessageType::PREVOTE
+                                                                : MessageType::PRECOMMIT,
+                   msg.sender);
+            w.u64(msg.height);
+            w.i32(msg.round);
+            w.bytes(msg.valueId);
+            w.bytes(msg.signature);
+            break;
+        case ConsensusMessageType::COMMIT:
+            header(w, MessageType::COMMIT, msg.sender);
+            proposal(w, msg);
+            certificate(w, msg);
+            break;
+    }
+}
+
+void encodeCards(std::string& out, int32_t sender, const CardsView& cards) {
+    if (cards.data.size() != static_cast<size_t>(cards.cardBytes) * cards.count) {
+        throw std::invalid_argument("card payload size does not match count");
+    }
+    Writer w(out);
+    header(w, MessageType::CARDS, sender);
+    w.u64(cards.handId);
+    w.u8(cards.stage);
+    w.u16(cards.cardBytes);
+    w.u16(cards.count);
+    out.append(cards.data.data(), cards.data.size());
+}
+
+void encodeSync(std::string& out, int32_t sender, uint64_t height) {
+    Writer w(out);
+    header(w, MessageType::SYNC, sender);
+    w.u64(height);
+}
+
+void encodeState(std::string& out, int32_t sender, uint64_t height, const StateChunkView& chunk) {
+    Writer w(out);
+    header(w, MessageType::STATE, sender);
+    w.u64(height);
+    w.u32(chunk.offset);
+    w.u32(chunk.total);
+    w.bytes(chunk.data);
+}
+
+void encodeDecided(std::string& out, int32_t sender, const ConsensusMessage& msg) {
+    Writer w(out);
+    header(w, MessageType::DECIDED, sender);
+    proposal(w, msg);
+    certificate(w, msg);
+}
+
+void encodeProbe(std::string& out, int32_t sender, const Probe& probe) {
+    size_t start = out.size();
+    Writer w(out);
+    switch (probe.type) {
+        case ProbeType::PING: header(w, MessageType::PING, sender); break;
+        case ProbeType::ACK: header(w, MessageType::ACK, sender); break;
+        case ProbeType::PING_REQ: header(w, MessageType::PING_REQ, sender); break;
+    }
+    w.u32(probe.seq);
+    w.i32(probe.target);
+    gossipTrailer(out, start, probe.updates);
+}
+
+void appendGossip(std::string& out, const std::vector<MemberUpdate>& updates) {
+    if (isBinary(out.data(), out.size())) {
+        gossipTrailer(out, 0, updates);
+    }
+}
+
+void tagTable(std::string& out, uint32_t table) {
+    if (table == DEFAULT_TABLE || !isBinary(out.data(), out.size())) {
+        return;
+    }
+    out[3] = static_cast<char>(static_cast<uint8_t>(out[3]) | FLAG_TABLE);
+    Writer w(out);
+    w.u32(table);
+}
+
+} // namespace wire
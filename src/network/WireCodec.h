@@ -0,0 +1,242 @@
+// src/network/WireCodec.h
+#pragma once
+#include "Consensus.h"
+#include "FailureDetector.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Compact binary frame format for peer traffic. A frame is the body that
+// follows the 4-byte length prefix:
+//
+//   u8 magic | u8 version | u8 type | u8 flags | i32 sender | payload
+//
+// All integers are big-endian. Strings and byte blobs are u16-length
+// prefixed. JSON bodies always start with '{', so a receiver can accept
+// either encoding from any peer.
+//
+// HELLO and WELCOME carry the sender's next undecided height and round, its
+// signing public key and a fresh nonce; WELCOME adds the responder's
+// signature over both nonces, and AUTH (bytes signature) is the initiator's
+// answer to the responder's nonce, so each side proves it holds the key it
+// presented. PROPOSAL ends in the proposer's signature and PREVOTE /
+// PRECOMMIT in the vote signature; COMMIT is the PROPOSAL layout without
+// it, followed by u16 count and (i32 sender, bytes signature) per
+// precommit. Trailing fields that older peers omit read as empty. SYNC,
+// STATE and DECIDED make up state transfer: SYNC asks for every height from
+// `height` on, STATE carries one chunk of an encoded TableSnapshot and
+// DECIDED one already-decided height in the COMMIT layout.
+//
+// PING, ACK and PING_REQ are the failure detector's probes (u32 seq,
+// i32 target); they are always sent in binary. Any frame with FLAG_GOSSIP
+// set ends in piggybacked membership updates:
+//
+//   ... payload | u8 count | (i32 node, u8 state, u32 incarnation)* | u16 length
+//
+// where length covers the count and updates, so the payload decodes as if
+// the trailer were not there.
+//
+// Frames for a table other than table 0 have FLAG_TABLE set and end in its
+// u32 table id, after any gossip trailer; one connection between two hosts
+// carries the traffic of every table they share. JSON bodies carry the id
+// as "table".
+namespace wire {
+
+constexpr uint8_t MAGIC = 0xB7;
+constexpr uint8_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 8;
+constexpr uint8_t FLAG_GOSSIP = 0x01;
+constexpr uint8_t FLAG_TABLE = 0x02;
+constexpr uint32_t DEFAULT_TABLE = 0;
+
+enum class MessageType : uint8_t {
+    HELLO = 1,
+    WELCOME = 2,
+    ACTION = 3,
+    PROPOSAL = 4,
+    PREVOTE = 5,
+    PRECOMMIT = 6,
+    CARDS = 7,
+    SYNC = 8,
+    STATE = 9,
+    DECIDED = 10,
+    COMMIT = 11,
+    PING = 12,
+    ACK = 13,
+    PING_REQ = 14,
+    AUTH = 15
+};
+
+enum class Format {
+    BINARY,
+    JSON    // debug / compatibility with older peers
+};
+
+bool isBinary(const char* data, size_t len);
+
+class Writer {
+public:
+    explicit Writer(std::string& out) : out(out) {}
+
+    void u8(uint8_t v) { out.push_back(static_cast<char>(v)); }
+    void u16(uint16_t v);
+    void u32(uint32_t v);
+    void u64(uint64_t v);
+    void i32(int32_t v) { u32(static_cast<uint32_t>(v)); }
+    void bytes(std::string_view v);
+
+private:
+    std::string& out;
+};
+
+class Reader {
+public:
+    Reader(const char* data, size_t len)
+        : p(reinterpret_cast<const uint8_t*>(data)), end(p + len), good(true) {}
+
+    uint8_t u8();
+    uint16_t u16();
+    uint32_t u32();
+    uint64_t u64();
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    std::string_view bytes();
+    std::string_view raw(size_t len);
+
+    bool ok() const { return good; }
+    bool atEnd() const { return p == end; }
+    const char* position() const { return reinterpret_cast<const char*>(p); }
+    size_t remaining() const { return good ? static_cast<size_t>(end - p) : 0; }
+
+private:
+    bool need(size_t n);
+
+    const uint8_t* p;
+    const uint8_t* end;
+    bool good;
+};
+
+// Views borrow from the receive buffer and stay valid only as long as it does.
+struct EntryView {
+    int32_t playerId;
+    uint64_t seq;
+    int32_t amount;
+    std::string_view action;
+    std::string_view phase;
+
+    CommitEntry toEntry() const;
+};
+
+// Walks the entries block of a PROPOSAL or ACTION frame without copying.
+class EntryCursor {
+public:
+    EntryCursor() : reader(nullptr, 0), left(0) {}
+    EntryCursor(const char* data, size_t len, uint16_t count) : reader(data, len), left(count) {}
+
+    bool next(EntryView& entry);
+    uint16_t remaining() const { return left; }
+
+private:
+    Reader reader;
+    uint16_t left;
+};
+
+struct CardsView {
+    uint64_t handId;
+    uint8_t stage;
+    uint16_t cardBytes;
+    uint16_t count;
+    std::string_view data;   // count * cardBytes
+};
+
+struct StateChunkView {
+    uint32_t offset;
+    uint32_t total;          // size of the whole encoded snapshot
+    std::string_view data;
+};
+
+struct ProbeView {
+    uint32_t seq;
+    int32_t target;
+};
+
+struct FrameView {
+    MessageType type;
+    uint8_t flags;
+    int32_t sender;
+    uint32_t table;                  // DEFAULT_TABLE unless FLAG_TABLE
+
+    // PROPOSAL / PREVOTE / PRECOMMIT / DECIDED; HELLO / WELCOME / SYNC /
+    // STATE use height (and round) too
+    uint64_t height;
+    int32_t round;
+    int32_t validRound;
+    std::string_view valueId;
+    std::string_view parentId;
+    std::string_view signature;      // PROPOSAL / PREVOTE / PRECOMMIT / WELCOME / AUTH
+
+    // COMMIT / DECIDED
+    uint16_t signatureCount;
+    std::string_view signatureData;
+
+    // HELLO / WELCOME
+    std::string_view publicKey;
+    std::string_view nonce;
+
+    // PROPOSAL / ACTION
+    uint16_t entryCount;
+    std::string_view entryData;
+
+    // CARDS
+    CardsView cards;
+
+    // STATE
+    StateChunkView state;
+
+    // PING / ACK / PING_REQ
+    ProbeView probe;
+
+    // FLAG_GOSSIP trailer
+    uint8_t gossipCount;
+    std::string_view gossipData;
+
+    EntryCursor entries() const { return EntryCursor(entryData.data(), entryData.size(), entryCount); }
+    bool isConsensus() const;
+    // DECIDED converts to a COMMIT message. The message owns its strings:
+    // it is queued for the verifier workers and outlives the read buffer
+    // these views point into. Reusing `out` reuses its capacity.
+    bool toConsensusMessage(ConsensusMessage& out) const;
+    bool isProbe() const;
+    bool toProbe(Probe& out) const;
+    // Appends the piggybacked updates, if any
+    void memberUpdates(std::vector<MemberUpdate>& out) const;
+};
+
+// Parses a frame body in place. Returns false for truncated, unknown-version
+// or otherwise malformed frames.
+bool decode(const char* data, size_t len, FrameView& out);
+
+// Encoders append one frame body to `out`, so a caller can reuse a buffer.
+void encodeHello(std::string& out, int32_t nodeId, uint64_t height = 0,
+                 std::string_view publicKey = std::string_view(),
+                 std::string_view nonce = std::string_view());
+void encodeWelcome(std::string& out, int32_t nodeId, uint64_t height = 0, int32_t round = 0,
+                   std::string_view publicKey = std::string_view(),
+                   std::string_view nonce = std::string_view(),
+                   std::string_view signature = std::string_view());
+void encodeAuth(std::string& out, int32_t nodeId, std::string_view signature);
+void encodeConsensus(std::string& out, const ConsensusMessage& msg);
+void encodeCards(std::string& out, int32_t sender, const CardsView& cards);
+void encodeSync(std::string& out, int32_t sender, uint64_t height);
+void encodeState(std::string& out, int32_t sender, uint64_t height, const StateChunkView& chunk);
+void encodeDecided(std::string& out, int32_t sender, const ConsensusMessage& msg);
+void encodeProbe(std::string& out, int32_t sender, const Probe& probe);
+
+// Sets FLAG_GOSSIP on the frame body in `out` and appends the trailer; a
+// no-op for no updates or a JSON body.
+void appendGossip(std::string& out, const std::vector<MemberUpdate>& updates);
+// Sets FLAG_TABLE on the frame body in `out` and appends the table id; must
+// come last. A no-op for DEFAULT_TABLE or a JSON body.
+void tagTable(std::string& out, uint32_t table);
+
+} // namespace wire
@@ -0,0 +1,16 @@
+// tests/Check.h
+// Minimal checks for the regression tests: unlike assert, they stay on in
+// release builds, and a failure names the file and line and exits non-zero.
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(cond)                                                                     \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            std::exit(1);                                                               \
+        }                                                                               \
+    } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
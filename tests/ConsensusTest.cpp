@@ -0,0 +1,165 @@
+// tests/ConsensusTest.cpp
+// A height decided on top of a value that lost at the height below it is
+// never delivered: once the lower height decides something else, the upper
+// one is run again and delivers a batch built on the real parent. Driven by
+// hand from node 4 of four validators, with no timers.
+#include "Check.h"
+#include "Consensus.h"
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const int SELF = 4;
+const std::vector<int> VALIDATORS = {1, 2, 3, 4};
+
+CommitEntry bet(int player, uint64_t seq) {
+    CommitEntry entry;
+    entry.playerId = player;
+    entry.seq = seq;
+    entry.action = "BET";
+    entry.phase = "PREFLOP";
+    entry.amount = 10;
+    return entry;
+}
+
+ConsensusMessage proposal(int sender, uint64_t height, int round, const std::string& parentId,
+                          std::vector<CommitEntry> entries) {
+    ConsensusMessage msg;
+    msg.type = ConsensusMessageType::PROPOSAL;
+    msg.sender = sender;
+    msg.height = height;
+    msg.round = round;
+    msg.parentId = parentId;
+    msg.entries = std::move(entries);
+    msg.valueId = Consensus::computeValueId(msg.parentId, msg.entries);
+    return msg;
+}
+
+ConsensusMessage vote(ConsensusMessageType type, int sender, const ConsensusMessage& value) {
+    ConsensusMessage msg;
+    msg.type = type;
+    msg.sender = sender;
+    msg.height = value.height;
+    msg.round = value.round;
+    msg.valueId = value.valueId;
+    return msg;
+}
+
+// Every other validator prevotes and precommits the value
+void decideByOthers(Consensus& consensus, const ConsensusMessage& value) {
+    for (int peer : {1, 2, 3}) {
+        consensus.onMessage(vote(ConsensusMessageType::PREVOTE, peer, value));
+    }
+    for (int peer : {1, 2, 3}) {
+        consensus.onMessage(vote(ConsensusMessageType::PRECOMMIT, peer, value));
+    }
+}
+
+int proposerOf(uint64_t height, int round) {
+    return VALIDATORS[(height + static_cast<uint64_t>(round)) % VALIDATORS.size()];
+}
+
+void orphanIsRedecided() {
+    MembershipList members;
+    for (int peer : {1, 2, 3}) {
+        members.addMember(std::to_string(peer));
+    }
+    std::vector<ConsensusMessage> sent;
+    std::vector<std::pair<uint64_t, std::vector<CommitEntry>>> delivered;
+    Consensus consensus(
+        SELF, members, [&sent](const ConsensusMessage& msg) { sent.push_back(msg); },
+        [&delivered](uint64_t height, const std::vector<CommitEntry>& entries) {
+            delivered.emplace_back(height, entries);
+        },
+        Consensus::ScheduleFn());
+    consensus.restore(0, Consensus::GENESIS_ID, CommittedEntries(),
+                      ValidatorSchedule::Sets{{0, VALIDATORS}});
+    consensus.start();
+
+    // Height 0: this node sees a polka and precommits, which starts height 1
+    ConsensusMessage h0 = proposal(proposerOf(0, 0), 0, 0, Consensus::GENESIS_ID, {bet(1, 1)});
+    consensus.onMessage(h0);
+    for (int peer : {1, 2, 3}) {
+        consensus.onMessage(vote(ConsensusMessageType::PREVOTE, peer, h0));
+    }
+    bool precommitted = false;
+    for (const auto& msg : sent) {
+        precommitted |= msg.type == ConsensusMessageType::PRECOMMIT && msg.height == 0 &&
+                        msg.valueId == h0.valueId;
+    }
+    CHECK(precommitted);
+    CHECK(delivered.empty());
+
+    // Height 1 is decided first, on a parent height 0 will not decide
+    ConsensusMessage orphan = proposal(proposerOf(1, 0), 1, 0, "bogus", {bet(2, 1)});
+    ConsensusMessage cert = orphan;
+    cert.type = ConsensusMessageType::COMMIT;
+    for (int peer : {1, 2, 3}) {
+        cert.certificate.push_back(VoteSignature{peer, std::string()});
+    }
+    consensus.onMessage(cert);
+    CHECK(delivered.empty());
+
+    // Height 0 decides: it is delivered, the orphan is not
+    for (int peer : {1, 2, 3}) {
+        consensus.onMessage(vote(ConsensusMessageType::PRECOMMIT, peer, h0));
+    }
+    CHECK_EQ(delivered.size(), 1u);
+    CHECK_EQ(delivered[0].first, 0u);
+    CHECK_EQ(delivered[0].second.size(), 1u);
+    CHECK_EQ(delivered[0].second[0].key(), bet(1, 1).key());
+    CHECK_EQ(consensus.committedHeight(), 1u);
+
+    // ... and height 1 runs again in a later round, on the real parent
+    int round = consensus.currentRound();
+    CHECK(round > 0);
+    int proposer = proposerOf(1, round);
+    CHECK(proposer != SELF);
+    ConsensusMessage redo = proposal(proposer, 1, round, h0.valueId, {bet(3, 1)});
+    consensus.onMessage(redo);
+    decideByOthers(consensus, redo);
+    CHECK_EQ(delivered.size(), 2u);
+    CHECK_EQ(delivered[1].first, 1u);
+    CHECK_EQ(delivered[1].second.size(), 1u);
+    CHECK_EQ(delivered[1].second[0].key(), bet(3, 1).key());
+    CHECK_EQ(consensus.committedHeight(), 2u);
+}
+
+// A snapshot is certified by the validators this node knows for its last
+// height, and only by a node that knows none by the snapshot's own
+void snapshotCertificate() {
+    MembershipList members;
+    Consensus consensus(SELF, members, [](const ConsensusMessage&) {},
+                        [](uint64_t, const std::vector<CommitEntry>&) {}, Consensus::ScheduleFn());
+    ConsensusMessage cert;
+    cert.type = ConsensusMessageType::COMMIT;
+    cert.height = 9;
+    for (int peer : {5, 6, 7}) {
+        cert.certificate.push_back(VoteSignature{peer, std::string()});
+    }
+    ValidatorSchedule::Sets offered{{0, {5, 6, 7, 8}}};
+    CHECK(consensus.certifiesSnapshot(cert, offered));
+    cert.certificate.pop_back();
+    CHECK(!consensus.certifiesSnapshot(cert, offered));
+
+    consensus.restore(0, Consensus::GENESIS_ID, CommittedEntries(),
+                      ValidatorSchedule::Sets{{0, VALIDATORS}});
+    cert.certificate.push_back(VoteSignature{7, std::string()});
+    CHECK(!consensus.certifiesSnapshot(cert, offered));
+    cert.certificate.clear();
+    for (int peer : {1, 2, 3}) {
+        cert.certificate.push_back(VoteSignature{peer, std::string()});
+    }
+    CHECK(consensus.certifiesSnapshot(cert, offered));
+}
+
+} // namespace
+
+int main() {
+    orphanIsRedecided();
+    snapshotCertificate();
+    std::printf("ConsensusTest passed\n");
+    return 0;
+}
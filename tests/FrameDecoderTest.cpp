@@ -0,0 +1,132 @@
+// tests/FrameDecoderTest.cpp
+// Frames split across reads, wrapped around the ring, larger than the ring
+// and over the size limit.
+#include "Check.h"
+#include "FrameDecoder.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string frame(const std::string& body) {
+    uint32_t len = static_cast<uint32_t>(body.size());
+    std::string out;
+    out += static_cast<char>(len >> 24);
+    out += static_cast<char>(len >> 16);
+    out += static_cast<char>(len >> 8);
+    out += static_cast<char>(len);
+    return out + body;
+}
+
+std::string bodyFor(size_t i, size_t size) {
+    std::string body(size, '\0');
+    for (size_t k = 0; k < size; k++) {
+        body[k] = static_cast<char>('a' + (i + k) % 26);
+    }
+    return body;
+}
+
+// Copies up to len bytes into the decoder, the way a read would
+size_t feed(FrameDecoder& decoder, const char* data, size_t len) {
+    size_t copied = 0;
+    for (const FrameDecoder::Region& region : decoder.writable()) {
+        size_t n = std::min(region.size, len - copied);
+        std::copy(data + copied, data + copied + n, region.data);
+        copied += n;
+    }
+    decoder.commit(copied);
+    return copied;
+}
+
+// Streams `bodies` through a decoder in reads of the sizes `next` picks,
+// draining after each, and checks every frame comes out whole and in order
+template <typename NextFn>
+void roundTrip(FrameDecoder& decoder, const std::vector<std::string>& bodies, NextFn next) {
+    std::string stream;
+    for (const auto& body : bodies) {
+        stream += frame(body);
+    }
+    std::vector<std::string> out;
+    size_t pos = 0;
+    while (pos < stream.size()) {
+        size_t want = std::min(next(), stream.size() - pos);
+        pos += feed(decoder, stream.data() + pos, want);
+        CHECK(decoder.drain([&out](const char* data, size_t len) { out.emplace_back(data, len); }));
+    }
+    CHECK_EQ(out.size(), bodies.size());
+    for (size_t i = 0; i < bodies.size(); i++) {
+        CHECK(out[i] == bodies[i]);
+    }
+    CHECK_EQ(decoder.buffered(), 0u);
+}
+
+// One byte per read: every frame and every length prefix arrives in pieces
+void byteAtATime() {
+    FrameDecoder decoder(64);
+    std::vector<std::string> bodies;
+    for (size_t i = 0; i < 50; i++) {
+        bodies.push_back(bodyFor(i, i % 7 == 0 ? 0 : 5 + i % 23));
+    }
+    roundTrip(decoder, bodies, []() { return size_t(1); });
+}
+
+// Random read sizes over a small ring, so frames and prefixes keep
+// wrapping its end
+void randomSplits() {
+    std::mt19937 rng(7);
+    for (int run = 0; run < 20; run++) {
+        FrameDecoder decoder(64);
+        std::vector<std::string> bodies;
+        for (size_t i = 0; i < 200; i++) {
+            bodies.push_back(bodyFor(i, rng() % 40));
+        }
+        roundTrip(decoder, bodies, [&rng]() { return size_t(1 + rng() % 61); });
+        CHECK_EQ(decoder.capacity(), 64u);
+    }
+}
+
+// A partial frame stays buffered until the rest arrives
+void partialFrame() {
+    FrameDecoder decoder(64);
+    std::string stream = frame("hello") + frame("world");
+    size_t frames = 0;
+    auto count = [&frames](const char*, size_t) { frames++; };
+
+    feed(decoder, stream.data(), 2);          // half a length prefix
+    CHECK(decoder.drain(count));
+    CHECK_EQ(frames, 0u);
+    feed(decoder, stream.data() + 2, 8);      // first frame and one byte more
+    CHECK(decoder.drain(count));
+    CHECK_EQ(frames, 1u);
+    CHECK_EQ(decoder.buffered(), 1u);
+    feed(decoder, stream.data() + 10, stream.size() - 10);
+    CHECK(decoder.drain(count));
+    CHECK_EQ(frames, 2u);
+}
+
+// A frame bigger than the ring grows it; one over maxFrame fails the drain
+void largeFrames() {
+    FrameDecoder decoder(64, 4096);
+    std::vector<std::string> bodies = {bodyFor(0, 10), bodyFor(1, 1000), bodyFor(2, 3), bodyFor(3, 4096)};
+    roundTrip(decoder, bodies, []() { return size_t(100); });
+    CHECK(decoder.capacity() >= 4096u);
+
+    FrameDecoder limited(64, 100);
+    std::string tooBig = frame(bodyFor(0, 101));
+    feed(limited, tooBig.data(), 8);
+    CHECK(!limited.drain([](const char*, size_t) { CHECK(false); }));
+}
+
+} // namespace
+
+int main() {
+    byteAtATime();
+    randomSplits();
+    partialFrame();
+    largeFrames();
+    std::printf("FrameDecoderTest passed\n");
+    return 0;
+}
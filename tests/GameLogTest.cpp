@@ -0,0 +1,205 @@
+// tests/GameLogTest.cpp
+// Reopening the game log after the crashes it is meant to survive: a torn
+// last record, and a segment roll cut short before its header was written;
+// and a decided height's certificate surviving the reopen.
+#include "Check.h"
+#include "GameLog.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<CommitEntry> entriesFor(uint64_t height) {
+    CommitEntry entry;
+    entry.playerId = 1;
+    entry.seq = height;
+    entry.action = "BET";
+    entry.phase = "PREFLOP";
+    entry.amount = static_cast<int>(height) * 10;
+    return {entry};
+}
+
+std::string segmentPath(const std::string& dir, uint64_t base) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "/segment-%020llu.log", static_cast<unsigned long long>(base));
+    return dir + name;
+}
+
+GameLog::Recovery reopen(GameLog& log, uint64_t& replayed) {
+    replayed = 0;
+    return log.open(nullptr, [&replayed](uint64_t height, const wire::FrameView&) {
+        CHECK_EQ(height, replayed);
+        replayed++;
+    });
+}
+
+void appendRange(GameLog& log, uint64_t from, uint64_t to) {
+    for (uint64_t h = from; h < to; h++) {
+        log.waitDurable(log.append(h, entriesFor(h)));
+    }
+}
+
+std::string freshDir(const char* name) {
+    char tmpl[] = "/tmp/gamelog-test-XXXXXX";
+    const char* base = mkdtemp(tmpl);
+    CHECK(base != nullptr);
+    return std::string(base) + "/" + name;
+}
+
+// The last record's body is overwritten after the fact, as if the write was
+// torn: reopening drops just that record and appends over it
+void tornRecord() {
+    std::string dir = freshDir("torn");
+    {
+        GameLog log(dir, 4096);
+        uint64_t replayed;
+        reopen(log, replayed);
+        appendRange(log, 0, 5);
+    }
+    {
+        std::string path = segmentPath(dir, 0);
+        int fd = open(path.c_str(), O_RDWR);
+        CHECK(fd >= 0);
+        // Walk the record lengths to the body of the fifth
+        off_t pos = 16;
+        for (int i = 0; i < 4; i++) {
+            unsigned char len[4];
+            CHECK_EQ(pread(fd, len, sizeof(len), pos), static_cast<ssize_t>(sizeof(len)));
+            pos += 8 + ((len[0] << 24) | (len[1] << 16) | (len[2] << 8) | len[3]);
+        }
+        off_t fifth = pos + 8;
+        const char junk[4] = {'x', 'x', 'x', 'x'};
+        CHECK_EQ(pwrite(fd, junk, sizeof(junk), fifth), static_cast<ssize_t>(sizeof(junk)));
+        close(fd);
+    }
+    {
+        GameLog log(dir, 4096);
+        uint64_t replayed;
+        GameLog::Recovery rec = reopen(log, replayed);
+        CHECK(rec.tornTail);
+        CHECK_EQ(rec.nextHeight, 4u);
+        CHECK_EQ(replayed, 4u);
+        appendRange(log, 4, 6);
+    }
+    {
+        GameLog log(dir, 4096);
+        uint64_t replayed;
+        GameLog::Recovery rec = reopen(log, replayed);
+        CHECK(!rec.tornTail);
+        CHECK_EQ(rec.nextHeight, 6u);
+    }
+}
+
+// A roll that crashed between creating the next segment and writing its
+// header leaves a file named after exactly the next height
+void tornRoll(bool empty) {
+    std::string dir = freshDir(empty ? "empty-roll" : "garbled-roll");
+    {
+        GameLog log(dir, 4096);
+        uint64_t replayed;
+        reopen(log, replayed);
+        appendRange(log, 0, 3);
+    }
+    {
+        int fd = open(segmentPath(dir, 3).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        CHECK(fd >= 0);
+        if (!empty) {
+            CHECK_EQ(ftruncate(fd, 4096), 0);
+            const char junk[16] = "not a segment";
+            CHECK_EQ(pwrite(fd, junk, sizeof(junk), 0), static_cast<ssize_t>(sizeof(junk)));
+        }
+        close(fd);
+    }
+    {
+        GameLog log(dir, 4096);
+        uint64_t replayed;
+        GameLog::Recovery rec = reopen(log, replayed);
+        CHECK(rec.tornTail);
+        CHECK_EQ(rec.nextHeight, 3u);
+        appendRange(log, 3, 5);
+    }
+    {
+        GameLog log(dir, 4096);
+        uint64_t replayed;
+        GameLog::Recovery rec = reopen(log, replayed);
+        CHECK(!rec.tornTail);
+        CHECK_EQ(rec.nextHeight, 5u);
+        CHECK_EQ(replayed, 5u);
+    }
+}
+
+// compact() returns before the snapshot is written; closing the log still
+// writes it, and the next open starts from it
+void compactThenReopen() {
+    std::string dir = freshDir("compact");
+    {
+        GameLog log(dir, 4096);
+        uint64_t replayed;
+        reopen(log, replayed);
+        appendRange(log, 0, 4);
+        log.compact(1, "state at 1");
+        log.compact(2, "state at 2");
+    }
+    GameLog log(dir, 4096);
+    uint64_t records = 0;
+    GameLog::Recovery rec = log.open(
+        [](const GameLog::Snapshot& snap) {
+            CHECK_EQ(snap.height, 2u);
+            CHECK_EQ(snap.state, std::string("state at 2"));
+        },
+        [&records](uint64_t height, const wire::FrameView&) {
+            CHECK_EQ(height, 3 + records);
+            records++;
+        });
+    CHECK(rec.hasSnapshot);
+    CHECK_EQ(rec.nextHeight, 4u);
+    CHECK_EQ(records, 1u);
+}
+
+// A height appended with its precommits replays as a COMMIT carrying them
+void certificateKept() {
+    std::string dir = freshDir("certificate");
+    {
+        GameLog log(dir, 4096);
+        uint64_t replayed;
+        reopen(log, replayed);
+        ConsensusMessage decided;
+        decided.height = 0;
+        decided.round = 2;
+        decided.entries = entriesFor(0);
+        decided.certificate.push_back(VoteSignature{3, std::string(64, 's')});
+        log.waitDurable(log.append(decided));
+        log.waitDurable(log.append(1, entriesFor(1)));
+    }
+    GameLog log(dir, 4096);
+    std::vector<ConsensusMessage> replayed;
+    GameLog::Recovery rec = log.open(nullptr, [&replayed](uint64_t, const wire::FrameView& frame) {
+        ConsensusMessage msg;
+        CHECK(frame.toConsensusMessage(msg));
+        replayed.push_back(msg);
+    });
+    CHECK_EQ(rec.nextHeight, 2u);
+    CHECK_EQ(replayed.size(), 2u);
+    CHECK_EQ(replayed[0].round, 2);
+    CHECK_EQ(replayed[0].certificate.size(), 1u);
+    CHECK_EQ(replayed[0].certificate[0].sender, 3);
+    CHECK(replayed[1].certificate.empty());
+    CHECK_EQ(replayed[1].parentId, replayed[0].valueId);
+}
+
+} // namespace
+
+int main() {
+    tornRecord();
+    tornRoll(true);
+    tornRoll(false);
+    compactThenReopen();
+    certificateKept();
+    std::printf("GameLogTest passed\n");
+    return 0;
+}
@@ -0,0 +1,163 @@
+// tests/MontgomeryTest.cpp
+// Montgomery exponentiation and Fermat inverses against vectors computed
+// independently (Python big integers), at 256 and 2048 bits, plus the
+// branch-free parity fix DeckCrypto applies to key inverses.
+#include "Check.h"
+#include "BigInt.h"
+#include "DeckCrypto.h"
+#include "Montgomery.h"
+#include "WorkerPool.h"
+#include <cstdio>
+
+namespace {
+
+using U256 = UInt<4>;
+using U2048 = UInt<32>;
+
+// secp256k1 field prime and group order
+const char* const P256 = "fffffffffffffffffffffffffffffffffffffffffffffffffffffffefffffc2f";
+const char* const N256 = "fffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141";
+const char* const A256 = "3b6f1e2c9a8d7f6e5d4c3b2a190817263544536271809fa0b1c2d3e4f5061728";
+const char* const B256 = "d1e2f3a4b5c6d7e8f90a1b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e5f60";
+
+// RFC 3526 group 14 prime p = 2q + 1, and q
+const char* const P2048 =
+    "ffffffffffffffffc90fdaa22168c234c4c6628b80dc1cd129024e088a67cc74"
+    "020bbea63b139b22514a08798e3404ddef9519b3cd3a431b302b0a6df25f1437"
+    "4fe1356d6d51c245e485b576625e7ec6f44c42e9a637ed6b0bff5cb6f406b7ed"
+    "ee386bfb5a899fa5ae9f24117c4b1fe649286651ece45b3dc2007cb8a163bf05"
+    "98da48361c55d39a69163fa8fd24cf5f83655d23dca3ad961c62f356208552bb"
+    "9ed529077096966d670c354e4abc9804f1746c08ca18217c32905e462e36ce3b"
+    "e39e772c180e86039b2783a2ec07a28fb5c55df06f4c52c9de2bcbf695581718"
+    "3995497cea956ae515d2261898fa051015728e5a8aacaa68ffffffffffffffff";
+const char* const Q2048 =
+    "7fffffffffffffffe487ed5110b4611a62633145c06e0e68948127044533e63a"
+    "0105df531d89cd9128a5043cc71a026ef7ca8cd9e69d218d98158536f92f8a1b"
+    "a7f09ab6b6a8e122f242dabb312f3f637a262174d31bf6b585ffae5b7a035bf6"
+    "f71c35fdad44cfd2d74f9208be258ff324943328f6722d9ee1003e5c50b1df82"
+    "cc6d241b0e2ae9cd348b1fd47e9267afc1b2ae91ee51d6cb0e3179ab1042a95d"
+    "cf6a9483b84b4b36b3861aa7255e4c0278ba3604650c10be19482f23171b671d"
+    "f1cf3b960c074301cd93c1d17603d147dae2aef837a62964ef15e5fb4aac0b8c"
+    "1ccaa4be754ab5728ae9130c4c7d02880ab9472d455655347fffffffffffffff";
+// A key e below 2^2046, e^-1 mod q (even), and the odd decrypt key e^-1 + q
+const char* const E2048 =
+    "123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0"
+    "123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0"
+    "123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0"
+    "123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0"
+    "123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0"
+    "123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0"
+    "123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef0"
+    "123456789abcdef0123456789abcdeffedcba9876543211";
+const char* const E_INV =
+    "8269b5933f70ca1bbbc596cfe221e1125cb8a5d4081f4373768affca60d803a2"
+    "a72c02a305b4c51ce922e94ae2344423dd2d1acf4340524473741ccc5901aa8b"
+    "695771233c8b7060bc4eb05f66d4b7432e932b02b3496e418162320c58c65e49"
+    "95e1d441b028d18337a16b18fd27a6ac49e87383e0c522a1263fef591cca8ed0"
+    "4391b08b2a4b4bca3bbded68e38cacfee14129c77d988bbcd2135568b44bb6ce"
+    "d343fe61e95eafbce30bc07c46665a5cfb61f692cf1ee30afbdd0aec0d40e688"
+    "fad8696813a37ddf701c43edd913f159c23b8fc74da724c340fa0908cddc247f"
+    "782cc33ab8d268a7096788e1f21573f5e8fb2f94b6448cfa0c8125a8b4fd060";
+const char* const D2048 =
+    "88269b5933f70ca1a04446be0ed67f2b882ebba300f0029fcbe9d700eb416674"
+    "2b789f7d4de519e2f73732d1753d46b1359d5e86dad126b1df4cc703bebfa4c4"
+    "5e8611c8ea719828fe07c5c1279c8ad7ad0f5424fe508d999e15d17c3f8fc1db"
+    "907a5341c8475ceb0ac9a8ba4df80a5de932ba61347e7fc8f3643d51e27e886f"
+    "d0a63f23c0cf9e89d846feab0ccb327fafc6c12e662b5f86db52af019b8764ca"
+    "bc9ed469d6e1363281b6d6aee9c4b1a84870556d91fdfeeec905ffd1d7ef7586"
+    "817cc22c8d417adfc49586105395105d770667f4ac809bb12325868bd789cdd4"
+    "144d70f220d7dbfcfb7f8b9a6b9e59c76948fa2690ba9e0420c8125a8b4fd05f";
+// 49^e mod p, card 5 of the initial deck encrypted under e
+const char* const CARD_E =
+    "15416b16814de7eb24bd80935296dd36ddb2804e605a7d8e2019b7528007b660"
+    "34d919614ceeb2a14fa17d4291dc3879c2372d21fe12e234053f92f9fed06921"
+    "85efa21eccefd93dc73dc7b227cff5eb4d5e2c95f7c5b6936e3463648b3c99f8"
+    "e8ba4db3a7c52475125ea060aa8462b71ee9d6f4704d2fbe8587cfd3f0b77325"
+    "6a93b71d25e12dda08707f6843d3256ae934d2981217d44e7b7570fb74182e3d"
+    "b3b8c734a8857549dc185ffc8b4ca0c404f70c07dbe4dd98d69cd2d1b31bca34"
+    "05b159feb26f33234e64e976b183d958a92e99f48974c2e740ecbcecd7422d9b"
+    "6e30ab7eb29109e5abbaf95b5d3705951e94e094699e6917c0428276d9ff1b77";
+
+void pow256() {
+    Montgomery<4> field(U256::fromHex(P256));
+    U256 a = U256::fromHex(A256);
+    U256 b = U256::fromHex(B256);
+    CHECK(field.pow(a, b) == U256::fromHex("efe6c7685ce4a3beda95fbbc1adea43c5642e0f6bc885a60c676a537088f8f03"));
+    CHECK(field.pow(a, U256()) == U256::fromU64(1));
+    CHECK(field.pow(a, U256::fromU64(1)) == a);
+    CHECK(field.pow(U256(), b) == U256());
+
+    U256 pMinus1;
+    U256::sub(pMinus1, field.modulus(), U256::fromU64(1));
+    CHECK(field.pow(pMinus1, b) == U256::fromU64(1));   // b is even
+    CHECK(field.pow(pMinus1, U256::fromU64(3)) == pMinus1);
+}
+
+void inverse256() {
+    Montgomery<4> field(U256::fromHex(P256));
+    U256 pMinus2;
+    U256::sub(pMinus2, field.modulus(), U256::fromU64(2));
+    CHECK(field.pow(U256::fromU64(2), pMinus2) == U256::fromHex("7fffffffffffffffffffffffffffffffffffffffffffffffffffffff7ffffe18"));
+
+    Montgomery<4> order(U256::fromHex(N256));
+    U256 nMinus2;
+    U256::sub(nMinus2, order.modulus(), U256::fromU64(2));
+    U256 a = U256::fromHex(A256);
+    U256 inv = order.pow(a, nMinus2);
+    CHECK(inv == U256::fromHex("cac610619be0fac1b47acae0de64a78c64302e7c26cca1e3aa627b924a8c5ec1"));
+    CHECK(order.fromMont(order.mul(order.toMont(a), order.toMont(inv))) == U256::fromU64(1));
+}
+
+void pow2048() {
+    Montgomery<32> group(U2048::fromHex(P2048));
+    U2048 e = U2048::fromHex(E2048);
+    U2048 card = U2048::fromU64(49);
+    U2048 encrypted = group.pow(card, e);
+    CHECK(encrypted == U2048::fromHex(CARD_E));
+    CHECK(group.pow(encrypted, U2048::fromHex(D2048)) == card);
+}
+
+// The decrypt key must be odd to invert e mod 2q; q is odd, so an even
+// inverse takes q once
+void inverse2048() {
+    U2048 q = U2048::fromHex(Q2048);
+    Montgomery<32> exponents(q);
+    U2048 qMinus2;
+    U2048::sub(qMinus2, q, U2048::fromU64(2));
+    U2048 inv = exponents.pow(U2048::fromHex(E2048), qMinus2);
+    CHECK(inv == U2048::fromHex(E_INV));
+
+    U2048 fixed;
+    U2048::addMasked(fixed, inv, q, (inv.limb[0] & 1) - 1);
+    CHECK(fixed == U2048::fromHex(D2048));
+    U2048 kept;
+    U2048::addMasked(kept, fixed, q, (fixed.limb[0] & 1) - 1);
+    CHECK(kept == fixed);
+}
+
+// Whatever key generateKey draws, decrypting undoes encrypting
+void deckKeys() {
+    WorkerPool pool(1);
+    DeckCrypto crypto(pool);
+    SecureRandom rng;
+    std::vector<DeckCrypto::Card> deck = crypto.initialDeck();
+    for (int round = 0; round < 8; round++) {
+        DeckCrypto::KeyPair key = crypto.generateKey(rng);
+        CHECK(key.decrypt.isOdd());
+        size_t i = static_cast<size_t>(round) * 6;
+        DeckCrypto::Card plain = crypto.exponentiate(crypto.exponentiate(deck[i], key.encrypt), key.decrypt);
+        CHECK_EQ(crypto.decode(plain), static_cast<int>(i));
+    }
+}
+
+} // namespace
+
+int main() {
+    pow256();
+    inverse256();
+    pow2048();
+    inverse2048();
+    deckKeys();
+    std::printf("MontgomeryTest passed\n");
+    return 0;
+}
@@ -0,0 +1,84 @@
+// tests/TimerWheelTest.cpp
+// Timers on both sides of level-1 cascades fire in expiry order and never
+// early; cancelling a cascaded timer and rescheduling from a callback work.
+// Real 1 ms ticks, so level 2 (65 s out) is left to the arithmetic.
+#include "Check.h"
+#include "TimerWheel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Fired {
+    int delay;
+    Clock::duration at;
+};
+
+void cascadeOrdering() {
+    boost::asio::io_context io;
+    TimerWheel wheel(io);
+    std::vector<int> delays = {1, 2, 200, 254, 255, 256, 257, 300, 510, 511, 512, 513, 600, 767, 768, 900};
+    std::vector<int> order = delays;
+    std::shuffle(order.begin(), order.end(), std::mt19937(3));
+
+    std::vector<Fired> fired;
+    Clock::time_point start = Clock::now();
+    for (int delay : order) {
+        wheel.schedule(std::chrono::milliseconds(delay), [&fired, &start, delay]() {
+            fired.push_back({delay, Clock::now() - start});
+        });
+    }
+    // Scheduled past the first wrap and cancelled after it cascaded
+    TimerWheel::Handle cancelled = wheel.schedule(std::chrono::milliseconds(700), []() { CHECK(false); });
+    TimerWheel::Handle early = wheel.schedule(std::chrono::milliseconds(400), [&]() {
+        CHECK(wheel.cancel(cancelled));
+        wheel.schedule(std::chrono::milliseconds(600), [&fired, &start]() {
+            fired.push_back({1000, Clock::now() - start});
+        });
+    });
+    CHECK(early.valid());
+    CHECK_EQ(wheel.pending(), delays.size() + 2);
+
+    while (wheel.pending() > 0 && Clock::now() - start < std::chrono::seconds(5)) {
+        io.run_for(std::chrono::milliseconds(50));
+    }
+    io.poll();
+    CHECK_EQ(wheel.pending(), 0u);
+    delays.push_back(1000);
+    CHECK_EQ(fired.size(), delays.size());
+    for (size_t i = 0; i < fired.size(); i++) {
+        CHECK_EQ(fired[i].delay, delays[i]);
+        CHECK(fired[i].at >= std::chrono::milliseconds(fired[i].delay));
+    }
+    CHECK(!wheel.cancel(early));
+}
+
+// Many timers landing in the same slot after a cascade all fire
+void crowdedSlot() {
+    boost::asio::io_context io;
+    TimerWheel wheel(io);
+    int fired = 0;
+    for (int i = 0; i < 1000; i++) {
+        wheel.schedule(std::chrono::milliseconds(260 + i % 3), [&fired]() { fired++; });
+    }
+    Clock::time_point start = Clock::now();
+    while (fired < 1000 && Clock::now() - start < std::chrono::seconds(5)) {
+        io.run_for(std::chrono::milliseconds(50));
+    }
+    CHECK_EQ(fired, 1000);
+    CHECK_EQ(wheel.pending(), 0u);
+}
+
+} // namespace
+
+int main() {
+    cascadeOrdering();
+    crowdedSlot();
+    std::printf("TimerWheelTest passed\n");
+    return 0;
+}